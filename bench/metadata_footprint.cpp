@@ -0,0 +1,110 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+// Host memory used by the metadata of a Variable, per block.
+//
+// Usage: metadata_footprint [publishers (default: 16384)] [transactions (default: 10)]
+//
+// Every publisher writes one 2D block of a Variable in every transaction, in its own file. The bytes allocated on the
+// heap to record these blocks are measured twice: with the block tables of dtlmod::Metadata, and with the nested maps
+// that Metadata used to rely on (rebuilt here with the same content for comparison).
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <simgrid/s4u/Actor.hpp>
+#include <simgrid/s4u/Engine.hpp>
+#include <simgrid/s4u/Host.hpp>
+
+#include "dtlmod/DTL.hpp"
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(metadata_footprint, "Messages specific for this benchmark");
+
+namespace sg4 = simgrid::s4u;
+
+static size_t live_bytes = 0;
+
+void* operator new(size_t size)
+{
+  void* ptr = std::malloc(size);
+  if (!ptr)
+    throw std::bad_alloc();
+  live_bytes += malloc_usable_size(ptr);
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if (ptr)
+    live_bytes -= malloc_usable_size(ptr);
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+using LegacyRegion = std::pair<std::vector<size_t>, std::vector<size_t>>;
+using LegacyBlocks = std::map<LegacyRegion, std::pair<std::string, sg4::ActorPtr>, std::less<>>;
+
+static void run_benchmark(size_t num_publishers, unsigned int num_transactions)
+{
+  constexpr size_t block_size = 1024;
+  auto dtl                    = dtlmod::DTL::connect();
+  auto stream                 = dtl->add_stream("bench");
+  auto var  = stream->define_variable("var", {num_publishers * block_size, block_size}, {0, 0},
+                                      {block_size, block_size}, sizeof(double));
+  auto self = sg4::Actor::self();
+  const std::string path = "/pfs/my-working-dir/my-output/data.";
+  const size_t num_blocks = num_publishers * num_transactions;
+
+  size_t before = live_bytes;
+  for (unsigned int tx = 1; tx <= num_transactions; tx++) {
+    for (size_t p = 0; p < num_publishers; p++) {
+      var->set_local_start_and_count(self, {{p * block_size, 0}, {block_size, block_size}});
+      var->add_transaction_metadata(tx, self, path + std::to_string(p));
+    }
+    // Reading a transaction seals its block table
+    (void)var->get_sizes_to_get_per_block(tx, {0, 0}, {1, 1});
+  }
+  size_t block_tables = live_bytes - before;
+
+  before = live_bytes;
+  auto legacy = std::make_unique<std::map<unsigned int, LegacyBlocks, std::less<>>>();
+  for (unsigned int tx = 1; tx <= num_transactions; tx++)
+    for (size_t p = 0; p < num_publishers; p++)
+      (*legacy)[tx][LegacyRegion({p * block_size, 0}, {block_size, block_size})] =
+          std::make_pair(path + std::to_string(p), self);
+  size_t nested_maps = live_bytes - before;
+
+  XBT_INFO("%zu publishers x %u transactions = %zu blocks", num_publishers, num_transactions, num_blocks);
+  XBT_INFO("Nested maps : %10zu bytes, %6.1f bytes/block", nested_maps, static_cast<double>(nested_maps) / num_blocks);
+  XBT_INFO("Block tables: %10zu bytes, %6.1f bytes/block", block_tables,
+           static_cast<double>(block_tables) / num_blocks);
+  XBT_INFO("Metadata::get_memory_footprint() reports %zu bytes", var->get_metadata()->get_memory_footprint());
+
+  legacy.reset();
+  dtlmod::DTL::disconnect();
+}
+
+int main(int argc, char** argv)
+{
+  sg4::Engine engine(&argc, argv);
+  size_t num_publishers         = argc > 1 ? std::stoul(argv[1]) : 16384;
+  unsigned int num_transactions = argc > 2 ? static_cast<unsigned int>(std::stoul(argv[2])) : 10;
+
+  auto* host = engine.get_netzone_root()->add_host("host", "1Gf");
+  engine.get_netzone_root()->seal();
+  dtlmod::DTL::create();
+  host->add_actor("bench", [num_publishers, num_transactions]() { run_benchmark(num_publishers, num_transactions); });
+  engine.run();
+  return 0;
+}
@@ -12,6 +12,7 @@
 #include <dtlmod/FileEngine.hpp>
 #include <dtlmod/FileTransport.hpp>
 #include <dtlmod/Metadata.hpp>
+#include <dtlmod/MetadataReader.hpp>
 #include <dtlmod/ReductionMethod.hpp>
 #include <dtlmod/StagingEngine.hpp>
 #include <dtlmod/StagingMboxTransport.hpp>
@@ -14,6 +14,8 @@
 #include <limits>
 #include <set>
 
+#include "dtlmod/ActorSlots.hpp"
+
 namespace sg4 = simgrid::s4u;
 
 namespace dtlmod {
@@ -35,6 +37,8 @@ public:
   void add(sg4::ActorPtr actor)
   {
     xbt_assert(actor != nullptr, "Cannot add null actor to registry");
+    // Registered actors get their slot right away, so that slots follow the order of registration
+    ActorSlot::of(actor.get());
     actors_.insert(actor);
   }
 
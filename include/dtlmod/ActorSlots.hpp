@@ -0,0 +1,192 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_ACTOR_SLOTS_HPP__
+#define __DTLMOD_ACTOR_SLOTS_HPP__
+
+#include <simgrid/s4u/Actor.hpp>
+#include <xbt/asserts.h>
+
+#include <limits>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace sg4 = simgrid::s4u;
+
+namespace dtlmod {
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief The dense index of an actor that takes part in a Stream.
+///
+/// Slots are handed out when actors register as publisher or subscriber of an Engine, or when per-actor state is first
+/// recorded for them. A slot is attached to the actor as a SimGrid extension, so that finding it is an array access
+/// that neither hashes the actor nor touches its reference count. The slot of an actor is recycled when SimGrid
+/// destroys the actor, and the lowest free slot is handed out first. Slots thus stay as dense as the number of actors
+/// alive at the same time, and so do the vectors of ActorSlotMap. Recycling is safe because an ActorSlotMap holds a
+/// reference on every actor it has an entry for: an actor that is destroyed has no entry left anywhere.
+class ActorSlot {
+  size_t slot_;
+  static size_t num_slots_;
+  // Never destroyed, as actors can be destroyed after the static objects when the simulation ends
+  static std::set<size_t>& get_free_slots()
+  {
+    static auto* free_slots = new std::set<size_t>();
+    return *free_slots;
+  }
+
+public:
+  static simgrid::xbt::Extension<sg4::Actor, ActorSlot> EXTENSION_ID;
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  explicit ActorSlot(size_t slot) : slot_(slot) {}
+  ActorSlot(const ActorSlot&)            = delete;
+  ActorSlot& operator=(const ActorSlot&) = delete;
+  ~ActorSlot() { get_free_slots().insert(slot_); }
+
+  /// Get the slot of an actor, and give it the lowest free one if it has none yet
+  static size_t of(sg4::Actor* actor);
+  /// Get the slot of an actor, or NONE if it has none yet
+  static size_t find(const sg4::Actor* actor) noexcept
+  {
+    if (not EXTENSION_ID.valid())
+      return NONE;
+    const auto* slot = actor->extension<ActorSlot>();
+    return slot ? slot->slot_ : NONE;
+  }
+  /// Number of slots handed out so far, i.e., the highest number of actors that held a slot at the same time
+  [[nodiscard]] static size_t get_num_slots() noexcept { return num_slots_; }
+  /// Number of slots that actors left and that are handed out again before any new one
+  [[nodiscard]] static size_t get_num_free_slots() noexcept { return get_free_slots().size(); }
+};
+
+/// @brief Per-actor state, stored in a vector indexed by the slot of each actor.
+///
+/// It offers the subset of the std::map interface that DTLMod uses, with find() returning a pointer to the value or
+/// nullptr. Iterating over the map visits the (actor, value) pairs in slot order.
+template <typename T> class ActorSlotMap {
+public:
+  using value_type = std::pair<const sg4::ActorPtr, T>;
+
+private:
+  std::vector<std::optional<value_type>> entries_;
+  size_t size_ = 0;
+
+  template <typename Entries, typename Value> class Iterator {
+    Entries* entries_;
+    size_t pos_;
+    void skip_empty_slots()
+    {
+      while (pos_ < entries_->size() && not(*entries_)[pos_])
+        pos_++;
+    }
+
+  public:
+    Iterator(Entries* entries, size_t pos) : entries_(entries), pos_(pos) { skip_empty_slots(); }
+    Value& operator*() const { return *(*entries_)[pos_]; }
+    Value* operator->() const { return &**this; }
+    Iterator& operator++()
+    {
+      pos_++;
+      skip_empty_slots();
+      return *this;
+    }
+    bool operator==(const Iterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const Iterator& other) const { return pos_ != other.pos_; }
+  };
+
+  [[nodiscard]] const std::optional<value_type>* get_entry(const sg4::Actor* actor) const noexcept
+  {
+    xbt_assert(actor != nullptr, "Cannot look for the state of a null actor");
+    auto slot = ActorSlot::find(actor);
+    return slot < entries_.size() && entries_[slot] ? &entries_[slot] : nullptr;
+  }
+
+public:
+  using iterator       = Iterator<std::vector<std::optional<value_type>>, value_type>;
+  using const_iterator = Iterator<const std::vector<std::optional<value_type>>, const value_type>;
+
+  template <typename... Args> std::pair<T*, bool> try_emplace(sg4::Actor* actor, Args&&... args)
+  {
+    xbt_assert(actor != nullptr, "Cannot record the state of a null actor");
+    auto slot = ActorSlot::of(actor);
+    if (slot >= entries_.size())
+      entries_.resize(slot + 1);
+    if (entries_[slot])
+      return {&entries_[slot]->second, false};
+    entries_[slot].emplace(std::piecewise_construct, std::forward_as_tuple(actor),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+    size_++;
+    return {&entries_[slot]->second, true};
+  }
+  template <typename... Args> std::pair<T*, bool> try_emplace(const sg4::ActorPtr& actor, Args&&... args)
+  {
+    return try_emplace(actor.get(), std::forward<Args>(args)...);
+  }
+
+  T& operator[](sg4::Actor* actor) { return *try_emplace(actor).first; }
+  T& operator[](const sg4::ActorPtr& actor) { return *try_emplace(actor.get()).first; }
+
+  [[nodiscard]] T* find(const sg4::Actor* actor) noexcept
+  {
+    const auto* entry = get_entry(actor);
+    return entry ? const_cast<T*>(&(*entry)->second) : nullptr;
+  }
+  [[nodiscard]] T* find(const sg4::ActorPtr& actor) noexcept { return find(actor.get()); }
+  [[nodiscard]] const T* find(const sg4::Actor* actor) const noexcept
+  {
+    const auto* entry = get_entry(actor);
+    return entry ? &(*entry)->second : nullptr;
+  }
+  [[nodiscard]] const T* find(const sg4::ActorPtr& actor) const noexcept { return find(actor.get()); }
+  [[nodiscard]] bool contains(const sg4::Actor* actor) const noexcept { return get_entry(actor) != nullptr; }
+  [[nodiscard]] bool contains(const sg4::ActorPtr& actor) const noexcept { return contains(actor.get()); }
+
+  const T& at(const sg4::Actor* actor) const
+  {
+    const auto* value = find(actor);
+    if (not value)
+      throw std::out_of_range(std::string("No state recorded for actor ") + actor->get_cname());
+    return *value;
+  }
+  const T& at(const sg4::ActorPtr& actor) const { return at(actor.get()); }
+  T& at(const sg4::Actor* actor) { return const_cast<T&>(std::as_const(*this).at(actor)); }
+  T& at(const sg4::ActorPtr& actor) { return at(actor.get()); }
+
+  size_t erase(const sg4::Actor* actor) noexcept
+  {
+    auto slot = ActorSlot::find(actor);
+    if (slot >= entries_.size() || not entries_[slot])
+      return 0;
+    entries_[slot].reset();
+    size_--;
+    return 1;
+  }
+  size_t erase(const sg4::ActorPtr& actor) noexcept { return erase(actor.get()); }
+  void clear() noexcept
+  {
+    entries_.clear();
+    size_ = 0;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+  /// Number of slots the vector holds, occupied or not, to account for its memory footprint
+  [[nodiscard]] size_t get_num_slots() const noexcept { return entries_.capacity(); }
+  [[nodiscard]] static constexpr size_t get_slot_size() noexcept { return sizeof(std::optional<value_type>); }
+
+  iterator begin() noexcept { return iterator(&entries_, 0); }
+  iterator end() noexcept { return iterator(&entries_, entries_.size()); }
+  const_iterator begin() const noexcept { return const_iterator(&entries_, 0); }
+  const_iterator end() const noexcept { return const_iterator(&entries_, entries_.size()); }
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
@@ -0,0 +1,73 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_BINARY_METADATA_HPP__
+#define __DTLMOD_BINARY_METADATA_HPP__
+
+#include <cstdint>
+
+/// @brief On-disk layout of the binary metadata export format.
+///
+/// All the integers are stored in the byte order of the host that wrote the file, which is recorded in the header.
+/// All the sections start on an 8-byte boundary, so that a file mapped in memory can be read in place.
+///
+///   Header                 at offset 0
+///   Block tables           one per distinct block layout of a variable (shared by consecutive transactions):
+///                            starts   uint64_t[num_blocks * num_dims]
+///                            counts   uint64_t[num_blocks * num_dims]
+///                            location uint32_t[num_blocks], padded to 8 bytes
+///   Shapes                 per variable, its final shape, uint64_t[num_dims], then the shape it had from each
+///                          transaction in which it changed on, as uint64_t{transaction id} and uint64_t[num_dims]
+///   VariableRecord[]       sorted by variable name
+///   TransactionRecord[]    the footer index, sorted by (variable, transaction id)
+///   Location sizes         uint64_t[num_locations], the final size of the files written by a File engine (0 for the
+///                          publishers of a Staging engine), used to recreate them when the metadata is imported
+///   String table           uint64_t count, uint64_t offsets[count + 1], then the characters. Strings [0,
+///                          num_locations) are the locations referred to by the block tables, followed by the names
+///                          of the variables.
+namespace dtlmod::binary_metadata {
+
+constexpr char MAGIC[8]            = {'D', 'T', 'L', 'M', 'O', 'D', 'M', 'D'};
+constexpr uint32_t VERSION         = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t num_variables;
+  uint64_t num_locations;
+  uint64_t variables_offset;
+  uint64_t num_transactions;
+  uint64_t transactions_offset;
+  uint64_t strings_offset;
+  uint64_t location_sizes_offset;
+};
+static_assert(sizeof(Header) == 72, "Header must be 72-byte long");
+
+struct VariableRecord {
+  uint32_t name; // index in the string table
+  uint32_t num_dims;
+  uint64_t element_size;
+  uint64_t shape_offset;
+  uint64_t first_transaction; // index of the first TransactionRecord of this variable
+  uint64_t num_transactions;
+  uint32_t kind;             // value of the Variable::Kind of the variable
+  uint32_t joined_dimension; // only meaningful for a joined array
+  uint64_t shape_changes_offset;
+  uint64_t num_shape_changes; // in increasing order of transaction id
+};
+static_assert(sizeof(VariableRecord) == 64, "VariableRecord must be 64-byte long");
+
+struct TransactionRecord {
+  uint32_t variable; // index of the VariableRecord
+  uint32_t transaction_id;
+  uint64_t num_blocks;
+  uint64_t blocks_offset; // offset of the block table, possibly shared with other transactions
+};
+static_assert(sizeof(TransactionRecord) == 24, "TransactionRecord must be 24-byte long");
+
+} // namespace dtlmod::binary_metadata
+#endif
@@ -0,0 +1,58 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_BINARY_METADATA_WRITER_HPP__
+#define __DTLMOD_BINARY_METADATA_WRITER_HPP__
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dtlmod/BinaryMetadata.hpp"
+#include "dtlmod/LocationTable.hpp"
+
+namespace dtlmod {
+
+class BlockTable;
+class Variable;
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief Writes the metadata of a Stream in the binary format described in BinaryMetadata.hpp.
+///
+/// Block tables are appended to the final file as transactions are flushed or exported, right after a placeholder
+/// header. A table shared by consecutive transactions of a variable is only written once. The shapes, the variable
+/// records, the footer index, the location sizes, and the string table are appended by finish(), which then writes the
+/// actual header.
+class BinaryMetadataWriter {
+  struct VariableEntries {
+    std::vector<binary_metadata::TransactionRecord> transactions;
+    std::shared_ptr<const BlockTable> last_layout;
+    uint64_t last_layout_offset = 0;
+  };
+
+  std::string path_;
+  std::ofstream out_;
+  uint64_t offset_ = 0;
+  std::map<std::string, VariableEntries, std::less<>> variables_;
+
+  void open();
+  void write(const void* data, uint64_t size);
+  void pad();
+
+public:
+  explicit BinaryMetadataWriter(std::string path) : path_(std::move(path)) {}
+
+  [[nodiscard]] const std::string& get_path() const noexcept { return path_; }
+  void add_transaction(const std::string& var_name, unsigned int transaction_id,
+                       const std::shared_ptr<const BlockTable>& blocks);
+  void finish(const std::vector<std::shared_ptr<Variable>>& variables, const LocationTable& locations,
+              const std::vector<uint64_t>& location_sizes);
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
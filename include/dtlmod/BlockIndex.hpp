@@ -0,0 +1,55 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_BLOCK_INDEX_HPP__
+#define __DTLMOD_BLOCK_INDEX_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include "dtlmod/Extents.hpp"
+
+namespace dtlmod {
+
+class BlockTable;
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief A static R-tree over the blocks of a sealed BlockTable.
+///
+/// The tree is bulk-loaded with the Sort-Tile-Recursive algorithm: blocks are tiled along each dimension in turn, so
+/// that consecutive groups of FANOUT blocks are spatially close, and each group is bounded by a node. Nodes are grouped
+/// the same way until a single root remains. As the tree is packed, the children of node i of a level are the entries
+/// [i * FANOUT, (i + 1) * FANOUT) of the level below, and no pointer has to be stored.
+///
+/// A query for the blocks intersecting a box thus costs O(log P + hits) instead of O(P) for a linear scan.
+class BlockIndex {
+  static constexpr size_t FANOUT = 16;
+
+  struct Level {
+    std::vector<size_t> lo; // lower corners of the node bounding boxes, ndims per node
+    std::vector<size_t> hi; // upper corners (exclusive) of the node bounding boxes, ndims per node
+    [[nodiscard]] size_t size(size_t ndims) const noexcept { return ndims == 0 ? 0 : lo.size() / ndims; }
+  };
+
+  size_t ndims_ = 0;
+  std::vector<unsigned int> entries_; // block ids in tiling order
+  std::vector<Level> levels_;         // levels_[0] bounds groups of entries_, levels_.back() is the root
+
+  void tile(const BlockTable& blocks, std::vector<unsigned int>::iterator begin,
+            std::vector<unsigned int>::iterator end, size_t dim);
+
+public:
+  explicit BlockIndex(const BlockTable& blocks);
+
+  /// Append to 'hits' the ids of the blocks that share at least one element with the box [start, start + count),
+  /// in increasing order.
+  void find_intersecting_blocks(const BlockTable& blocks, const Extents& start, const Extents& count,
+                                std::vector<size_t>& hits) const;
+  [[nodiscard]] size_t get_memory_footprint() const noexcept;
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
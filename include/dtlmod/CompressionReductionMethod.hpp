@@ -77,7 +77,7 @@ public:
     return var.get_shape();
   }
 
-  [[nodiscard]] const std::pair<std::vector<size_t>, std::vector<size_t>>&
+  [[nodiscard]] std::pair<std::vector<size_t>, std::vector<size_t>>
   get_reduced_start_and_count_for(const Variable& var, sg4::ActorPtr publisher) const override
   {
     return var.get_local_start_and_count(publisher);
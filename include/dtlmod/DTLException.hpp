@@ -55,6 +55,11 @@ DECLARE_DTLMOD_EXCEPTION(IncorrectPathDefinitionException, "Fullpath must be str
 
 DECLARE_DTLMOD_EXCEPTION(InvalidTransactionIdException,
                          "Impossible to get. This transaction doesn't exist for variable yet");
+DECLARE_DTLMOD_EXCEPTION(InvalidValueRangeException, "Invalid value range, min must not be greater than max");
+DECLARE_DTLMOD_EXCEPTION(InvalidBlockSelectionException, "Invalid block selection");
+DECLARE_DTLMOD_EXCEPTION(InvalidSelectionException, "Invalid selection");
+DECLARE_DTLMOD_EXCEPTION(InvalidSelectionStrideException,
+                         "Invalid selection stride, it needs one non-zero value per dimension");
 DECLARE_DTLMOD_EXCEPTION(GetWhenNoTransactionException, "Impossible to get. No transaction exists for variable");
 
 DECLARE_DTLMOD_EXCEPTION(UnknownReductionMethodException,
@@ -70,6 +75,12 @@ DECLARE_DTLMOD_EXCEPTION(UnknownCompressionOptionException, "Unknown Compression
 DECLARE_DTLMOD_EXCEPTION(InconsistentCompressionRatioException, "Inconsistent Compression ratio");
 DECLARE_DTLMOD_EXCEPTION(SubscriberSideCompressionException, "Compression can only be applied on the publisher side");
 
+DECLARE_DTLMOD_EXCEPTION(UnknownMetadataFormatException, "Unknown metadata format. Options are 'text' and 'binary'");
+DECLARE_DTLMOD_EXCEPTION(InvalidMetadataFileException, "Invalid binary metadata file");
+DECLARE_DTLMOD_EXCEPTION(InvalidMetadataImportException,
+                         "Metadata can only be imported by the subscribers of a Stream using Engine::Type::File");
+DECLARE_DTLMOD_EXCEPTION(MetadataSpillException, "Cannot move metadata to or from the spill file");
+
 DECLARE_DTLMOD_EXCEPTION(TransactionCanceledException, "Transaction canceled");
 DECLARE_DTLMOD_EXCEPTION(EndOfStreamException, "End of stream: all publishers have closed");
 
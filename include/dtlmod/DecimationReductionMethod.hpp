@@ -23,8 +23,7 @@ class DecimationReductionMethod : public ReductionMethod {
     double cost_per_element_;
 
     std::vector<size_t> reduced_shape_;
-    std::unordered_map<sg4::ActorPtr, std::pair<std::vector<size_t>, std::vector<size_t>>>
-        reduced_local_start_and_count_;
+    ActorSlotMap<std::pair<Extents, Extents>> reduced_local_start_and_count_;
 
   public:
     ParameterizedDecimation(const Variable& var, const std::vector<size_t>& stride,
@@ -34,10 +33,10 @@ class DecimationReductionMethod : public ReductionMethod {
     }
 
     void set_reduced_shape(const std::vector<size_t>& reduced_shape) { reduced_shape_ = reduced_shape; }
-    void set_reduced_local_start_and_count(sg4::ActorPtr actor, const std::vector<size_t>& reduced_local_start,
-                                           const std::vector<size_t>& reduced_local_count)
+    void set_reduced_local_start_and_count(sg4::ActorPtr actor, const Extents& reduced_local_start,
+                                           const Extents& reduced_local_count)
     {
-      reduced_local_start_and_count_.try_emplace(actor, reduced_local_start, reduced_local_count);
+      reduced_local_start_and_count_[actor] = std::make_pair(reduced_local_start, reduced_local_count);
     }
 
     [[nodiscard]] const std::vector<size_t>& get_stride() const { return stride_; }
@@ -51,8 +50,7 @@ class DecimationReductionMethod : public ReductionMethod {
 
     [[nodiscard]] size_t get_global_reduced_size() const;
     [[nodiscard]] size_t get_local_reduced_size() const;
-    [[nodiscard]] const std::pair<std::vector<size_t>, std::vector<size_t>>&
-    get_reduced_start_and_count_for(sg4::ActorPtr publisher) const;
+    [[nodiscard]] const std::pair<Extents, Extents>& get_reduced_start_and_count_for(sg4::ActorPtr publisher) const;
     [[nodiscard]] double get_flop_amount_to_decimate() const;
   };
 
@@ -107,7 +105,13 @@ protected:
     return per_variable_parameterizations_.at(&var)->get_reduced_shape();
   }
 
-  [[nodiscard]] const std::pair<std::vector<size_t>, std::vector<size_t>>&
+  /// A subscriber that decimates the Variable only reads the elements it keeps
+  [[nodiscard]] std::vector<size_t> get_read_stride(const Variable& var) const override
+  {
+    return per_variable_parameterizations_.at(&var)->get_stride();
+  }
+
+  [[nodiscard]] std::pair<std::vector<size_t>, std::vector<size_t>>
   get_reduced_start_and_count_for(const Variable& var, sg4::ActorPtr publisher) const override
   {
     return per_variable_parameterizations_.at(&var)->get_reduced_start_and_count_for(publisher);
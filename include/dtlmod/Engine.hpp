@@ -18,6 +18,9 @@
 
 #include <atomic>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "dtlmod/ActorRegistry.hpp"
 #include "dtlmod/Transport.hpp"
@@ -64,12 +67,26 @@ private:
 
   ActorRegistry subscribers_;
 
+  // Rank of each publisher in the metadata aggregation tree, and bytes of metadata it put in the current transaction.
+  // Ranks are dense: they go from 0 to the number of publishers, in the order in which publishers opened the Stream.
+  ActorSlotMap<unsigned int> publisher_ranks_;
+  mutable ActorSlotMap<sg_size_t> pub_metadata_sizes_;
+  // Bytes of metadata gathered in the subtree rooted at each rank, and transfers of the tree in flight per publisher.
+  // The sets are in a node-based map, so that the one a publisher waits on does not move when another one is added.
+  std::vector<sg_size_t> subtree_metadata_sizes_;
+  std::unordered_map<aid_t, sg4::ActivitySet> metadata_aggregation_;
+
   sg4::ActivitySet pub_transaction_;
   sg4::ActivitySet sub_transaction_;
 
+  // Number of transactions held in staging, each time it changes
+  std::vector<std::pair<double, unsigned int>> staging_queue_history_;
+
   // Private methods for Stream (friend)
   void add_publisher(sg4::ActorPtr actor);
   void add_subscriber(sg4::ActorPtr actor);
+  void account_for_metadata(const Variable& var) const;
+  bool wait_for_metadata_aggregation(sg4::ActivitySet& pending);
 
 protected:
   // Accessors for Transport classes (friend) and Python bindings
@@ -96,6 +113,18 @@ protected:
   /// would leave its ActivityImpl alive in the kernel, still consuming resources, with no handle left to wait on it.
   static void drain(sg4::ActivitySet& activities);
 
+  /// Simulate the gathering of the metadata put by all the publishers in the current transaction, along a tree whose
+  /// arity is set on the Stream. Each publisher must call it when ending a transaction. No-op if the Stream does not
+  /// simulate the aggregation of metadata.
+  void aggregate_metadata();
+  /// Unregister a publisher that closes the Engine. The publishers that opened it later move down one rank.
+  void remove_publisher(sg4::ActorPtr actor);
+  /// Unregister a subscriber that closes the Engine, and drop what it cached in the Variables of the Stream.
+  void remove_subscriber(sg4::ActorPtr actor);
+
+  /// Record the number of transactions completed by the publishers and not yet read by all the subscribers.
+  void record_staging_queue_occupancy(unsigned int num_transactions);
+
   void close_stream() const;
   [[nodiscard]] std::shared_ptr<Stream> get_stream() const { return stream_.lock(); }
   void set_transport(std::shared_ptr<Transport> transport) noexcept { transport_ = transport; }
@@ -122,6 +151,7 @@ protected:
   // Pure virtual methods for derived classes to implement
   virtual void create_transport(const Transport::Method& transport_method) = 0;
   virtual void begin_pub_transaction() = 0;
+  virtual void perform_pub_puts()      = 0;
   virtual void end_pub_transaction()   = 0;
   virtual void pub_close()                                                 = 0;
   virtual void begin_sub_transaction() = 0;
@@ -157,6 +187,13 @@ public:
   /// @param simulated_size_in_bytes The simulated size of the Variable (can be different of actual size)
   void put(const std::shared_ptr<Variable>& var, size_t simulated_size_in_bytes) const;
 
+  /// @brief Write out the data put so far in the current transaction, without waiting for its end.
+  ///
+  /// With an Engine::Type::File, the writes of the puts made by the calling publisher since the beginning of the
+  /// transaction, or since its last call to this function, start right away. They form a single write if the Stream
+  /// buffers the puts (see Stream::set_put_buffer_capacity()). No-op for subscribers and for Staging engines.
+  void perform_puts();
+
   /// @brief Get a Variable from the DTL
   /// @param var The Variable to get in the DTL (Have to do an Inquire first).
   void get(const std::shared_ptr<Variable>& var) const;
@@ -174,6 +211,21 @@ public:
   /// @note Must be called from an external actor not participating in the transaction.
   void cancel_transaction(unsigned int transaction_id);
 
+  /// @brief Get the number of transactions that the publishers of a Staging engine have completed and that not all
+  ///        the subscribers have read yet, including the one they are reading.
+  /// @return The occupancy of the staging queue, always 0 for a File engine.
+  [[nodiscard]] unsigned int get_staging_queue_occupancy() const noexcept
+  {
+    return staging_queue_history_.empty() ? 0 : staging_queue_history_.back().second;
+  }
+
+  /// @brief Get the occupancy of the staging queue over time.
+  /// @return The (date, number of transactions) pairs recorded each time a transaction enters or leaves the queue.
+  [[nodiscard]] const std::vector<std::pair<double, unsigned int>>& get_staging_queue_history() const noexcept
+  {
+    return staging_queue_history_;
+  }
+
   /// @brief Close the Engine associated to a Stream.
   void close();
 };
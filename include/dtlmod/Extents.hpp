@@ -0,0 +1,99 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_EXTENTS_HPP__
+#define __DTLMOD_EXTENTS_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace dtlmod {
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief The start or the count of a region of a Variable, with one value per dimension.
+///
+/// Variables seldom have more than 4 dimensions. Up to that, values are stored inline, so that building or copying the
+/// start and count of a region on the put and get paths does not allocate. Extents of more dimensions are stored on the
+/// heap. They convert from and to std::vector<size_t>, which the public API keeps using.
+class Extents {
+public:
+  static constexpr size_t INLINE_CAPACITY = 4;
+
+private:
+  size_t size_ = 0;
+  std::array<size_t, INLINE_CAPACITY> inline_values_{};
+  std::vector<size_t> heap_values_; // only used beyond INLINE_CAPACITY dimensions
+
+  [[nodiscard]] bool is_inline() const noexcept { return size_ <= INLINE_CAPACITY; }
+
+public:
+  using value_type     = size_t;
+  using iterator       = size_t*;
+  using const_iterator = const size_t*;
+
+  Extents() = default;
+  Extents(const Extents&)            = default;
+  Extents& operator=(const Extents&) = default;
+  // A moved-from Extents is left empty: its heap values are gone, so it cannot keep a size beyond INLINE_CAPACITY
+  Extents(Extents&& other) noexcept
+      : size_(std::exchange(other.size_, 0))
+      , inline_values_(other.inline_values_)
+      , heap_values_(std::move(other.heap_values_))
+  {
+  }
+  Extents& operator=(Extents&& other) noexcept
+  {
+    if (this != &other) {
+      size_          = std::exchange(other.size_, 0);
+      inline_values_ = other.inline_values_;
+      heap_values_   = std::move(other.heap_values_);
+    }
+    return *this;
+  }
+  explicit Extents(size_t size, size_t value = 0) : size_(size)
+  {
+    if (is_inline())
+      std::fill_n(inline_values_.begin(), size_, value);
+    else
+      heap_values_.assign(size_, value);
+  }
+  Extents(const size_t* first, const size_t* last) : Extents(static_cast<size_t>(last - first))
+  {
+    std::copy(first, last, begin());
+  }
+  Extents(std::initializer_list<size_t> values) : Extents(values.begin(), values.end()) {}
+  // Implicit, so that std::vector<size_t> can be given wherever Extents are expected
+  Extents(const std::vector<size_t>& values) : Extents(values.data(), values.data() + values.size()) {}
+
+  operator std::vector<size_t>() const { return {begin(), end()}; }
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+  [[nodiscard]] size_t* data() noexcept { return is_inline() ? inline_values_.data() : heap_values_.data(); }
+  [[nodiscard]] const size_t* data() const noexcept
+  {
+    return is_inline() ? inline_values_.data() : heap_values_.data();
+  }
+  [[nodiscard]] iterator begin() noexcept { return data(); }
+  [[nodiscard]] iterator end() noexcept { return data() + size_; }
+  [[nodiscard]] const_iterator begin() const noexcept { return data(); }
+  [[nodiscard]] const_iterator end() const noexcept { return data() + size_; }
+  size_t& operator[](size_t i) noexcept { return data()[i]; }
+  const size_t& operator[](size_t i) const noexcept { return data()[i]; }
+
+  friend bool operator==(const Extents& a, const Extents& b) noexcept
+  {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+  }
+  friend bool operator!=(const Extents& a, const Extents& b) noexcept { return not(a == b); }
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
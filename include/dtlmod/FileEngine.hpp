@@ -13,6 +13,7 @@
 
 #include "dtlmod/Engine.hpp"
 #include "dtlmod/FileTransport.hpp"
+#include "dtlmod/MetadataReader.hpp"
 #include "dtlmod/Variable.hpp"
 
 XBT_LOG_EXTERNAL_CATEGORY(dtlmod);
@@ -30,21 +31,30 @@ class FileEngine : public Engine {
   std::string working_directory_;
   std::string dataset_;
   sg4::ConditionVariablePtr pub_activities_completed_ = sg4::ConditionVariable::create();
-  std::unordered_map<sg4::ActorPtr, sg4::ActivitySet> file_sub_transaction_;
-  std::unordered_map<sg4::ActorPtr, sg4::ActivitySet> file_pub_transaction_;
+  ActorSlotMap<sg4::ActivitySet> file_sub_transaction_;
+  ActorSlotMap<sg4::ActivitySet> file_pub_transaction_;
   unsigned int current_pub_transaction_id_             = 0;
   unsigned int completed_pub_transaction_id_           = 0;
   bool pub_transaction_in_progress_                    = false;
   sg4::ConditionVariablePtr pub_transaction_completed_ = sg4::ConditionVariable::create();
 
+  std::shared_ptr<sgfs::File> metadata_index_file_; // opened by the publishers when metadata I/O is simulated
+
   unsigned int current_sub_transaction_id_ = 0;
   bool sub_transaction_in_progress_        = false;
   unsigned int subs_completed_current_tx_  = 0;
 
   void create_transport(const Transport::Method& transport_method) override;
+  void import_metadata(const MetadataReader& reader, unsigned int last_transaction);
+  [[nodiscard]] std::vector<uint64_t> get_file_sizes() const;
   [[nodiscard]] const std::shared_ptr<sgfs::FileSystem>& get_file_system() const noexcept { return file_system_; }
   [[nodiscard]] std::string get_path_to_dataset() const;
+  [[nodiscard]] std::string get_path_to_metadata_index() const { return get_path_to_dataset() + "md.idx"; }
+  void write_metadata_index(sg4::ActorPtr self, unsigned int transaction_id);
+  void read_metadata_index(sg4::ActorPtr self, unsigned int begin, unsigned int count);
+  void read_selected_metadata_index(sg4::ActorPtr self, const Variable& var);
   void begin_pub_transaction() override;
+  void perform_pub_puts() override;
   void end_pub_transaction() override;
   void pub_close() override;
   void begin_sub_transaction() override;
@@ -20,22 +20,41 @@ class FileTransport : public Transport {
   using Transport::Transport;
   friend class Engine;
   friend class FileEngine;
-  std::unordered_map<sg4::ActorPtr, std::shared_ptr<sgfs::File>> publishers_to_files_;
-  std::unordered_map<sg4::ActorPtr, std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>>
-      to_write_in_transaction_;
-  std::unordered_map<sg4::ActorPtr, std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>>
-      to_read_in_transaction_;
+  ActorSlotMap<std::shared_ptr<sgfs::File>> publishers_to_files_;
+  ActorSlotMap<LocationId> publishers_to_locations_; // interned path of publishers_to_files_
+  ActorSlotMap<std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>> to_write_in_transaction_;
+  ActorSlotMap<std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>> to_read_in_transaction_;
+  ActorSlotMap<sg_size_t> put_buffers_; // bytes put but not queued for writing yet, when the Stream buffers puts
 
 protected:
   void add_publisher(unsigned long publisher_id) override;
   void close_pub_files() const;
+  // Forget the files of the publishers once their sizes are exported
+  void clear_pub_files() noexcept
+  {
+    publishers_to_files_.clear();
+    publishers_to_locations_.clear();
+  }
   void close_sub_files(sg4::ActorPtr self);
   const std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>&
   get_to_write_in_transaction_by_actor(sg4::ActorPtr actor)
   {
     return to_write_in_transaction_[actor];
   }
-  void clear_to_write_in_transaction(sg4::ActorPtr actor) noexcept { to_write_in_transaction_[actor].clear(); }
+  void clear_to_write_in_transaction(sg4::ActorPtr actor) noexcept
+  {
+    to_write_in_transaction_[actor].clear();
+    put_buffers_.erase(actor);
+  }
+  // Erase the transfers and buffer of an actor that closes the Engine. Its file is kept until close_pub_files().
+  void remove_actor(sg4::ActorPtr actor) noexcept
+  {
+    to_write_in_transaction_.erase(actor);
+    to_read_in_transaction_.erase(actor);
+    put_buffers_.erase(actor);
+  }
+  // Queue what the put buffer of that publisher holds as a single write, and empty the buffer
+  void flush_put_buffer(sg4::ActorPtr actor);
 
   const std::vector<std::pair<std::shared_ptr<sgfs::File>, sg_size_t>>&
   get_to_read_in_transaction_by_actor(sg4::ActorPtr actor) noexcept
@@ -47,6 +66,7 @@ protected:
 public:
   void put(const std::shared_ptr<Variable>& var, size_t size) override;
   void get(const std::shared_ptr<Variable>& var) override;
+  void add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const override;
 };
 /// \endcond
 
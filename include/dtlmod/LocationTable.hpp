@@ -0,0 +1,52 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_LOCATION_TABLE_HPP__
+#define __DTLMOD_LOCATION_TABLE_HPP__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dtlmod {
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// Compact identifier of a location: a file written by a publisher (File engine) or a publisher (Staging engine).
+using LocationId = unsigned int;
+
+/// @brief Stream-wide intern table of locations.
+///
+/// Each location string is stored once per Stream. Metadata blocks, the blocks to get returned to transports, and
+/// the rendez-vous points of the Staging engine only carry LocationIds, which are resolved to strings when logging,
+/// opening a file, or exporting metadata.
+class LocationTable {
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, LocationId> ids_;
+
+public:
+  LocationId intern(const std::string& location)
+  {
+    auto [it, inserted] = ids_.try_emplace(location, static_cast<LocationId>(names_.size()));
+    if (inserted)
+      names_.push_back(location);
+    return it->second;
+  }
+
+  [[nodiscard]] const std::string& get_name(LocationId id) const { return names_.at(id); }
+  [[nodiscard]] const char* get_cname(LocationId id) const { return names_.at(id).c_str(); }
+  [[nodiscard]] size_t size() const noexcept { return names_.size(); }
+
+  [[nodiscard]] size_t get_memory_footprint() const noexcept
+  {
+    size_t footprint = sizeof(LocationTable) + names_.capacity() * sizeof(std::string);
+    for (const auto& name : names_) // each name is stored in the vector and as a key of the map
+      footprint += 2 * name.capacity() + sizeof(std::string) + sizeof(LocationId) + 2 * sizeof(void*);
+    return footprint;
+  }
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
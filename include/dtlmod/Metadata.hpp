@@ -6,55 +6,245 @@
 #ifndef __DTLMOD_METADATA_HPP__
 #define __DTLMOD_METADATA_HPP__
 
-#include <fstream>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <fsmod/File.hpp>
 #include <simgrid/s4u/Actor.hpp>
 
+#include "dtlmod/BlockIndex.hpp"
+#include "dtlmod/Extents.hpp"
+#include "dtlmod/LocationTable.hpp"
+#include "dtlmod/MetadataSpillStore.hpp"
+
 namespace sg4 = simgrid::s4u;
 
 XBT_LOG_EXTERNAL_CATEGORY(dtlmod);
 
 namespace dtlmod {
 
+class BinaryMetadataWriter;
+class MetadataJournal;
+class MetadataReader;
 class Variable;
 
+/// @brief The smallest and largest values held by a block of a Variable.
+using ValueRange = std::pair<double, double>;
+
 /// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief Packed description of the blocks written in a transaction.
+///
+/// Block i spans [i * ndims, (i + 1) * ndims) in both the start and count arrays, and refers to its location through
+/// its id in the LocationTable of the Stream and to its publisher through a small index into a table of the owning
+/// Metadata. This costs a handful of words per block, where a map of vector pairs costs two heap allocations, a string
+/// and a tree node.
+///
+/// Blocks are appended in arrival order. Before being read, a table is sealed: blocks are sorted by (start, count) and
+/// a block written twice at the same place only keeps its last occurrence. The blocks of local and joined arrays have
+/// no place of their own: they are sorted by the rank of their writer instead, and each writer keeps its last block.
+/// Large sealed tables are searched through a BlockIndex, built on first use. A sealed table is a block layout that
+/// several transactions can share.
+///
+/// Publishers can attach the range of the values of a block to it. These statistics are only stored once a block of
+/// the table has some, blocks without statistics being then considered as holding any value.
+class BlockTable {
+  friend MetadataSpillStore;
+  static constexpr size_t MIN_BLOCKS_TO_INDEX = 64; // below that, a linear scan is as fast as walking a tree
+
+  size_t ndims_ = 0;
+  std::vector<size_t> starts_;
+  std::vector<size_t> counts_;
+  std::vector<LocationId> location_ids_;
+  std::vector<unsigned int> publisher_ids_;
+  std::vector<double> value_mins_; // empty when no block has value statistics
+  std::vector<double> value_maxs_;
+  bool sealed_ = true;
+  mutable std::shared_ptr<const BlockIndex> index_;
+  mutable std::optional<size_t> fingerprint_; // computed on first use, as tables are shared by many transactions
+
+  template <typename SamePlace> void keep_in_order(const std::vector<size_t>& order, SamePlace same_place);
+
+public:
+  void add(const Extents& start, const Extents& count, LocationId location_id, unsigned int publisher_id,
+           const std::optional<ValueRange>& value_range = std::nullopt);
+  void seal();
+  /// Seal the table, ordering the blocks by writer_ranks[publisher id] rather than by position
+  void seal_in_writer_order(const std::vector<size_t>& writer_ranks);
+  /// Seal the table, keeping the blocks in the order in which they were added, as when they are read from a table that
+  /// was already sealed in writer order
+  void seal_as_added() noexcept { sealed_ = true; }
+  /// Lay the blocks of a sealed table end to end along dimension 'dim', in their order, and return their total extent
+  size_t join(size_t dim);
+  void build_index() const;
+  /// Append to 'hits' the ids of the blocks that share at least one element with the box [start, start + count), in
+  /// increasing order. The table must be sealed.
+  void find_intersecting_blocks(const Extents& start, const Extents& count, std::vector<size_t>& hits) const;
+  /// Number of elements that a block shares with the box [start, start + count), 0 if they do not intersect. With a
+  /// (non-empty) stride, only count the elements of the box at start + k * stride in each dimension.
+  [[nodiscard]] size_t get_overlap_volume(const Extents& start, const Extents& count, const Extents& stride,
+                                          size_t block) const noexcept;
+  /// Number of contiguous runs of elements that a block stores for its (non-empty) intersection with the box
+  /// [start, start + count), with an optional stride. Blocks are stored in row-major order: the intersection is a
+  /// single run only if it spans whole rows of the block in all dimensions but its outermost partial one.
+  [[nodiscard]] size_t get_num_contiguous_runs(const Extents& start, const Extents& count, const Extents& stride,
+                                               size_t block) const noexcept;
+
+  [[nodiscard]] bool is_sealed() const noexcept { return sealed_; }
+  /// Whether two tables describe the same blocks, at the same locations, written by the same publishers
+  [[nodiscard]] bool has_same_layout(const BlockTable& other) const noexcept;
+  /// A hash of what has_same_layout() compares: tables with the same layout have the same fingerprint
+  [[nodiscard]] size_t get_layout_fingerprint() const noexcept;
+  [[nodiscard]] size_t size() const noexcept { return location_ids_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return location_ids_.empty(); }
+  [[nodiscard]] size_t get_num_dims() const noexcept { return ndims_; }
+  [[nodiscard]] const size_t* get_start(size_t block) const noexcept { return starts_.data() + block * ndims_; }
+  [[nodiscard]] const size_t* get_count(size_t block) const noexcept { return counts_.data() + block * ndims_; }
+  [[nodiscard]] LocationId get_location_id(size_t block) const noexcept { return location_ids_[block]; }
+  [[nodiscard]] unsigned int get_publisher_id(size_t block) const noexcept { return publisher_ids_[block]; }
+  [[nodiscard]] bool has_value_ranges() const noexcept { return not value_mins_.empty(); }
+  /// Whether a block may hold values in 'range'. Blocks without statistics may hold any value.
+  [[nodiscard]] bool may_hold_values_in(size_t block, const ValueRange& range) const noexcept
+  {
+    return value_mins_.empty() || (value_mins_[block] <= range.second && range.first <= value_maxs_[block]);
+  }
+  [[nodiscard]] size_t get_memory_footprint() const noexcept;
+};
+
 class Metadata {
   friend Variable;
   std::weak_ptr<Variable> variable_;
 
-  std::map<unsigned int,                                                 // Transaction id
-           std::map<std::pair<std::vector<size_t>, std::vector<size_t>>, // starts and counts
-                    std::pair<std::string, sg4::ActorPtr>,               // filename and publisher
-                    std::less<>>,
-           std::less<>>
-      transaction_infos_;
+  // Transaction id -> blocks. Consecutive transactions that write the same blocks share one sealed table, so that
+  // memory grows with the number of distinct layouts rather than with the number of transactions.
+  std::map<unsigned int, std::shared_ptr<BlockTable>, std::less<>> transaction_infos_;
+  std::shared_ptr<BlockTable> last_layout_; // most recently sealed layout, kept even if its transactions are evicted
+  // Shape of the Variable from each transaction in which it changed on, kept when transactions are evicted or spilled
+  std::map<unsigned int, std::vector<size_t>, std::less<>> shapes_;
+
+  // Locations (file names or publisher names) are interned once per Stream, and publishers once per Variable. Blocks
+  // only store their index in these tables.
+  std::shared_ptr<LocationTable> locations_;
+  std::vector<sg4::ActorPtr> publishers_;
+  std::unordered_map<const sg4::Actor*, unsigned int> publisher_ids_;
+
+  unsigned int flushed_count_ = 0; // number of transactions already flushed to the journal or binary file
+
+  // When the blocks come from a metadata file exported by a previous simulation, they are read one transaction at a
+  // time from that file. Blocks read from a file have no publisher (they all refer to publisher 0).
+  std::shared_ptr<const MetadataReader> reader_;
+  size_t reader_variable_ = 0;
+  std::shared_ptr<const std::vector<LocationId>> reader_locations_; // location id in the file -> in the LocationTable
+  unsigned int imported_transaction_ = 0;                          // last transaction made visible to subscribers
 
-  unsigned int flushed_count_ = 0; // number of transactions already flushed to the prog file
+  // Sealed transactions moved out of memory to keep the Stream within its metadata memory budget. They are read back
+  // from the spill store when selected or exported. The last table written to or read from the store is remembered, so
+  // that transactions sharing a layout only write it once and reload it without any I/O while it is still in memory.
+  std::shared_ptr<MetadataSpillStore> spill_store_;
+  std::map<unsigned int, MetadataSpillStore::Record, std::less<>> spilled_;
+  std::weak_ptr<BlockTable> cached_layout_;
+  MetadataSpillStore::Record cached_record_{};
+
+  unsigned int get_publisher_id(sg4::ActorPtr publisher);
+  // Rank of the publisher of each id, by which the blocks of local and joined arrays are ordered
+  std::vector<size_t> get_writer_ranks(const Variable& var) const;
+  void write_transaction_header(std::ostream& ostream, unsigned int tx_id) const;
+  void write_block_entries(std::ostream& ostream, const BlockTable& blocks) const;
+  const BlockTable& seal(std::shared_ptr<BlockTable>& blocks);
+  decltype(transaction_infos_)::iterator read_transaction(unsigned int id);
+  decltype(transaction_infos_)::iterator reload_transaction(decltype(spilled_)::const_iterator spilled);
+  decltype(transaction_infos_)::iterator find_transaction(unsigned int id);
+  // The newest sealed transaction in memory, which subscribers are about to read
+  decltype(transaction_infos_)::const_iterator find_latest_sealed_transaction() const;
+  template <typename F> void for_each_transaction(F&& f);
 
 protected:
-  const std::map<std::pair<std::vector<size_t>, std::vector<size_t>>, std::pair<std::string, sg4::ActorPtr>,
-                 std::less<>>&
-  get_blocks_for_transaction(unsigned int id)
-  {
-    return transaction_infos_[id];
-  }
-  void add_transaction(unsigned int id, const std::pair<std::vector<size_t>, std::vector<size_t>>& start_and_count,
-                       const std::string& filename, sg4::ActorPtr publisher);
+  const BlockTable& get_blocks_for_transaction(unsigned int id);
+  // Same, as the sealed table shared by the transactions with that layout, or nullptr if there is no such transaction
+  std::shared_ptr<const BlockTable> get_layout(unsigned int id);
+  void add_transaction(unsigned int id, const std::pair<Extents, Extents>& start_and_count, LocationId location,
+                       sg4::ActorPtr publisher,
+                       const std::optional<ValueRange>& value_range = std::nullopt);
 
 public:
-  explicit Metadata(const std::shared_ptr<Variable>& variable) noexcept : variable_(variable) {}
+  Metadata(const std::shared_ptr<Variable>& variable, std::shared_ptr<LocationTable> locations) noexcept
+      : variable_(variable), locations_(std::move(locations))
+  {
+  }
   unsigned int get_current_transaction() const noexcept
   {
-    return transaction_infos_.empty() ? 0 : (transaction_infos_.rbegin())->first;
+    if (reader_)
+      return imported_transaction_;
+    unsigned int current = transaction_infos_.empty() ? 0 : (transaction_infos_.rbegin())->first;
+    if (!spilled_.empty())
+      current = std::max(current, spilled_.rbegin()->first);
+    return current;
+  }
+  [[nodiscard]] const std::shared_ptr<LocationTable>& get_locations() const noexcept { return locations_; }
+  [[nodiscard]] const std::string& get_location(LocationId location_id) const
+  {
+    return locations_->get_name(location_id);
+  }
+  [[nodiscard]] const sg4::ActorPtr& get_publisher(unsigned int publisher_id) const
+  {
+    return publishers_.at(publisher_id);
+  }
+  // Record the shape of the Variable in transaction tx_id, if it differs from that of the previous transactions
+  void record_shape(unsigned int tx_id, const std::vector<size_t>& shape);
+  // Shape of the Variable in transaction tx_id. Transactions before the first recorded shape, or imported from a file,
+  // use the shape the Variable has now.
+  [[nodiscard]] std::vector<size_t> get_shape(unsigned int tx_id) const;
+  [[nodiscard]] const std::map<unsigned int, std::vector<size_t>, std::less<>>& get_shapes() const noexcept
+  {
+    return shapes_;
+  }
+  // Sort the blocks of a complete transaction and index them, so that the first selection does not pay for it
+  void seal_transaction(unsigned int tx_id);
+  // Number of distinct block layouts among the transactions held in memory
+  [[nodiscard]] size_t get_num_layouts() const;
+  // Approximate number of bytes used on the host by the block tables and the publisher table. The location table is
+  // shared by the Stream and not included.
+  [[nodiscard]] size_t get_memory_footprint() const noexcept;
+  // Add the approximate number of bytes used by the blocks of each transaction held in memory to footprints. A layout
+  // shared by several transactions is counted for the first of them.
+  void add_transaction_footprints(std::map<unsigned int, size_t, std::less<>>& footprints) const;
+  // Number of bytes taken by the blocks of tx_id in an on-disk index, laid out as in the binary export format
+  [[nodiscard]] size_t get_index_size(unsigned int tx_id);
+  // Number of bytes describing one block of a Variable with num_dims dimensions: its start, count, and location id
+  [[nodiscard]] static constexpr size_t get_index_entry_size(size_t num_dims) noexcept
+  {
+    return 2 * num_dims * sizeof(uint64_t) + sizeof(uint32_t);
   }
-  // Write entries for tx_id to out, increment flushed_count_, erase from transaction_infos_
-  void write_transaction_to_stream(unsigned int tx_id, std::ofstream& out);
+  // Write entries for tx_id to the journal, increment flushed_count_, erase from transaction_infos_
+  void write_transaction_to_journal(unsigned int tx_id, MetadataJournal& journal);
   // Remove tx_id from transaction_infos_ without writing to file
   void evict_transaction(unsigned int tx_id);
-  // Write all remaining transactions; prog_file_path contains already-flushed entries to prepend
-  void export_to_file(std::ofstream& ostream, const std::string& prog_file_path = "") const;
+  // Ids of the transactions held in memory, and of all the transactions held in memory or spilled, in increasing order
+  [[nodiscard]] std::vector<unsigned int> get_resident_transaction_ids() const;
+  [[nodiscard]] std::vector<unsigned int> get_transaction_ids() const;
+  // Approximate number of bytes that moving the sealed transactions held in memory to the spill store would free. The
+  // newest sealed transaction, the last layout, and the publisher and shape tables always stay in memory.
+  [[nodiscard]] size_t get_spillable_footprint() const noexcept;
+  // Move the blocks of a sealed transaction to the spill store and return the approximate number of bytes freed. The
+  // newest sealed transaction is never moved.
+  size_t spill_transaction(unsigned int tx_id, const std::shared_ptr<MetadataSpillStore>& store);
+  // Number of transactions whose blocks are in the spill store
+  [[nodiscard]] size_t get_num_spilled_transactions() const noexcept { return spilled_.size(); }
+  // Write all remaining transactions, after the entries already flushed to the journal (if any)
+  void export_to_file(std::ostream& ostream, MetadataJournal* journal = nullptr);
+  // Binary counterparts of write_transaction_to_journal and export_to_file
+  void write_transaction_to_binary(unsigned int tx_id, BinaryMetadataWriter& writer);
+  void export_to_binary(BinaryMetadataWriter& writer);
+  // Read the blocks of this Metadata from variable 'var' of an exported file rather than from publishers
+  void import_from(std::shared_ptr<const MetadataReader> reader, size_t var,
+                   std::shared_ptr<const std::vector<LocationId>> location_ids);
+  // Make transaction tx_id of the imported file visible to subscribers and read its blocks
+  void load_transaction(unsigned int tx_id);
 };
 /// \endcond
 
@@ -0,0 +1,62 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_METADATA_JOURNAL_HPP__
+#define __DTLMOD_METADATA_JOURNAL_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dtlmod {
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief Holds the text metadata entries of the transactions flushed before a Stream exports its metadata file.
+///
+/// Entries are buffered in memory per variable. When the buffers of all the variables exceed FLUSH_THRESHOLD bytes,
+/// each non-empty buffer is appended to a single journal file as one segment, and the buffers are cleared. The file is
+/// opened on the first flush and stays open until discard() is called, so that flushing a transaction costs no system
+/// call at all most of the time.
+class MetadataJournal {
+  struct Segment {
+    uint64_t offset;
+    uint64_t size;
+  };
+  struct VariableEntries {
+    std::ostringstream pending;
+    std::vector<Segment> segments;
+  };
+
+  std::string path_;
+  std::ofstream out_;
+  uint64_t offset_ = 0;
+  std::map<std::string, VariableEntries, std::less<>> variables_;
+
+public:
+  static constexpr uint64_t FLUSH_THRESHOLD = 4 * 1024 * 1024;
+
+  explicit MetadataJournal(std::string path) : path_(std::move(path)) {}
+
+  [[nodiscard]] const std::string& get_path() const noexcept { return path_; }
+  /// Get the in-memory buffer in which to write the entries of a variable.
+  std::ostream& get_entries(const std::string& var_name) { return variables_[var_name].pending; }
+  /// Append the buffered entries to the journal file if they exceed FLUSH_THRESHOLD bytes.
+  void flush_if_needed();
+  /// Append the buffered entries to the journal file.
+  void flush();
+  /// Copy all the entries of a variable, in the order they were written, to out.
+  void copy_entries(const std::string& var_name, std::ostream& out);
+  /// Close and remove the journal file, and drop the buffered entries.
+  void discard();
+  /// Get the approximate number of bytes used by the buffered entries and the segment tables.
+  [[nodiscard]] size_t get_memory_footprint();
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
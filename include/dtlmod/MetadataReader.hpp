@@ -0,0 +1,101 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_METADATA_READER_HPP__
+#define __DTLMOD_METADATA_READER_HPP__
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "dtlmod/BinaryMetadata.hpp"
+
+namespace dtlmod {
+
+/// @brief A class to read a metadata file exported in the binary format (see Stream::MetadataFormat).
+///
+/// The file is memory-mapped and nothing is parsed when it is opened: looking up a variable by name or the blocks of
+/// one transaction only touches the pages that hold them.
+class MetadataReader {
+  const char* data_ = nullptr;
+  size_t size_      = 0;
+
+  const binary_metadata::Header* header_                  = nullptr;
+  const binary_metadata::VariableRecord* variables_       = nullptr;
+  const binary_metadata::TransactionRecord* transactions_ = nullptr;
+  const uint64_t* location_sizes_                         = nullptr;
+  const uint64_t* string_offsets_                         = nullptr;
+  const char* string_chars_                               = nullptr;
+  uint64_t num_strings_                                   = 0;
+
+  template <typename T> const T* at(uint64_t offset, uint64_t count) const;
+  [[nodiscard]] std::string_view get_string(uint64_t index) const;
+  [[nodiscard]] const binary_metadata::VariableRecord& get_variable(size_t var) const;
+  [[nodiscard]] const binary_metadata::TransactionRecord*
+  get_transactions(const binary_metadata::VariableRecord& record) const;
+
+public:
+  /// @brief A view on the blocks written in one transaction of a variable. Pointers are into the mapped file.
+  struct Blocks {
+    size_t num_dims;
+    size_t num_blocks;
+    const uint64_t* starts;    // num_blocks * num_dims values
+    const uint64_t* counts;    // num_blocks * num_dims values
+    const uint32_t* locations; // num_blocks location ids, see get_location()
+
+    [[nodiscard]] const uint64_t* get_start(size_t block) const noexcept { return starts + block * num_dims; }
+    [[nodiscard]] const uint64_t* get_count(size_t block) const noexcept { return counts + block * num_dims; }
+    [[nodiscard]] uint32_t get_location_id(size_t block) const noexcept { return locations[block]; }
+  };
+
+  /// @brief Map a binary metadata file in memory.
+  /// @param path the path of the file, as returned by Stream::get_metadata_file_name().
+  /// @throws InvalidMetadataFileException if the file cannot be opened or is not a valid binary metadata file.
+  explicit MetadataReader(const std::string& path);
+  ~MetadataReader();
+  MetadataReader(const MetadataReader&)            = delete;
+  MetadataReader& operator=(const MetadataReader&) = delete;
+
+  /// @brief Get the number of variables described in the file.
+  [[nodiscard]] size_t get_num_variables() const noexcept { return header_->num_variables; }
+  /// @brief Get the index of a variable from its name.
+  /// @return The index of the variable, or std::nullopt if the file does not describe it.
+  [[nodiscard]] std::optional<size_t> find_variable(std::string_view name) const;
+  /// @brief Get the name of a variable.
+  [[nodiscard]] std::string_view get_variable_name(size_t var) const;
+  /// @brief Get the size of the elements of a variable.
+  [[nodiscard]] size_t get_element_size(size_t var) const;
+  /// @brief Get the shape of a variable.
+  [[nodiscard]] std::vector<size_t> get_shape(size_t var) const;
+  /// @brief Get the shapes a variable had over time.
+  /// @return The id of each transaction in which the shape of the variable changed and the shape it had from this
+  ///         transaction on, in increasing order of transaction id. Transactions before the first of them have the
+  ///         shape returned by get_shape().
+  [[nodiscard]] std::vector<std::pair<unsigned int, std::vector<size_t>>> get_shape_changes(size_t var) const;
+  /// @brief Get the kind of a variable.
+  /// @return The value of its Variable::Kind.
+  [[nodiscard]] unsigned int get_kind(size_t var) const;
+  /// @brief Get the dimension along which the arrays of the publishers of a joined array are laid end to end.
+  [[nodiscard]] size_t get_joined_dimension(size_t var) const;
+  /// @brief Get the ids of the transactions recorded for a variable, in increasing order.
+  [[nodiscard]] std::vector<unsigned int> get_transaction_ids(size_t var) const;
+  /// @brief Get the blocks written in one transaction of a variable.
+  /// @return A view on the blocks, or std::nullopt if this transaction is not recorded for the variable.
+  [[nodiscard]] std::optional<Blocks> get_blocks(size_t var, unsigned int transaction_id) const;
+
+  /// @brief Get the number of distinct locations (files or publishers) referred to by the blocks.
+  [[nodiscard]] size_t get_num_locations() const noexcept { return header_->num_locations; }
+  /// @brief Get a location from the id stored in a block.
+  [[nodiscard]] std::string_view get_location(uint32_t location_id) const;
+  /// @brief Get the size of the file written at a location by a File engine.
+  /// @return The size in bytes, or 0 if the location is not a file.
+  [[nodiscard]] uint64_t get_location_size(uint32_t location_id) const;
+};
+
+} // namespace dtlmod
+#endif
@@ -0,0 +1,57 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#ifndef __DTLMOD_METADATA_SPILL_STORE_HPP__
+#define __DTLMOD_METADATA_SPILL_STORE_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace dtlmod {
+
+class BlockTable;
+
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+/// @brief On-disk store for the sealed block tables that a Stream moves out of memory to stay within its metadata
+/// memory budget (see Stream::set_metadata_memory_budget()).
+///
+/// Tables are appended to a single scratch file as they are stored in memory (starts, counts, location ids, publisher
+/// ids, and value statistics if any) and read back in one call each. The file is created on the first write and
+/// removed when the store is destroyed.
+class MetadataSpillStore {
+public:
+  /// Where a block table is in the store
+  struct Record {
+    uint64_t offset;
+    uint64_t num_blocks;
+    uint32_t num_dims;
+    uint32_t has_value_ranges;
+  };
+
+private:
+  std::string path_;
+  std::fstream file_;
+  uint64_t size_ = 0;
+
+public:
+  explicit MetadataSpillStore(std::string path) : path_(std::move(path)) {}
+  ~MetadataSpillStore();
+  MetadataSpillStore(const MetadataSpillStore&)            = delete;
+  MetadataSpillStore& operator=(const MetadataSpillStore&) = delete;
+
+  [[nodiscard]] const std::string& get_path() const noexcept { return path_; }
+  /// Number of bytes written in the store so far
+  [[nodiscard]] uint64_t get_size() const noexcept { return size_; }
+  /// Append a sealed block table to the store
+  Record write(const BlockTable& blocks);
+  /// Read a block table back from the store. The returned table is sealed.
+  std::shared_ptr<BlockTable> read(const Record& record);
+};
+/// \endcond
+
+} // namespace dtlmod
+#endif
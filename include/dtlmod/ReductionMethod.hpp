@@ -38,7 +38,9 @@ public:
   /// but loses accuracy (fidelity derived from the error bound), so it cannot be inferred from the reduced size.
   virtual double get_fidelity(const Variable& var, unsigned int transaction_id = 0) const                           = 0;
   virtual const std::vector<size_t>& get_reduced_variable_shape(const Variable& var) const                          = 0;
-  virtual const std::pair<std::vector<size_t>, std::vector<size_t>>&
+  /// @brief Stride with which a subscriber that reduces the Variable reads it, empty if it reads every element.
+  virtual std::vector<size_t> get_read_stride(const Variable& /*var*/) const { return {}; }
+  virtual std::pair<std::vector<size_t>, std::vector<size_t>>
   get_reduced_start_and_count_for(const Variable& var, simgrid::s4u::ActorPtr publisher) const = 0;
   virtual double get_flop_amount_to_reduce_variable(const Variable& var) const                 = 0;
   virtual double get_flop_amount_to_decompress_variable(const Variable& /*var*/) const { return 0.0; }
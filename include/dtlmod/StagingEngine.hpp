@@ -7,6 +7,7 @@
 #define __DTLMOD_ENGINE_STAGING_HPP__
 
 #include <atomic>
+#include <unordered_map>
 
 #include "dtlmod/Engine.hpp"
 
@@ -29,11 +30,21 @@ class StagingEngine : public Engine {
   bool pub_transaction_in_progress_                        = false;
   sg4::ConditionVariablePtr pub_transaction_completed_     = sg4::ConditionVariable::create();
 
-  unsigned int current_sub_transaction_id_ = 0;
-  bool sub_transaction_in_progress_        = false;
+  unsigned int current_sub_transaction_id_   = 0;
+  unsigned int completed_sub_transaction_id_ = 0;
+  bool sub_transaction_in_progress_          = false;
+
+  // Actors that serve the transactions held in staging, and number of such transactions for each publisher
+  std::unordered_map<aid_t, sg4::ActorPtr> staging_servers_;
+  ActorSlotMap<unsigned int> num_staged_transactions_;
+  sg4::ConditionVariablePtr staged_transaction_served_ = sg4::ConditionVariable::create();
 
   void create_transport(const Transport::Method& transport_method) override;
+  [[nodiscard]] bool is_pub_too_far_ahead() const;
+  void stage_transaction(sg4::ActorPtr publisher, unsigned int transaction_id);
+  void release_staged_transactions();
   void begin_pub_transaction() override;
+  void perform_pub_puts() override { /* No-op: subscribers pull the data they need at the end of the transaction */ }
   void end_pub_transaction() override;
   void pub_close() override;
   void begin_sub_transaction() override;
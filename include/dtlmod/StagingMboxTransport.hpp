@@ -17,12 +17,16 @@ namespace dtlmod {
 /// \cond EXCLUDE_FROM_DOCUMENTATION
 class StagingMboxTransport : public StagingTransport {
   using StagingTransport::StagingTransport;
-  std::unordered_map<std::string, sg4::Mailbox*> mboxes_;
+  std::map<RendezVousKey, sg4::Mailbox*> mboxes_;
 
 protected:
   void create_rendez_vous_points() override;
-  void get_requests_and_do_put(sg4::ActorPtr publisher) override;
-  void get_rendez_vous_point_and_do_get(std::string_view name) override;
+  void get_requests_and_do_put(sg4::ActorPtr publisher, unsigned int transaction_id,
+                               sg4::ActivitySet& puts) override;
+  void get_rendez_vous_point_and_do_get(LocationId publisher) override;
+
+public:
+  void add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const override;
 };
 /// \endcond
 
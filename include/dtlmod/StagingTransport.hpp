@@ -15,31 +15,34 @@ namespace dtlmod {
 class StagingTransport : public Transport {
   using Transport::Transport;
   friend StagingEngine;
-  std::unordered_map<std::string, sg4::MessageQueue*> publisher_put_requests_mq_;
-  std::unordered_map<std::string, sg4::ActivitySet> pending_put_requests_;
+  std::unordered_map<aid_t, LocationId> publisher_locations_; // publisher pid -> interned publisher name
+  // Number of put requests each publisher expects from the subscribers, by transaction
+  std::unordered_map<LocationId, std::map<unsigned int, size_t>> expected_put_requests_;
 
 protected:
-  void add_publisher(unsigned long publisher_id) override;
-  virtual void create_rendez_vous_points()                               = 0;
-  virtual void get_requests_and_do_put(sg4::ActorPtr publisher)          = 0;
-  virtual void get_rendez_vous_point_and_do_get(std::string_view name)   = 0;
-
-  // Create a message queue to receive request for variable pieces from subscribers
-  void set_publisher_put_requests_mq(std::string_view publisher_name);
-  [[nodiscard]] sg4::MessageQueue* get_publisher_put_requests_mq(std::string_view publisher_name) const;
-  [[nodiscard]] bool pending_put_requests_exist_for(std::string_view pub_name)
-  {
-    return not pending_put_requests_[std::string(pub_name)].empty();
-  }
-  [[nodiscard]] sg4::ActivityPtr wait_any_pending_put_request_for(std::string_view pub_name)
-  {
-    return pending_put_requests_[std::string(pub_name)].wait_any();
-  }
+  // A rendez-vous point between a publisher and a subscriber is identified by the location of the publisher and the
+  // pid of the subscriber.
+  using RendezVousKey = std::pair<LocationId, aid_t>;
+
+  virtual void create_rendez_vous_points() = 0;
+  // Serve the put requests of the subscribers for that transaction, pushing the resulting activities to 'puts'
+  virtual void get_requests_and_do_put(sg4::ActorPtr publisher, unsigned int transaction_id,
+                                       sg4::ActivitySet& puts)        = 0;
+  virtual void get_rendez_vous_point_and_do_get(LocationId publisher) = 0;
+
+  [[nodiscard]] LocationId get_publisher_location(const sg4::Actor& publisher);
+  // Message queue on which a publisher receives the requests of the subscribers for the pieces of a transaction. Each
+  // transaction has its own, as the servers of the transactions a publisher left in staging wait for requests at the
+  // same time.
+  [[nodiscard]] sg4::MessageQueue* get_put_requests_mq(LocationId publisher, unsigned int transaction_id);
+  // Post a get for each put request that publisher expects for that transaction
+  void get_put_requests_for(LocationId publisher, unsigned int transaction_id, sg4::ActivitySet& requests);
 
 public:
   ~StagingTransport() override = default;
   void put(const std::shared_ptr<Variable>& var, size_t /*simulated_size_in_bytes*/) override;
   void get(const std::shared_ptr<Variable>& var) override;
+  void add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const override;
 };
 /// \endcond
 
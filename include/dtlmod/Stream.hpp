@@ -8,7 +8,11 @@
 
 #include <optional>
 
+#include "dtlmod/BinaryMetadataWriter.hpp"
 #include "dtlmod/Engine.hpp"
+#include "dtlmod/MetadataJournal.hpp"
+#include "dtlmod/MetadataReader.hpp"
+#include "dtlmod/MetadataSpillStore.hpp"
 #include "dtlmod/ReductionMethod.hpp"
 
 namespace dtlmod {
@@ -39,6 +43,33 @@ public:
     Subscribe = 1
   };
 
+  /// @brief An enum that defines the format of the exported metadata file
+  enum class MetadataFormat {
+    /// @brief Text. One human-readable line per block (default).
+    Text = 0,
+    /// @brief Binary. Packed block tables and a transaction index that can be read in place with a MetadataReader.
+    Binary = 1
+  };
+
+  /// @brief The approximate host memory used by DTLMod for a Stream, in bytes. Objects owned by SimGrid or FSMod (e.g.,
+  ///        activities, mailboxes, or files) are not included.
+  struct MemoryFootprint {
+    /// @brief Memory used by the metadata of each Variable, by name.
+    std::map<std::string, size_t, std::less<>> variables;
+    /// @brief Memory used by the blocks of each transaction held in memory, by id. A layout shared by several
+    ///        transactions is counted for the first of them. This is a breakdown of the metadata of the Variables.
+    std::map<unsigned int, size_t, std::less<>> transactions;
+    /// @brief Memory used by each internal structure of the Transport of the Stream, by name.
+    std::map<std::string, size_t, std::less<>> transport;
+    /// @brief Memory used by the table of locations (files or publishers) shared by all the Variables.
+    size_t locations = 0;
+    /// @brief Memory used by the text metadata buffered before being flushed to the journal file.
+    size_t journal = 0;
+
+    /// @brief Get the total memory used by the Stream (Variables, locations, journal, and Transport).
+    [[nodiscard]] size_t get_total() const noexcept;
+  };
+
 private:
   const std::string name_;
   DTL* dtl_                           = nullptr;
@@ -46,14 +77,29 @@ private:
   Engine::Type engine_type_           = Engine::Type::Undefined;
   Transport::Method transport_method_ = Transport::Method::Undefined;
   bool metadata_export_               = false;
+  MetadataFormat metadata_format_     = MetadataFormat::Text;
   std::string metadata_file_;
-  std::unordered_map<std::string, std::string> var_prog_file_paths_; // variable name -> prog file path
-  bool metadata_exported_ = false; // true once export_metadata_to_file() has been called
+  std::unique_ptr<BinaryMetadataWriter> binary_metadata_writer_;
+  std::string metadata_import_file_;
+  std::shared_ptr<const MetadataReader> metadata_reader_; // set when subscribers replay an imported metadata file
+  std::unique_ptr<MetadataJournal> metadata_journal_; // text entries of the transactions flushed before the export
+  size_t metadata_memory_budget_ = 0; // in bytes, 0 means unlimited
+  std::shared_ptr<MetadataSpillStore> metadata_spill_store_;
+  bool metadata_exported_                  = false; // true once export_metadata_to_file() has been called
+  bool metadata_io_simulation_             = false;
+  unsigned int metadata_aggregation_arity_ = 0; // 0 means that metadata reaches the Stream for free
+  size_t min_io_size_                      = 0; // in bytes, 0 means that I/O operations are not modeled
+  size_t put_buffer_capacity_              = 0; // in bytes, 0 means that each put is written on its own
+  unsigned int staging_queue_depth_        = 0; // 0 means that publishers and subscribers advance in lockstep
+  // End offset of the record of each transaction in the simulated metadata index file of a File engine, indexed by
+  // transaction id - 1. Records are appended in transaction order, so one offset per transaction locates all of them.
+  std::vector<sg_size_t> metadata_index_ends_;
   sg4::MutexPtr mutex_ = sg4::Mutex::create();
   Mode access_mode_    = Mode::Publish;
 
   std::unordered_map<std::string, std::shared_ptr<Variable>> variables_;
   std::unordered_map<std::string, std::shared_ptr<ReductionMethod>> reduction_methods_;
+  std::shared_ptr<LocationTable> locations_ = std::make_shared<LocationTable>();
 
 protected:
   /// \cond EXCLUDE_FROM_DOCUMENTATION
@@ -61,10 +107,22 @@ protected:
   {
     return (mode == Mode::Publish) ? "Mode::Publish" : "Mode::Subscribe";
   }
+  [[nodiscard]] static constexpr const char* metadata_format_to_str(MetadataFormat format) noexcept
+  {
+    return (format == MetadataFormat::Text) ? "MetadataFormat::Text" : "MetadataFormat::Binary";
+  }
+  BinaryMetadataWriter& get_binary_metadata_writer();
   void close() noexcept { engine_ = nullptr; }
 
-  void export_metadata_to_file();
+  void export_metadata_to_file(const std::vector<uint64_t>& location_sizes = {});
   void flush_and_evict_transaction(unsigned int tx_id);
+  void seal_transaction_metadata(unsigned int tx_id);
+  void enforce_metadata_memory_budget();
+  [[nodiscard]] unsigned int import_metadata_from_file();
+  sg_size_t add_metadata_index_record(unsigned int tx_id);
+  [[nodiscard]] std::pair<sg_size_t, sg_size_t> get_metadata_index_records(unsigned int begin,
+                                                                          unsigned int count) const;
+  void load_transaction_metadata(unsigned int tx_id);
 
   // Helper methods for Stream::open
   void validate_open_parameters(std::string_view name, Mode mode) const;
@@ -74,6 +132,9 @@ protected:
   // Helper method for Stream::define_variable
   static void validate_variable_parameters(const std::vector<size_t>& shape, const std::vector<size_t>& start,
                                            const std::vector<size_t>& count, size_t element_size);
+  std::shared_ptr<Variable> add_variable(std::string_view name, const std::vector<size_t>& shape,
+                                         const std::vector<size_t>& start, const std::vector<size_t>& count,
+                                         size_t element_size, Variable::Kind kind, size_t joined_dimension = 0);
   /// \endcond
 
 public:
@@ -89,6 +150,14 @@ public:
   Stream(Stream&&)                 = delete;
   Stream& operator=(Stream&&)      = delete;
   ~Stream() noexcept               = default;
+
+  [[nodiscard]] const std::shared_ptr<LocationTable>& get_location_table() const noexcept { return locations_; }
+  // Rank of a publisher in the Engine of this Stream, given in the order in which the publishers still there opened it
+  [[nodiscard]] std::optional<unsigned int> get_publisher_rank(const sg4::Actor* publisher) const
+  {
+    const auto* rank = engine_ ? engine_->publisher_ranks_.find(publisher) : nullptr;
+    return rank ? std::optional<unsigned int>(*rank) : std::nullopt;
+  }
   /// \endcond
 
   /// @brief Helper function to print out the name of the Stream.
@@ -123,6 +192,15 @@ public:
   /// @param name the name of the reduction method
   /// @return a boolean indicating if the Stream does export metadata or not
   [[nodiscard]] bool does_export_metadata() const noexcept { return metadata_export_; }
+  /// @brief Helper function to know the format in which the Stream exports metadata
+  /// @return The MetadataFormat of the Stream
+  [[nodiscard]] MetadataFormat get_metadata_export_format() const noexcept { return metadata_format_; }
+  /// @brief Helper function to print out the format in which the Stream exports metadata
+  /// @return The corresponding C-string
+  [[nodiscard]] const char* get_metadata_export_format_str() const noexcept
+  {
+    return metadata_format_to_str(metadata_format_);
+  }
 
   /// @brief Stream configuration function: set the Engine type to create.
   /// @param engine_type The type of Engine to create when opening the Stream.
@@ -138,9 +216,118 @@ public:
   /// @brief Stream configuration function: specify that metadata must not be exported
   /// @return The calling Stream (enable method chaining).
   Stream& unset_metadata_export() noexcept;
+  /// @brief Stream configuration function: set the format of the exported metadata file
+  /// @param format the MetadataFormat to use (MetadataFormat::Text by default).
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_metadata_export_format(MetadataFormat format) noexcept;
   /// @brief Get the name of the file in which the stream stores metadata
   /// @return The name of the file.
   [[nodiscard]] const std::string& get_metadata_file_name() const noexcept { return metadata_file_; }
+  /// @brief Stream configuration function: read the metadata of the Stream from a file exported by a previous
+  ///        simulation in the binary format, instead of building it from the activity of publishers.
+  ///
+  ///        The Stream must use an Engine::Type::File and can then only be opened in Mode::Subscribe. Its Variables
+  ///        are defined from the file when it is opened, and the blocks of each transaction are only read when
+  ///        subscribers reach it. The files described by the metadata are created in the simulated file system if
+  ///        they do not exist yet.
+  /// @param file_name the name of the metadata file, as returned by get_metadata_file_name() in the producer run.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_metadata_import(const std::string& file_name);
+  /// @brief Helper function to know if the Stream reads its metadata from a file
+  /// @return a boolean indicating if the Stream imports metadata or not
+  [[nodiscard]] bool does_import_metadata() const noexcept { return not metadata_import_file_.empty(); }
+  /// @brief Get the name of the file from which the Stream imports metadata
+  /// @return The name of the file, or an empty string if the Stream does not import metadata.
+  [[nodiscard]] const std::string& get_metadata_import_file_name() const noexcept { return metadata_import_file_; }
+
+  /// @brief Stream configuration function: bound the memory used by the metadata of the Stream.
+  ///
+  ///        Once a transaction is complete, if the blocks of the previous transactions of all the Variables of the
+  ///        Stream use more than this budget, the blocks of the oldest transactions are moved to a scratch file next to
+  ///        the metadata file (see get_metadata_file_name()). They are read back when a subscriber selects them or when
+  ///        the metadata is exported, and moved out again at the end of the next transaction. The blocks of the newest
+  ///        complete transaction always stay in memory.
+  /// @param bytes the budget in bytes, 0 (the default) meaning that all the metadata stays in memory.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_metadata_memory_budget(size_t bytes) noexcept;
+  /// @brief Get the memory budget of the metadata of the Stream
+  /// @return The budget in bytes, 0 if the metadata is not bounded.
+  [[nodiscard]] size_t get_metadata_memory_budget() const noexcept { return metadata_memory_budget_; }
+
+  /// @brief Stream configuration function: specify that the I/O operations on metadata must be simulated.
+  ///
+  ///        With an Engine::Type::File, publishers then append a record describing the blocks of each transaction to an
+  ///        index file (md.idx) written in the simulated file system next to the data files, at the end of the
+  ///        transaction. Subscribers read the record of a transaction from this file when they begin it. The size of a
+  ///        record grows with the number of blocks written in the transaction.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_metadata_io_simulation() noexcept;
+  /// @brief Stream configuration function: specify that metadata must not cost any simulated time (default).
+  /// @return The calling Stream (enable method chaining).
+  Stream& unset_metadata_io_simulation() noexcept;
+  /// @brief Helper function to know if the Stream simulates the I/O operations on metadata or not
+  /// @return a boolean indicating if the Stream simulates the I/O operations on metadata or not
+  [[nodiscard]] bool does_simulate_metadata_io() const noexcept { return metadata_io_simulation_; }
+
+  /// @brief Stream configuration function: simulate the aggregation of the metadata of the publishers at the end of
+  ///        each transaction.
+  ///
+  ///        Publishers are then organized in a tree of the given arity, rooted at the first publisher that opened the
+  ///        Stream. When they end a transaction, each publisher waits for the metadata of its children, then sends
+  ///        the metadata of its whole subtree to its parent, over the links of the platform. The size of a message
+  ///        grows with the number of blocks put by the publishers of the subtree in the transaction.
+  /// @param arity the maximum number of children of a publisher in the tree (1 making a chain), 0 (the default)
+  ///        meaning that metadata is aggregated for free.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_metadata_aggregation(unsigned int arity) noexcept;
+  /// @brief Get the arity of the tree used to aggregate the metadata of the publishers
+  /// @return The arity of the tree, 0 if the aggregation of metadata is not simulated.
+  [[nodiscard]] unsigned int get_metadata_aggregation_arity() const noexcept { return metadata_aggregation_arity_; }
+
+  /// @brief Stream configuration function: set the smallest amount of data transferred by an I/O operation.
+  ///
+  ///        With an Engine::Type::File, subscribers then need one I/O operation per contiguous run of elements in
+  ///        the blocks they read, blocks being stored in row-major order, and each operation transfers at least this
+  ///        many bytes. A selection that slices a block across its fastest dimension, or a strided one, thus costs
+  ///        more than a contiguous read of the same number of elements.
+  /// @param bytes the smallest size of an I/O operation, 0 (the default) meaning that only the selected bytes count.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_min_io_size(size_t bytes) noexcept;
+  /// @brief Get the smallest amount of data transferred by an I/O operation
+  /// @return The size in bytes, 0 if the I/O operations are not modeled.
+  [[nodiscard]] size_t get_min_io_size() const noexcept { return min_io_size_; }
+
+  /// @brief Stream configuration function: buffer the puts of each publisher before writing them.
+  ///
+  ///        With an Engine::Type::File, the data put by a publisher then accumulates in a buffer of that capacity,
+  ///        which is written to its file in a single I/O operation when it is full, when the publisher calls
+  ///        Engine::perform_puts(), or when it ends the transaction. Without a buffer, each put is written on its own
+  ///        when the transaction ends. Staging engines ignore this setting, as subscribers pull the data they need.
+  /// @param bytes the capacity of the buffer of each publisher, 0 (the default) meaning no buffer.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_put_buffer_capacity(size_t bytes) noexcept;
+  /// @brief Get the capacity of the buffer in which each publisher accumulates its puts
+  /// @return The capacity in bytes, 0 if puts are not buffered.
+  [[nodiscard]] size_t get_put_buffer_capacity() const noexcept { return put_buffer_capacity_; }
+
+  /// @brief Stream configuration function: let the publishers of a Staging engine run ahead of the subscribers.
+  ///
+  ///        Publishers can then begin a transaction as soon as all the subscribers have begun the one that many
+  ///        transactions earlier. The data of the transactions they complete in the meantime is held in staging, on
+  ///        the hosts of the publishers, until the subscribers get it at their own pace. Publishers only close the
+  ///        Engine once the subscribers have read all their staged transactions. The File engine ignores this setting.
+  /// @param transactions the number of transactions publishers can be ahead, 0 (the default) meaning lockstep.
+  /// @return The calling Stream (enable method chaining).
+  Stream& set_staging_queue_depth(unsigned int transactions) noexcept;
+  /// @brief Get the number of transactions publishers of a Staging engine can be ahead of the subscribers
+  /// @return The depth of the staging queue, 0 if publishers and subscribers advance in lockstep.
+  [[nodiscard]] unsigned int get_staging_queue_depth() const noexcept { return staging_queue_depth_; }
+
+  /// @brief Get the approximate host memory used by the metadata and the Transport of the Stream. The cost of this
+  ///        call grows with the number of Variables, transactions held in memory, and actors, not with the number of
+  ///        blocks, so that it can be called at every transaction to track the growth of the memory.
+  /// @return The memory used by the Stream, broken down by Variable, by transaction, and by Transport structure.
+  [[nodiscard]] MemoryFootprint get_memory_footprint() const;
 
   /// @brief Define a new reduction method that can be applied to that Stream
   /// @param name the name of the reduction method
@@ -181,6 +368,29 @@ public:
                                                           const std::vector<size_t>& start,
                                                           const std::vector<size_t>& count, size_t element_size);
 
+  /// @brief Define a local array for this Stream: each publisher puts an array of its own, that has no position in a
+  ///        global array. Subscribers get all these arrays, or select some of them with
+  ///        Variable::set_block_selection(), the id of a block being the rank of its publisher.
+  /// @param name The name of the new variable.
+  /// @param count A vector that specifies how many elements the calling Actor owns in each dimension.
+  /// @param element_size The size of the elements in the Variable.
+  /// @return A shared pointer on the newly created Variable
+  [[nodiscard]] std::shared_ptr<Variable> define_local_array(std::string_view name, const std::vector<size_t>& count,
+                                                             size_t element_size);
+
+  /// @brief Define a joined array for this Stream: the arrays put by the publishers are laid end to end along one
+  ///        dimension, in the order of the ranks of the publishers. The shape of the Variable in a transaction is
+  ///        known once all the publishers ended it, its extent along the joined dimension being the sum of their
+  ///        counts.
+  /// @param name The name of the new variable.
+  /// @param count A vector that specifies how many elements the calling Actor owns in each dimension.
+  /// @param joined_dimension The dimension along which the arrays of the publishers are laid end to end.
+  /// @param element_size The size of the elements in the Variable.
+  /// @return A shared pointer on the newly created Variable
+  /// @throws InconsistentVariableDefinitionException if joined_dimension is not a dimension of count.
+  [[nodiscard]] std::shared_ptr<Variable> define_joined_array(std::string_view name, const std::vector<size_t>& count,
+                                                              size_t joined_dimension, size_t element_size);
+
   /// @brief Retrieve the list of Variables defined on this stream
   /// @return the list of Variable names
   [[nodiscard]] std::vector<std::string> get_all_variables() const;
@@ -8,6 +8,7 @@
 
 #include "dtlmod/Variable.hpp"
 
+#include <map>
 #include <string>
 
 XBT_LOG_EXTERNAL_CATEGORY(dtlmod);
@@ -26,8 +27,10 @@ protected:
   virtual void add_publisher(unsigned long /* publisher_id */) { /* No-op (for now)*/ }
 
   virtual void add_subscriber(unsigned long /* subscriber_id */) { /* No-op (for now)*/ }
-  std::vector<std::pair<std::string, sg_size_t>>
-  check_selection_and_get_blocks_to_get(std::shared_ptr<Variable> var) const;
+  // When num_operations is given, it receives the number of I/O operations needed to get each block
+  std::vector<std::pair<LocationId, sg_size_t>>
+  check_selection_and_get_blocks_to_get(std::shared_ptr<Variable> var,
+                                        std::vector<size_t>* num_operations = nullptr) const;
 
 public:
   enum class Method { Undefined, File, Mailbox, MQ };
@@ -39,6 +42,10 @@ public:
 
   virtual void put(const std::shared_ptr<Variable>& var, size_t simulated_size_in_bytes) = 0;
   virtual void get(const std::shared_ptr<Variable>& var)                                 = 0;
+  // Add the approximate number of bytes used on the host by each internal structure of the Transport, by name
+  virtual void add_memory_footprint(std::map<std::string, size_t, std::less<>>& /*structures*/) const
+  { /* No-op (for now)*/
+  }
 };
 /// \endcond
 
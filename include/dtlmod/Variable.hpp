@@ -6,10 +6,13 @@
 #ifndef __DTLMOD_VARIABLE_HPP__
 #define __DTLMOD_VARIABLE_HPP__
 
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "dtlmod/ActorSlots.hpp"
+#include "dtlmod/Extents.hpp"
 #include "dtlmod/Metadata.hpp"
 #include "dtlmod/ReductionMethod.hpp"
 
@@ -20,14 +23,48 @@ class Stream;
 /// @brief A class to translate a piece of data from an application into an object handled by the DTL and its metadata.
 class Variable : public std::enable_shared_from_this<Variable> {
   friend class Engine;
+  friend class Metadata;
   friend class Stream;
 
+public:
+  /// @brief An enum that defines how the blocks put by publishers are laid out in a Variable
+  enum class Kind {
+    /// @brief GlobalArray. Each publisher puts a region of an array whose global shape is known (default).
+    GlobalArray = 0,
+    /// @brief LocalArray. Each publisher puts an array of its own, that subscribers address by the rank of its writer.
+    LocalArray = 1,
+    /// @brief JoinedArray. The arrays of the publishers are laid end to end along one dimension, in the order of the
+    ///        ranks of their writers.
+    JoinedArray = 2
+  };
+
+  /// @brief A function giving the range of the values held by a block, from the id of the transaction in which it is
+  ///        published and its position. It can implement any synthetic distribution of the values of the Variable.
+  using ValueModel = std::function<ValueRange(unsigned int transaction_id, const std::vector<size_t>& start,
+                                              const std::vector<size_t>& count)>;
+
+private:
   enum class ReductionOrigin { None, Publisher, Subscriber };
 
+  // What a subscriber got in the last transaction it read, reused as long as it keeps the same selection and the
+  // transaction has the same block layout. The layout is not kept alive by the plan: once it is evicted or spilled, the
+  // plan can only be reused for a table with the same blocks.
+  struct ReadPlan {
+    Extents start;
+    Extents count;
+    Extents stride;
+    std::optional<ValueRange> value_selection;
+    std::weak_ptr<const BlockTable> layout;
+    std::vector<std::pair<LocationId, sg_size_t>> blocks;
+    std::vector<size_t> num_operations;
+  };
+
   std::string name_;
   size_t element_size_;
   std::vector<size_t> shape_;
-  std::unordered_map<sg4::ActorPtr, std::pair<std::vector<size_t>, std::vector<size_t>>> local_start_and_count_;
+  Kind kind_               = Kind::GlobalArray;
+  size_t joined_dimension_ = 0;
+  ActorSlotMap<std::pair<Extents, Extents>> local_start_and_count_;
   unsigned int transaction_start_ = 0;
   unsigned int transaction_count_ = 0;
 
@@ -35,15 +72,34 @@ class Variable : public std::enable_shared_from_this<Variable> {
 
   std::shared_ptr<Metadata> metadata_;
 
-  std::map<sg4::ActorPtr, std::pair<std::vector<size_t>, std::vector<size_t>>, std::less<>> subscriber_selections_;
-  std::map<sg4::ActorPtr, std::pair<unsigned int, unsigned int>, std::less<>> subscriber_transaction_selections_;
+  ActorSlotMap<std::pair<Extents, Extents>> subscriber_selections_;
+  ActorSlotMap<Extents> subscriber_selection_strides_;
+  ActorSlotMap<std::vector<std::pair<Extents, Extents>>> subscriber_selection_regions_;
+  ActorSlotMap<std::pair<unsigned int, unsigned int>> subscriber_transaction_selections_;
+  ActorSlotMap<ValueRange> subscriber_value_selections_;
+  ActorSlotMap<std::pair<size_t, size_t>> subscriber_block_selections_;
+  ActorSlotMap<unsigned int> subscriber_publisher_selections_;
+  ActorSlotMap<ValueRange> publisher_value_ranges_;
+  ValueModel value_model_;
   std::shared_ptr<ReductionMethod> is_reduced_with_ = nullptr;
   ReductionOrigin reduction_origin_{ReductionOrigin::None};
 
+  mutable ActorSlotMap<ReadPlan> read_plans_;
+  mutable size_t read_plan_cache_hits_   = 0;
+  mutable size_t read_plan_cache_misses_ = 0;
+
+  const BlockTable& get_selected_blocks(unsigned int transaction_id, size_t begin, size_t count) const;
+  void check_selection_by_region() const;
+
 protected:
   /// \cond EXCLUDE_FROM_DOCUMENTATION
-  void create_metadata() { metadata_ = std::make_shared<Metadata>(shared_from_this()); }
+  void create_metadata(std::shared_ptr<LocationTable> locations)
+  {
+    metadata_ = std::make_shared<Metadata>(shared_from_this(), std::move(locations));
+  }
   void set_metadata(std::shared_ptr<Metadata> metadata) { metadata_ = metadata; }
+  // Erase what a subscriber that closed its Engine left in this Variable, so that it no longer holds that actor
+  void forget_subscriber(const sg4::ActorPtr& actor) noexcept;
   /// \endcond
 
 public:
@@ -54,26 +110,69 @@ public:
   void set_transaction_count(unsigned int count) noexcept { transaction_count_ = count; }
   [[nodiscard]] unsigned int get_transaction_count() const noexcept { return transaction_count_; }
 
-  void set_local_start_and_count(sg4::ActorPtr actor,
-                                 const std::pair<std::vector<size_t>, std::vector<size_t>>& local_start_and_count)
+  void set_local_start_and_count(sg4::ActorPtr actor, const std::pair<Extents, Extents>& local_start_and_count)
   {
     local_start_and_count_[actor] = local_start_and_count;
   }
-  const std::pair<std::vector<size_t>, std::vector<size_t>>& get_local_start_and_count(sg4::ActorPtr actor) const
+  const std::pair<Extents, Extents>& get_local_start_and_count(sg4::ActorPtr actor) const
   {
     return local_start_and_count_.at(actor);
   }
 
-  void add_transaction_metadata(unsigned int transaction_id, sg4::ActorPtr publisher, const std::string& location);
-  std::vector<std::pair<std::string, sg_size_t>> get_sizes_to_get_per_block(unsigned int transaction_id,
-                                                                            const std::vector<size_t>& start,
-                                                                            const std::vector<size_t>& count) const;
+  void add_transaction_metadata(unsigned int transaction_id, sg4::ActorPtr publisher, LocationId location);
+  void add_transaction_metadata(unsigned int transaction_id, sg4::ActorPtr publisher, const std::string& location)
+  {
+    add_transaction_metadata(transaction_id, publisher, metadata_->get_locations()->intern(location));
+  }
+  // The following functions return what to get from each location. When num_operations is given, they also append to
+  // it the number of I/O operations each entry needs, i.e., the number of contiguous runs of elements it spans in the
+  // blocks, stored in row-major order.
+  std::vector<std::pair<LocationId, sg_size_t>>
+  get_sizes_to_get_per_block(unsigned int transaction_id, const Extents& start, const Extents& count,
+                             const std::optional<ValueRange>& value_selection = std::nullopt,
+                             const Extents& stride                            = Extents(),
+                             std::vector<size_t>* num_operations              = nullptr) const;
+  std::vector<std::pair<LocationId, sg_size_t>>
+  get_read_plan(sg4::ActorPtr actor, unsigned int transaction_id, const Extents& start, const Extents& count,
+                const std::optional<ValueRange>& value_selection, const Extents& stride = Extents(),
+                std::vector<size_t>* num_operations = nullptr) const;
+  std::vector<std::pair<LocationId, sg_size_t>>
+  get_sizes_to_get_for_regions(unsigned int transaction_id, const std::vector<std::pair<Extents, Extents>>& regions,
+                               const std::optional<ValueRange>& value_selection = std::nullopt,
+                               std::vector<size_t>* num_operations              = nullptr) const;
+  std::vector<std::pair<LocationId, sg_size_t>>
+  get_sizes_to_get_for_blocks(unsigned int transaction_id, size_t begin, size_t count,
+                              const std::optional<ValueRange>& value_selection = std::nullopt,
+                              std::vector<size_t>* num_operations              = nullptr) const;
+  std::vector<std::pair<LocationId, sg_size_t>>
+  get_sizes_to_get_for_blocks(unsigned int transaction_id, const std::vector<size_t>& block_ids,
+                              const std::optional<ValueRange>& value_selection = std::nullopt,
+                              std::vector<size_t>* num_operations              = nullptr) const;
+  std::pair<Extents, Extents> get_bounding_box_of_blocks(unsigned int transaction_id, size_t begin,
+                                                         size_t count) const;
+  std::pair<Extents, Extents> get_bounding_box_of_blocks(unsigned int transaction_id,
+                                                         const std::vector<size_t>& block_ids) const;
+  // Ids of the blocks put in a transaction by the publisher of a given rank in the Engine
+  [[nodiscard]] std::vector<size_t> get_blocks_of_publisher(unsigned int transaction_id, unsigned int rank) const;
+  [[nodiscard]] size_t get_num_blocks(unsigned int transaction_id) const;
+  // Whether two transactions have the same block layout, in which case any selection gets the same from each of them
+  [[nodiscard]] bool have_same_layout(unsigned int transaction_id, unsigned int other_transaction_id) const;
 
   std::shared_ptr<Metadata> get_metadata() const { return metadata_; }
   [[nodiscard]] bool subscriber_has_a_selection(sg4::ActorPtr actor) const;
   [[nodiscard]] bool subscriber_has_a_transaction_selection(sg4::ActorPtr actor) const;
-  const std::pair<std::vector<size_t>, std::vector<size_t>>& get_subscriber_selection(sg4::ActorPtr actor) const;
+  const std::pair<Extents, Extents>& get_subscriber_selection(sg4::ActorPtr actor) const;
+  // An empty stride means that all the elements of the selection are selected
+  [[nodiscard]] Extents get_subscriber_selection_stride(sg4::ActorPtr actor) const;
+  // Empty unless the selection is made of several regions
+  const std::vector<std::pair<Extents, Extents>>& get_subscriber_selection_regions(sg4::ActorPtr actor) const;
   const std::pair<unsigned int, unsigned int>& get_subscriber_transaction_selection(sg4::ActorPtr actor) const;
+  [[nodiscard]] std::optional<ValueRange> get_subscriber_value_selection(sg4::ActorPtr actor) const;
+  [[nodiscard]] std::optional<std::pair<size_t, size_t>> get_subscriber_block_selection(sg4::ActorPtr actor) const;
+  [[nodiscard]] std::optional<unsigned int> get_subscriber_publisher_selection(sg4::ActorPtr actor) const;
+  [[nodiscard]] std::optional<ValueRange>
+  get_publisher_value_range(sg4::ActorPtr publisher, unsigned int transaction_id,
+                            const std::pair<Extents, Extents>& start_and_count) const;
   /// \endcond
 
   /// \cond EXCLUDE_FROM_DOCUMENTATION
@@ -97,9 +196,40 @@ public:
   /// @return The corresponding C-string.
   [[nodiscard]] const char* get_cname() const noexcept { return name_.c_str(); }
 
+  /// @brief Get how the blocks put by publishers are laid out in the Variable.
+  /// @return The kind of the Variable.
+  [[nodiscard]] Kind get_kind() const noexcept { return kind_; }
+  /// @brief Get the dimension along which the arrays of the publishers of a joined array are laid end to end.
+  /// @return The joined dimension, meaningful only for a Variable of kind Kind::JoinedArray.
+  [[nodiscard]] size_t get_joined_dimension() const noexcept { return joined_dimension_; }
+
   /// @brief Get the shape of the Variable.
   /// @return A vector of the respective size in each dimension of the Variable.
   [[nodiscard]] const std::vector<size_t>& get_shape() const noexcept { return shape_; }
+  /// @brief Change the shape of the Variable, e.g., between the transactions of a code whose domain grows or shrinks.
+  ///
+  /// The new shape applies to the transactions in which the Variable is put from now on. It can only change between
+  /// transactions: putting the Variable in a transaction in which it was already put with another shape throws an
+  /// InconsistentVariableDefinitionException. Subscribers get each transaction with the shape it was put with. The
+  /// local start and count of the calling publisher are kept.
+  /// @param shape a vector of the respective size in each dimension of the Variable.
+  /// @throws InconsistentVariableDefinitionException if the number of dimensions changes or if the local start and
+  ///         count of the calling publisher do not fit in the new shape.
+  void set_shape(const std::vector<size_t>& shape);
+  /// @brief Change the shape of the Variable and the region of it owned by the calling publisher.
+  /// @param shape a vector of the respective size in each dimension of the Variable.
+  /// @param start a vector of starting positions in each dimension of the Variable.
+  /// @param count a vector of number of elements in each dimension.
+  /// @throws InconsistentVariableDefinitionException if the number of dimensions changes or if start and count do not
+  ///         fit in the new shape.
+  void set_shape(const std::vector<size_t>& shape, const std::vector<size_t>& start, const std::vector<size_t>& count);
+  /// @brief Get the shape the Variable had in a given transaction.
+  /// @param transaction_id the id of the transaction.
+  /// @return A vector of the respective size in each dimension of the Variable in this transaction.
+  [[nodiscard]] std::vector<size_t> get_transaction_shape(unsigned int transaction_id) const
+  {
+    return metadata_->get_shape(transaction_id);
+  }
   /// @brief Get the size of the elements stored in the Variable.
   /// @return The elements' size.
   [[nodiscard]] size_t get_element_size() const noexcept { return element_size_; }
@@ -114,7 +244,27 @@ public:
   /// @brief Allow a subscriber to select what subset of a variable it would like to get.
   /// @param start a vector of starting positions in each dimension of the Variable.
   /// @param count a vector of number of elements to get in each dimension.
+  /// @throws InvalidSelectionException if the Variable is a local array, whose blocks have no position.
   void set_selection(const std::vector<size_t>& start, const std::vector<size_t>& count);
+  /// @brief Allow a subscriber to select a strided subset of a variable, i.e., only the elements at
+  ///        start + k * stride in each dimension that fall in [start, start + count).
+  /// @param start a vector of starting positions in each dimension of the Variable.
+  /// @param count a vector of number of elements, stride included, spanned in each dimension.
+  /// @param stride a vector of distances between two selected elements in each dimension.
+  /// @throws InvalidSelectionStrideException if stride does not have one non-zero value per dimension.
+  /// @throws InvalidSelectionException if the Variable is a local array.
+  void set_selection(const std::vector<size_t>& start, const std::vector<size_t>& count,
+                     const std::vector<size_t>& stride);
+  /// @brief Allow a subscriber to select several disjoint regions of a variable, to get them all at once.
+  ///
+  /// A single get resolves all the regions and retrieves what they need from each location in one transfer. The local
+  /// start and count of the subscriber are those of the bounding box of the regions, but its local size is the sum of
+  /// the sizes of the regions.
+  /// @param regions a vector of (start, count) pairs, one per region.
+  /// @throws InvalidSelectionException if there is no region, if a region does not have one start and one count per
+  ///         dimension, if a region exceeds the shape of the Variable, if two regions overlap, or if the Variable is a
+  ///         local array.
+  void set_selection(const std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>>& regions);
   /// @brief Allow a subscriber to select what transaction it would like to get.
   /// @param transaction_id the id of the transaction to get.
   void set_transaction_selection(unsigned int transaction_id) { set_transaction_selection(transaction_id, 1); }
@@ -122,6 +272,53 @@ public:
   /// @param begin the id at which the range of transactions to get begins.
   /// @param count the number of transactions in the range.
   void set_transaction_selection(unsigned int begin, unsigned int count);
+  /// @brief Allow a subscriber to only get the blocks that may hold values in [min, max], according to the value
+  ///        statistics attached to them by publishers. Blocks without statistics are always selected.
+  /// @param min the smallest value of interest.
+  /// @param max the largest value of interest.
+  /// @throws InvalidValueRangeException if min is greater than max.
+  void set_value_selection(double min, double max);
+  /// @brief Allow a subscriber to get all the blocks again, whatever the values they hold.
+  void unset_value_selection();
+
+  /// @brief Allow a subscriber to get exactly one of the blocks published in a transaction, without describing its
+  ///        region with set_selection(). The id of a block is its position among the blocks of the transaction ordered
+  ///        by starting position, not the rank of its publisher: use set_publisher_selection() to get the blocks of a
+  ///        given publisher. The blocks of local and joined arrays are ordered by the rank of their publisher.
+  /// @param block_id the id of the block to get.
+  void set_block_selection(size_t block_id) { set_block_selection(block_id, 1); }
+  /// @brief Allow a subscriber to get a range of consecutive blocks published in a transaction.
+  /// @param begin the id of the first block to get.
+  /// @param count the number of blocks in the range.
+  /// @throws InvalidBlockSelectionException if count is 0.
+  void set_block_selection(size_t begin, size_t count);
+  /// @brief Allow a subscriber to get the blocks that intersect its selection again.
+  void unset_block_selection();
+  /// @brief Allow a subscriber to get the blocks put in a transaction by the publisher of a given rank, i.e., the order
+  ///        in which the publishers opened the Engine, wherever these blocks are. This replaces any block selection.
+  ///        Getting a transaction in which this publisher put no block throws an InvalidBlockSelectionException.
+  /// @param rank the rank of the publisher whose blocks to get.
+  void set_publisher_selection(unsigned int rank);
+  /// @brief Allow a subscriber to get the blocks of all the publishers again.
+  void unset_publisher_selection();
+
+  /// @brief Get the number of get() operations on this Variable that reused the blocks found for the previous
+  ///        transaction, because the subscriber kept the same selection and the block layout did not change.
+  /// @return The number of hits in the read plan cache.
+  [[nodiscard]] size_t get_read_plan_cache_hits() const noexcept { return read_plan_cache_hits_; }
+  /// @brief Get the number of get() operations on this Variable that had to search the blocks to read.
+  /// @return The number of misses in the read plan cache.
+  [[nodiscard]] size_t get_read_plan_cache_misses() const noexcept { return read_plan_cache_misses_; }
+
+  /// @brief Allow a publisher to attach the range of the values of its block to its next put() operation. Later puts
+  ///        fall back to the value model of the Variable, if any, until this function is called again.
+  /// @param min the smallest value in the block.
+  /// @param max the largest value in the block.
+  /// @throws InvalidValueRangeException if min is greater than max.
+  void set_value_range(double min, double max);
+  /// @brief Compute the range of the values of the blocks published by actors that did not call set_value_range().
+  /// @param model a function giving the range of the values of a block from its transaction and position.
+  void set_value_model(ValueModel model) { value_model_ = std::move(model); }
 
   /// @brief Assign a parameterized reduction method to the Variable.
   /// @param method a ReductionMethod (already defined).
@@ -0,0 +1,33 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include "dtlmod/ActorSlots.hpp"
+
+namespace dtlmod {
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+
+size_t ActorSlot::num_slots_ = 0;
+simgrid::xbt::Extension<sg4::Actor, ActorSlot> ActorSlot::EXTENSION_ID;
+
+size_t ActorSlot::of(sg4::Actor* actor)
+{
+  // The extension is created when the first slot is handed out, once SimGrid is initialized
+  if (not EXTENSION_ID.valid())
+    EXTENSION_ID = sg4::Actor::extension_create<ActorSlot>();
+  if (const auto* slot = actor->extension<ActorSlot>())
+    return slot->slot_;
+  size_t slot;
+  if (auto& free_slots = get_free_slots(); not free_slots.empty()) {
+    slot = *free_slots.begin();
+    free_slots.erase(free_slots.begin());
+  } else {
+    slot = num_slots_++;
+  }
+  actor->extension_set(new ActorSlot(slot));
+  return slot;
+}
+
+/// \endcond
+} // namespace dtlmod
@@ -0,0 +1,169 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "dtlmod/BinaryMetadataWriter.hpp"
+#include "dtlmod/Variable.hpp"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_binary_metadata, dtlmod_metadata, "DTL logging about binary metadata export");
+
+namespace dtlmod {
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+using namespace binary_metadata;
+
+void BinaryMetadataWriter::open()
+{
+  if (out_.is_open())
+    return;
+  out_.open(path_, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+  // Reserve room for the header, written last
+  Header placeholder{};
+  write(&placeholder, sizeof(placeholder));
+}
+
+void BinaryMetadataWriter::write(const void* data, uint64_t size)
+{
+  out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+  offset_ += size;
+}
+
+void BinaryMetadataWriter::pad()
+{
+  static const char zeros[8] = {};
+  if (offset_ % 8 != 0)
+    write(zeros, 8 - offset_ % 8);
+}
+
+void BinaryMetadataWriter::add_transaction(const std::string& var_name, unsigned int transaction_id,
+                                           const std::shared_ptr<const BlockTable>& blocks)
+{
+  open();
+  auto& entries = variables_[var_name];
+  TransactionRecord record{};
+  record.transaction_id = transaction_id;
+  record.num_blocks     = blocks->size();
+
+  if (entries.last_layout == blocks) {
+    XBT_DEBUG("Transaction %u of %s reuses the block table at offset %lu", transaction_id, var_name.c_str(),
+              static_cast<unsigned long>(entries.last_layout_offset));
+    record.blocks_offset = entries.last_layout_offset;
+  } else {
+    static_assert(sizeof(size_t) == sizeof(uint64_t), "Block tables are written as they are stored in memory");
+    record.blocks_offset = offset_;
+    auto num_values      = blocks->size() * blocks->get_num_dims();
+    if (num_values > 0) {
+      write(blocks->get_start(0), num_values * sizeof(uint64_t));
+      write(blocks->get_count(0), num_values * sizeof(uint64_t));
+    }
+    std::vector<uint32_t> locations(blocks->size());
+    for (size_t b = 0; b < blocks->size(); b++)
+      locations[b] = blocks->get_location_id(b);
+    write(locations.data(), locations.size() * sizeof(uint32_t));
+    pad();
+    entries.last_layout        = blocks;
+    entries.last_layout_offset = record.blocks_offset;
+  }
+  entries.transactions.push_back(record);
+}
+
+void BinaryMetadataWriter::finish(const std::vector<std::shared_ptr<Variable>>& variables,
+                                  const LocationTable& locations, const std::vector<uint64_t>& location_sizes)
+{
+  open();
+  auto sorted_variables = variables;
+  std::sort(sorted_variables.begin(), sorted_variables.end(),
+            [](const auto& a, const auto& b) { return a->get_name() < b->get_name(); });
+
+  // Shapes, then the shape of each variable from each transaction in which it changed on
+  std::vector<uint64_t> shape_offsets;
+  std::vector<uint64_t> shape_changes_offsets;
+  for (const auto& var : sorted_variables) {
+    shape_offsets.push_back(offset_);
+    std::vector<uint64_t> shape(var->get_shape().begin(), var->get_shape().end());
+    write(shape.data(), shape.size() * sizeof(uint64_t));
+    shape_changes_offsets.push_back(offset_);
+    for (const auto& [id, transaction_shape] : var->get_metadata()->get_shapes()) {
+      uint64_t transaction_id = id;
+      write(&transaction_id, sizeof(transaction_id));
+      write(transaction_shape.data(), transaction_shape.size() * sizeof(uint64_t));
+    }
+  }
+
+  // Variable records
+  Header header{};
+  header.variables_offset    = offset_;
+  uint64_t first_transaction = 0;
+  for (size_t i = 0; i < sorted_variables.size(); i++) {
+    const auto& var = sorted_variables[i];
+    VariableRecord record{};
+    record.name                 = static_cast<uint32_t>(locations.size() + i);
+    record.num_dims             = static_cast<uint32_t>(var->get_shape().size());
+    record.element_size         = var->get_element_size();
+    record.shape_offset         = shape_offsets[i];
+    record.first_transaction    = first_transaction;
+    auto it                     = variables_.find(var->get_name());
+    record.num_transactions     = (it == variables_.end()) ? 0 : it->second.transactions.size();
+    record.kind                 = static_cast<uint32_t>(var->get_kind());
+    record.joined_dimension     = static_cast<uint32_t>(var->get_joined_dimension());
+    record.shape_changes_offset = shape_changes_offsets[i];
+    record.num_shape_changes    = var->get_metadata()->get_shapes().size();
+    first_transaction += record.num_transactions;
+    write(&record, sizeof(record));
+  }
+
+  // Footer index, sorted by (variable, transaction id)
+  header.transactions_offset = offset_;
+  for (size_t i = 0; i < sorted_variables.size(); i++) {
+    auto it = variables_.find(sorted_variables[i]->get_name());
+    if (it == variables_.end())
+      continue;
+    auto& transactions = it->second.transactions;
+    std::stable_sort(transactions.begin(), transactions.end(),
+                     [](const auto& a, const auto& b) { return a.transaction_id < b.transaction_id; });
+    for (auto& record : transactions)
+      record.variable = static_cast<uint32_t>(i);
+    write(transactions.data(), transactions.size() * sizeof(TransactionRecord));
+  }
+
+  // Location sizes, 0 when unknown
+  header.location_sizes_offset = offset_;
+  std::vector<uint64_t> sizes(locations.size(), 0);
+  std::copy_n(location_sizes.begin(), std::min(location_sizes.size(), sizes.size()), sizes.begin());
+  write(sizes.data(), sizes.size() * sizeof(uint64_t));
+
+  // String table: locations, then variable names
+  header.strings_offset = offset_;
+  std::vector<std::string_view> strings;
+  for (LocationId id = 0; id < locations.size(); id++)
+    strings.emplace_back(locations.get_name(id));
+  for (const auto& var : sorted_variables)
+    strings.emplace_back(var->get_name());
+  uint64_t count = strings.size();
+  std::vector<uint64_t> string_offsets(1, 0);
+  for (const auto& s : strings)
+    string_offsets.push_back(string_offsets.back() + s.size());
+  write(&count, sizeof(count));
+  write(string_offsets.data(), string_offsets.size() * sizeof(uint64_t));
+  for (const auto& s : strings)
+    write(s.data(), s.size());
+  pad();
+
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version          = VERSION;
+  header.byte_order       = BYTE_ORDER_MARK;
+  header.num_variables    = sorted_variables.size();
+  header.num_locations    = locations.size();
+  header.num_transactions = first_transaction;
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out_.close();
+  XBT_DEBUG("Wrote %lu bytes of binary metadata in %s", static_cast<unsigned long>(offset_), path_.c_str());
+}
+/// \endcond
+
+} // namespace dtlmod
@@ -0,0 +1,141 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+#include "dtlmod/BlockIndex.hpp"
+#include "dtlmod/Metadata.hpp"
+
+namespace dtlmod {
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+static size_t ceil_div(size_t a, size_t b)
+{
+  return (a + b - 1) / b;
+}
+
+void BlockIndex::tile(const BlockTable& blocks, std::vector<unsigned int>::iterator begin,
+                      std::vector<unsigned int>::iterator end, size_t dim)
+{
+  // Sort by center along 'dim'. Comparing doubled centers keeps the comparison exact on integers.
+  std::sort(begin, end, [&blocks, dim](unsigned int a, unsigned int b) {
+    return 2 * blocks.get_start(a)[dim] + blocks.get_count(a)[dim] <
+           2 * blocks.get_start(b)[dim] + blocks.get_count(b)[dim];
+  });
+  if (dim + 1 == ndims_)
+    return;
+
+  // Cut into S slabs of whole leaves, with S = ceil(num_leaves^(1 / remaining_dims)), and tile each slab along the
+  // next dimension.
+  auto n          = static_cast<size_t>(end - begin);
+  auto num_leaves = ceil_div(n, FANOUT);
+  auto num_slabs  = static_cast<size_t>(std::ceil(std::pow(static_cast<double>(num_leaves), 1.0 / (ndims_ - dim))));
+  auto slab_size  = FANOUT * ceil_div(num_leaves, std::max<size_t>(num_slabs, 1));
+  for (auto slab = begin; slab < end; slab += std::min<ptrdiff_t>(slab_size, end - slab))
+    tile(blocks, slab, slab + std::min<ptrdiff_t>(slab_size, end - slab), dim + 1);
+}
+
+BlockIndex::BlockIndex(const BlockTable& blocks) : ndims_(blocks.get_num_dims())
+{
+  if (blocks.empty() || ndims_ == 0)
+    return;
+
+  entries_.resize(blocks.size());
+  std::iota(entries_.begin(), entries_.end(), 0U);
+  tile(blocks, entries_.begin(), entries_.end(), 0);
+
+  // Leaf level: bound groups of FANOUT consecutive entries
+  Level leaves;
+  auto num_nodes = ceil_div(entries_.size(), FANOUT);
+  leaves.lo.assign(num_nodes * ndims_, SIZE_MAX);
+  leaves.hi.assign(num_nodes * ndims_, 0);
+  for (size_t e = 0; e < entries_.size(); e++) {
+    auto node         = e / FANOUT;
+    const auto* start = blocks.get_start(entries_[e]);
+    const auto* count = blocks.get_count(entries_[e]);
+    for (size_t d = 0; d < ndims_; d++) {
+      leaves.lo[node * ndims_ + d] = std::min(leaves.lo[node * ndims_ + d], start[d]);
+      leaves.hi[node * ndims_ + d] = std::max(leaves.hi[node * ndims_ + d], start[d] + count[d]);
+    }
+  }
+  levels_.push_back(std::move(leaves));
+
+  // Upper levels: bound groups of FANOUT consecutive nodes of the level below, until there is a single root
+  while (levels_.back().size(ndims_) > 1) {
+    const auto& below = levels_.back();
+    auto num_below    = below.size(ndims_);
+    Level level;
+    num_nodes = ceil_div(num_below, FANOUT);
+    level.lo.assign(num_nodes * ndims_, SIZE_MAX);
+    level.hi.assign(num_nodes * ndims_, 0);
+    for (size_t child = 0; child < num_below; child++) {
+      auto node = child / FANOUT;
+      for (size_t d = 0; d < ndims_; d++) {
+        level.lo[node * ndims_ + d] = std::min(level.lo[node * ndims_ + d], below.lo[child * ndims_ + d]);
+        level.hi[node * ndims_ + d] = std::max(level.hi[node * ndims_ + d], below.hi[child * ndims_ + d]);
+      }
+    }
+    levels_.push_back(std::move(level));
+  }
+}
+
+void BlockIndex::find_intersecting_blocks(const BlockTable& blocks, const Extents& start, const Extents& count,
+                                          std::vector<size_t>& hits) const
+{
+  if (levels_.empty())
+    return;
+
+  // Two half-open boxes share an element iff they overlap along every dimension
+  auto overlaps = [this, &start, &count](const size_t* lo, const size_t* hi) {
+    for (size_t d = 0; d < ndims_; d++)
+      if (std::max(lo[d], start[d]) >= std::min(hi[d], start[d] + count[d]))
+        return false;
+    return true;
+  };
+
+  auto first_hit = hits.size();
+  std::vector<std::pair<size_t, size_t>> to_visit; // (level, node)
+  to_visit.emplace_back(levels_.size() - 1, 0);
+  Extents block_end(ndims_);
+  while (!to_visit.empty()) {
+    auto [level, node] = to_visit.back();
+    to_visit.pop_back();
+    const auto& l = levels_[level];
+    if (!overlaps(l.lo.data() + node * ndims_, l.hi.data() + node * ndims_))
+      continue;
+
+    if (level > 0) {
+      auto last_child = std::min((node + 1) * FANOUT, levels_[level - 1].size(ndims_));
+      for (auto child = node * FANOUT; child < last_child; child++)
+        to_visit.emplace_back(level - 1, child);
+    } else {
+      auto last_entry = std::min((node + 1) * FANOUT, entries_.size());
+      for (auto e = node * FANOUT; e < last_entry; e++) {
+        const auto* block_start = blocks.get_start(entries_[e]);
+        const auto* block_count = blocks.get_count(entries_[e]);
+        for (size_t d = 0; d < ndims_; d++)
+          block_end[d] = block_start[d] + block_count[d];
+        if (overlaps(block_start, block_end.data()))
+          hits.push_back(entries_[e]);
+      }
+    }
+  }
+  // Report hits in block order, as a linear scan would
+  std::sort(hits.begin() + static_cast<ptrdiff_t>(first_hit), hits.end());
+}
+
+size_t BlockIndex::get_memory_footprint() const noexcept
+{
+  size_t footprint =
+      sizeof(BlockIndex) + entries_.capacity() * sizeof(unsigned int) + levels_.capacity() * sizeof(Level);
+  for (const auto& level : levels_)
+    footprint += (level.lo.capacity() + level.hi.capacity()) * sizeof(size_t);
+  return footprint;
+}
+/// \endcond
+
+} // namespace dtlmod
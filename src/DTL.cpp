@@ -67,6 +67,36 @@ DTL::DTL(std::string_view filename)
     if (stream.contains("export_metadata")) {
       streams_[name]->set_metadata_export();
     }
+    // And in which format
+    if (stream.contains("metadata_format")) {
+      if (stream["metadata_format"] == "text")
+        streams_[name]->set_metadata_export_format(Stream::MetadataFormat::Text);
+      else if (stream["metadata_format"] == "binary")
+        streams_[name]->set_metadata_export_format(Stream::MetadataFormat::Binary);
+      else
+        throw UnknownMetadataFormatException(XBT_THROW_POINT, stream["metadata_format"].dump());
+    }
+    // Check if the memory used by the metadata of this stream is bounded
+    if (stream.contains("metadata_memory_budget"))
+      streams_[name]->set_metadata_memory_budget(stream["metadata_memory_budget"].get<size_t>());
+    // Check if the I/O operations on the metadata of this stream must be simulated
+    if (stream.contains("simulate_metadata_io"))
+      streams_[name]->set_metadata_io_simulation();
+    // Check if the aggregation of the metadata of the publishers of this stream must be simulated
+    if (stream.contains("metadata_aggregation_arity"))
+      streams_[name]->set_metadata_aggregation(stream["metadata_aggregation_arity"].get<unsigned int>());
+    // Check if the I/O operations of the subscribers of this stream must be modeled
+    if (stream.contains("min_io_size"))
+      streams_[name]->set_min_io_size(stream["min_io_size"].get<size_t>());
+    // Check if the puts of the publishers of this stream must be buffered
+    if (stream.contains("put_buffer_capacity"))
+      streams_[name]->set_put_buffer_capacity(stream["put_buffer_capacity"].get<size_t>());
+    // Check if the publishers of this stream can run ahead of its subscribers
+    if (stream.contains("staging_queue_depth"))
+      streams_[name]->set_staging_queue_depth(stream["staging_queue_depth"].get<unsigned int>());
+    // Check if the metadata of this stream must be read from a file exported by a previous simulation
+    if (stream.contains("import_metadata"))
+      streams_[name]->set_metadata_import(stream["import_metadata"].get<std::string>());
   }
 }
 
@@ -22,11 +22,11 @@ size_t DecimationReductionMethod::ParameterizedDecimation::get_global_reduced_si
 
 size_t DecimationReductionMethod::ParameterizedDecimation::get_local_reduced_size() const
 {
-  auto start_and_count = reduced_local_start_and_count_.at(sg4::Actor::self()).second;
-  return std::accumulate(start_and_count.begin(), start_and_count.end(), var_->get_element_size(), std::multiplies<>{});
+  const auto& count = reduced_local_start_and_count_.at(sg4::Actor::self()).second;
+  return std::accumulate(count.begin(), count.end(), var_->get_element_size(), std::multiplies<>{});
 }
 
-const std::pair<std::vector<size_t>, std::vector<size_t>>&
+const std::pair<Extents, Extents>&
 DecimationReductionMethod::ParameterizedDecimation::get_reduced_start_and_count_for(sg4::ActorPtr publisher) const
 {
   return reduced_local_start_and_count_.at(publisher);
@@ -137,17 +137,16 @@ void DecimationReductionMethod::propagate_for_subscriber(const Variable& publish
 
   // The subscriber receives the full reduced variable, so its local region is the entire reduced shape.
   const auto& reduced_shape = pub_param->get_reduced_shape();
-  std::vector<size_t> reduced_start(reduced_shape.size(), 0);
-  sub_param->set_reduced_local_start_and_count(sg4::Actor::self(), reduced_start, reduced_shape);
+  sub_param->set_reduced_local_start_and_count(sg4::Actor::self(), Extents(reduced_shape.size(), 0), reduced_shape);
 
   per_variable_parameterizations_[&subscriber_var] = std::move(sub_param);
 }
 
 void DecimationReductionMethod::reduce_variable(const Variable& var)
 {
-  auto parameterization = per_variable_parameterizations_[&var];
-  auto original_shape   = var.get_shape();
-  auto stride           = parameterization->get_stride();
+  auto parameterization      = per_variable_parameterizations_[&var];
+  const auto& original_shape = var.get_shape();
+  const auto& stride         = parameterization->get_stride();
 
   std::vector<size_t> reduced_shape;
   size_t idx = 0;
@@ -158,10 +157,10 @@ void DecimationReductionMethod::reduce_variable(const Variable& var)
   }
   parameterization->set_reduced_shape(reduced_shape);
 
-  auto self           = sg4::Actor::self();
-  auto [start, count] = var.get_local_start_and_count(self);
-  std::vector<size_t> reduced_start;
-  std::vector<size_t> reduced_count;
+  auto self                 = sg4::Actor::self();
+  const auto& [start, count] = var.get_local_start_and_count(self);
+  Extents reduced_start(original_shape.size());
+  Extents reduced_count(original_shape.size());
 
   for (size_t i = 0; i < original_shape.size(); i++) {
     // Sanity checks that shape, start, and count have the same size have already been done
@@ -171,8 +170,8 @@ void DecimationReductionMethod::reduce_variable(const Variable& var)
         static_cast<size_t>(std::ceil(static_cast<double>(start[i] + count[i]) / static_cast<double>(stride[i]))));
     XBT_DEBUG("Dim %zu: stride = %zu, Start = %zu, r_start = %zu, Count = %zu, r_count = %zu", i, stride[i], start[i],
               r_start, count[i], r_next_start - r_start);
-    reduced_start.push_back(r_start);
-    reduced_count.push_back(r_next_start - r_start);
+    reduced_start[i] = r_start;
+    reduced_count[i] = r_next_start - r_start;
   }
 
   parameterization->set_reduced_local_start_and_count(self, reduced_start, reduced_count);
@@ -3,9 +3,15 @@
 /* This program is free software; you can redistribute it and/or modify it
  * under the terms of the license (GNU LGPL) which comes with this package. */
 
+#include <simgrid/Exception.hpp>
 #include <simgrid/s4u/Actor.hpp>
+#include <simgrid/s4u/Engine.hpp>
+#include <simgrid/s4u/Mailbox.hpp>
 #include <simgrid/s4u/MessageQueue.hpp>
 
+#include <algorithm>
+#include <utility>
+
 #include "dtlmod/DTL.hpp"
 #include "dtlmod/FileTransport.hpp"
 
@@ -44,11 +50,19 @@ void Engine::put(const std::shared_ptr<Variable>& var) const
     transport_->put(var, var->get_reduction_method()->get_reduced_variable_local_size(*var, get_current_transaction()));
   } else
     transport_->put(var, var->get_local_size());
+  account_for_metadata(*var);
 }
 
 void Engine::put(const std::shared_ptr<Variable>& var, size_t simulated_size_in_bytes) const
 {
   transport_->put(var, simulated_size_in_bytes);
+  account_for_metadata(*var);
+}
+
+void Engine::perform_puts()
+{
+  if (publishers_.contains(sg4::Actor::self()))
+    perform_pub_puts();
 }
 
 /// The actual data transport is delegated to the Transport method associated to the Engine.
@@ -96,6 +110,8 @@ void Engine::cancel_transaction(unsigned int transaction_id)
   // transaction_id == 0 means no transaction has started yet; treat as T1 so all checks against
   // (current + 1 >= 1) still fire correctly.
   canceled_transaction_id_.store(transaction_id == 0 ? 1 : transaction_id);
+  for (auto& [actor, aset] : metadata_aggregation_)
+    cancel_pending_activities(aset);
   cancel_activities();
 }
 
@@ -122,11 +138,98 @@ void Engine::drain(sg4::ActivitySet& activities)
   activities.clear();
 }
 
+void Engine::account_for_metadata(const Variable& var) const
+{
+  // Each put adds one block to the metadata of the Variable
+  if (auto s = get_stream(); s && s->get_metadata_aggregation_arity() > 0)
+    pub_metadata_sizes_[sg4::Actor::self()] += Metadata::get_index_entry_size(var.get_shape().size());
+}
+
+void Engine::aggregate_metadata()
+{
+  auto s = get_stream();
+  if (!s || s->get_metadata_aggregation_arity() == 0)
+    return;
+  auto self        = sg4::Actor::self();
+  auto arity       = s->get_metadata_aggregation_arity();
+  auto rank        = publisher_ranks_.at(self);
+  auto num_ranks   = static_cast<unsigned int>(publishers_.count());
+  auto mbox_prefix = name_ + "_metadata_aggregation_";
+  auto& pending    = metadata_aggregation_[self->get_pid()];
+
+  // Each message is as large as the metadata of the subtree rooted at its sender, which leaves that size at its rank
+  // in subtree_metadata_sizes_. Messages only carry a static dummy payload, so that nothing is leaked when they are
+  // canceled before being received.
+  static sg_size_t* dummy_buffer;
+  static sg_size_t dummy = 0;
+  auto* mbox             = sg4::Mailbox::by_name(mbox_prefix + std::to_string(rank));
+  auto first             = static_cast<unsigned long>(rank) * arity + 1;
+  auto last              = std::min(first + arity, static_cast<unsigned long>(num_ranks));
+  for (auto child = first; child < last; child++)
+    pending.push(mbox->get_async(&dummy_buffer));
+  if (!wait_for_metadata_aggregation(pending))
+    return;
+
+  sg_size_t size = std::exchange(pub_metadata_sizes_[self], 0);
+  for (auto child = first; child < last; child++)
+    size += subtree_metadata_sizes_[child];
+  if (rank == 0) {
+    XBT_DEBUG("%llu bytes of metadata gathered from %u publishers", size, num_ranks);
+    return;
+  }
+  auto* parent_mbox             = sg4::Mailbox::by_name(mbox_prefix + std::to_string((rank - 1) / arity));
+  subtree_metadata_sizes_[rank] = size;
+  XBT_DEBUG("Send %llu bytes of metadata to %s", size, parent_mbox->get_cname());
+  pending.push(parent_mbox->put_async(&dummy, size));
+  wait_for_metadata_aggregation(pending);
+}
+
+bool Engine::wait_for_metadata_aggregation(sg4::ActivitySet& pending)
+{
+  try {
+    pending.wait_all();
+  } catch (const simgrid::CancelException&) {
+    // The transaction is canceled, and so is what the other publishers wait for in the tree: give up
+    if (!is_canceled())
+      throw;
+    drain(pending);
+    return false;
+  }
+  pending.clear();
+  return true;
+}
+
+void Engine::record_staging_queue_occupancy(unsigned int num_transactions)
+{
+  XBT_DEBUG("%u transaction(s) held in staging", num_transactions);
+  staging_queue_history_.emplace_back(sg4::Engine::get_clock(), num_transactions);
+}
+
 void Engine::add_publisher(sg4::ActorPtr actor)
 {
   pub_ever_present_ = true;
+  publisher_ranks_.try_emplace(actor, static_cast<unsigned int>(publishers_.count()));
   transport_->add_publisher(publishers_.count());
   publishers_.add(actor);
+  subtree_metadata_sizes_.resize(publishers_.count());
+}
+
+void Engine::remove_publisher(sg4::ActorPtr actor)
+{
+  publishers_.remove(actor);
+  pub_metadata_sizes_.erase(actor);
+  metadata_aggregation_.erase(actor->get_pid());
+  // Shift the ranks of the publishers that opened the Stream after this one, so that ranks stay dense and in opening
+  // order. Otherwise, a publisher opening the Stream afterwards would get the rank of one still there, and the
+  // aggregation tree would wait for ranks that no publisher holds anymore.
+  const auto* rank = publisher_ranks_.find(actor);
+  if (!rank)
+    return;
+  auto removed_rank = *rank;
+  publisher_ranks_.erase(actor);
+  for (auto& [publisher, other_rank] : publisher_ranks_)
+    if (other_rank > removed_rank)
+      other_rank--;
 }
 
 void Engine::add_subscriber(sg4::ActorPtr actor)
@@ -135,6 +238,16 @@ void Engine::add_subscriber(sg4::ActorPtr actor)
   subscribers_.add(actor);
 }
 
+void Engine::remove_subscriber(sg4::ActorPtr actor)
+{
+  subscribers_.remove(actor);
+  // Subscribers usually get the Variables they inquire through their own copy, which goes away with them. Those that
+  // select and read the Variables of the Stream directly leave their selections and read plans there.
+  if (auto s = get_stream())
+    for (const auto& [name, var] : s->variables_)
+      var->forget_subscriber(actor);
+}
+
 void Engine::close_stream() const
 {
   if (auto s = stream_.lock())
@@ -3,6 +3,7 @@
 /* This program is free software; you can redistribute it and/or modify it
  * under the terms of the license (GNU LGPL) which comes with this package. */
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/split.hpp>
 
@@ -85,6 +86,35 @@ void FileEngine::create_transport(const Transport::Method& /*transport_method*/)
   set_transport(std::make_shared<FileTransport>(this));
 }
 
+// Subscribers replay a dataset written by a previous simulation: the files it describes must exist in the simulated
+// file system, and all its transactions are already complete.
+void FileEngine::import_metadata(const MetadataReader& reader, unsigned int last_transaction)
+{
+  for (uint32_t l = 0; l < reader.get_num_locations(); l++) {
+    std::string path(reader.get_location(l));
+    if (file_system_->file_exists(path))
+      continue;
+    auto directory = sgfs::PathUtil::split_path(path).first;
+    if (!file_system_->directory_exists(directory))
+      file_system_->create_directory(directory);
+    XBT_DEBUG("Create file '%s' (%llu bytes) described by the imported metadata", path.c_str(),
+              static_cast<unsigned long long>(reader.get_location_size(l)));
+    file_system_->create_file(path, std::to_string(reader.get_location_size(l)) + "B");
+  }
+  completed_pub_transaction_id_ = last_transaction;
+  mark_pub_stream_ended();
+}
+
+// Size of the files written by the publishers, indexed by the LocationId of their path
+std::vector<uint64_t> FileEngine::get_file_sizes() const
+{
+  auto transport = get_file_transport();
+  std::vector<uint64_t> sizes(get_stream()->get_location_table()->size(), 0);
+  for (const auto& [actor, file] : transport->publishers_to_files_)
+    sizes[transport->publishers_to_locations_.at(actor)] = file_system_->file_size(file->get_path());
+  return sizes;
+}
+
 std::shared_ptr<FileTransport> FileEngine::get_file_transport() const
 {
   auto transport = std::dynamic_pointer_cast<FileTransport>(get_transport());
@@ -98,6 +128,70 @@ std::string FileEngine::get_path_to_dataset() const
   return partition_->get_name() + working_directory_ + "/" + dataset_ + "/";
 }
 
+// The last publisher to end a transaction appends its index record, sized from the blocks actually written, to the
+// metadata index file. This write is waited for like the data writes of this publisher.
+void FileEngine::write_metadata_index(sg4::ActorPtr self, unsigned int transaction_id)
+{
+  auto size = get_stream()->add_metadata_index_record(transaction_id);
+  if (size == 0)
+    return;
+  if (!metadata_index_file_)
+    metadata_index_file_ = file_system_->open(get_path_to_metadata_index(), "a");
+  XBT_DEBUG("Write %llu bytes of metadata for transaction %u in '%s'", size, transaction_id,
+            metadata_index_file_->get_path().c_str());
+  auto write = metadata_index_file_->write_async(size, true);
+  write->on_this_completion_cb([this, self, write](sg4::Io const&) {
+    pub_activities_completed_->notify_all();
+    if (auto* writes = file_pub_transaction_.find(self))
+      writes->erase(write);
+  });
+  file_pub_transaction_[self].push(write);
+}
+
+// Subscribers have to read the index records of the transactions they get before knowing where their blocks are.
+// Records are appended in transaction order, so the records of consecutive transactions are read at once.
+void FileEngine::read_metadata_index(sg4::ActorPtr self, unsigned int begin, unsigned int count)
+{
+  auto [offset, size] = get_stream()->get_metadata_index_records(begin, count);
+  if (size == 0 || !file_system_->file_exists(get_path_to_metadata_index()))
+    return;
+  auto file = file_system_->open(get_path_to_metadata_index(), "r");
+  file->seek(static_cast<sg_offset_t>(offset));
+  XBT_DEBUG("Read %llu bytes of metadata for %u transaction(s) from %u in '%s'", size, count, begin,
+            file->get_path().c_str());
+  file_sub_transaction_[self].push(file->read_async(size));
+  try {
+    file_sub_transaction_[self].wait_all();
+  } catch (const simgrid::CancelException&) {
+    if (!is_canceled())
+      throw;
+    drain(file_sub_transaction_[self]);
+  }
+  file_sub_transaction_[self].clear();
+  file->close();
+  if (is_transaction_canceled(current_sub_transaction_id_)) {
+    sub_transaction_in_progress_ = false;
+    throw TransactionCanceledException(XBT_THROW_POINT);
+  }
+}
+
+// The record of the current transaction is read when it begins. A subscriber that selected a range of transactions also
+// reads the records of the other ones when it gets the Variable.
+void FileEngine::read_selected_metadata_index(sg4::ActorPtr self, const Variable& var)
+{
+  if (!get_stream()->does_simulate_metadata_io() || !var.subscriber_has_a_transaction_selection(self))
+    return;
+  auto [begin, count] = var.get_subscriber_transaction_selection(self);
+  auto end            = begin + count;
+  auto current        = current_sub_transaction_id_;
+  if (begin < current)
+    read_metadata_index(self, begin, std::min(end, current) - begin);
+  if (end > current + 1) {
+    auto after_current = std::max(begin, current + 1);
+    read_metadata_index(self, after_current, end - after_current);
+  }
+}
+
 void FileEngine::begin_pub_transaction()
 {
   if (is_transaction_canceled(current_pub_transaction_id_ + 1))
@@ -126,33 +220,53 @@ void FileEngine::begin_pub_transaction()
   }
 }
 
-void FileEngine::end_pub_transaction()
+// Start the writes queued by the put() operations of the calling publisher since the last call, with what its put
+// buffer holds as a last write
+void FileEngine::perform_pub_puts()
 {
   auto self      = sg4::Actor::self();
   auto transport = get_file_transport();
-
-  // This is the end of the first transaction, create a barrier
-  if (auto pub_barrier = get_publishers().get_or_create_barrier())
-    XBT_DEBUG("Barrier created for %zu publishers", get_publishers().count());
+  transport->flush_put_buffer(self);
 
   // Publisher gets the list of files and size to write that has been build during the put() operations
   auto to_write = transport->get_to_write_in_transaction_by_actor(self);
+  transport->clear_to_write_in_transaction(self);
 
-  // Start the write activities for that transaction
-  XBT_DEBUG("Start the %d publish activities for the transaction", file_pub_transaction_[self].size());
+  XBT_DEBUG("Start %zu publish activities for the transaction", to_write.size());
   for (const auto& [file, size] : to_write) {
     auto write = file->write_async(size, true);
     write->on_this_completion_cb([this, self, write, size](sg4::Io const&) {
       XBT_DEBUG("%llu bytes have been written for Actor %s", size, self->get_cname());
       pub_activities_completed_->notify_all();
-      file_pub_transaction_[self].erase(write);
+      if (auto* writes = file_pub_transaction_.find(self))
+        writes->erase(write);
     });
     file_pub_transaction_[self].push(write);
   }
+}
+
+void FileEngine::end_pub_transaction()
+{
+  auto self = sg4::Actor::self();
+
+  // This is the end of the first transaction, create a barrier
+  if (auto pub_barrier = get_publishers().get_or_create_barrier())
+    XBT_DEBUG("Barrier created for %zu publishers", get_publishers().count());
+
+  // Start the write activities for what remains of that transaction
+  perform_pub_puts();
+
+  // Gather the metadata of this transaction while the data is being written
+  aggregate_metadata();
 
   if (get_publishers().is_last_at_barrier()) {
     // Mark this transaction as over
     pub_transaction_in_progress_ = false;
+    // Sizing the index record sorts the blocks of this transaction. Do it before sealing the transaction, which may
+    // move these blocks out of memory and would make the index record read them back.
+    if (get_stream()->does_simulate_metadata_io())
+      write_metadata_index(self, current_pub_transaction_id_);
+    get_stream()->seal_transaction_metadata(current_pub_transaction_id_);
     // A new pub transaction has been completed, notify subscribers
     XBT_DEBUG("Notify subscribers that transaction %u is over", completed_pub_transaction_id_);
     completed_pub_transaction_id_++;
@@ -173,9 +287,12 @@ void FileEngine::pub_close()
     std::unique_lock lock(*(get_publishers().get_mutex()));
     pub_activities_completed_->wait(lock);
   }
-  transport->clear_to_write_in_transaction(self);
+  // Writes still pending in a canceled transaction stay where cancel_activities() finds them
+  if (file_pub_transaction_[self].empty())
+    file_pub_transaction_.erase(self);
+  transport->remove_actor(self);
 
-  get_publishers().remove(self);
+  remove_publisher(self);
 
   // Synchronize Publishers on engine closing
   if (get_publishers().is_last_at_barrier()) {
@@ -184,8 +301,11 @@ void FileEngine::pub_close()
     close_stream();
     XBT_DEBUG("Closing opened files");
     transport->close_pub_files();
+    if (metadata_index_file_)
+      metadata_index_file_->close();
     XBT_DEBUG("Engine '%s' is now closed for all publishers ", get_cname());
-    get_stream()->export_metadata_to_file();
+    get_stream()->export_metadata_to_file(get_file_sizes());
+    transport->clear_pub_files();
     // No more transactions will ever be produced: release any subscriber blocked waiting for one.
     mark_pub_stream_ended();
     pub_transaction_completed_->notify_all();
@@ -202,6 +322,9 @@ void FileEngine::begin_sub_transaction()
     sub_transaction_in_progress_ = true;
     current_sub_transaction_id_++;
     XBT_DEBUG("Subscribe Transaction %u started by %s", current_sub_transaction_id_, sg4::Actor::self()->get_cname());
+    // Imported metadata is read one transaction at a time, as subscribers reach it
+    if (get_stream()->does_import_metadata() && current_sub_transaction_id_ <= completed_pub_transaction_id_)
+      get_stream()->load_transaction_metadata(current_sub_transaction_id_);
   }
 
   // We have publishers on that stream, wait for them to complete a transaction first
@@ -227,6 +350,9 @@ void FileEngine::begin_sub_transaction()
     sub_transaction_in_progress_ = false;
     throw EndOfStreamException(XBT_THROW_POINT);
   }
+
+  if (get_stream()->does_simulate_metadata_io())
+    read_metadata_index(sg4::Actor::self(), current_sub_transaction_id_, 1);
 }
 
 void FileEngine::end_sub_transaction()
@@ -288,8 +414,9 @@ void FileEngine::end_sub_transaction()
     XBT_DEBUG("Barrier created for %zu subscribers", get_subscribers().count());
 
   // Evict this transaction's metadata once all subscribers have completed their reads.
-  // Only applies in the concurrent streaming scenario (pub was registered on this same engine).
-  if (pub_ever_present()) {
+  // Only applies in the concurrent streaming scenario (pub was registered on this same engine) and when the metadata is
+  // imported from a file, from which an evicted transaction can be read again.
+  if (pub_ever_present() || get_stream()->does_import_metadata()) {
     unsigned int tx_to_evict = 0;
     {
       std::unique_lock lock(*get_subscribers().get_mutex());
@@ -301,6 +428,10 @@ void FileEngine::end_sub_transaction()
     if (tx_to_evict > 0)
       if (auto s = get_stream())
         s->flush_and_evict_transaction(tx_to_evict);
+  } else if (auto s = get_stream()) {
+    // Sequential scenario: the metadata is kept for later readers, but transactions read back from the spill store
+    // have to leave memory again
+    s->enforce_metadata_memory_budget();
   }
 
   // Mark this transaction as over
@@ -312,7 +443,10 @@ void FileEngine::sub_close()
   auto self = sg4::Actor::self();
   XBT_DEBUG("Subscriber '%s' is closing the engine", self->get_cname());
 
-  get_subscribers().remove(self);
+  if (const auto* reads = file_sub_transaction_.find(self); reads && reads->empty())
+    file_sub_transaction_.erase(self);
+  get_file_transport()->remove_actor(self);
+  remove_subscriber(self);
   // Synchronize subscribers on engine closing
   if (get_subscribers().is_last_at_barrier()) {
     XBT_DEBUG("All subscribers have called the Engine::close() function");
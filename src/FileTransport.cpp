@@ -5,6 +5,8 @@
 
 #include <simgrid/s4u/Actor.hpp>
 
+#include <algorithm>
+
 #include "dtlmod/DTLException.hpp"
 #include "dtlmod/FileEngine.hpp"
 #include "dtlmod/FileTransport.hpp"
@@ -28,7 +30,9 @@ void FileTransport::add_publisher(unsigned long publisher_id)
   XBT_DEBUG("Actor '%s' is opening file '%s'", self->get_cname(), filename.c_str());
   // Keep track of the files opened by publishers for this engine to properly close them later
   // Files are opened in 'append' mode to prevent overwritting
-  publishers_to_files_[self] = e->get_file_system()->open(filename, "a");
+  auto file                      = e->get_file_system()->open(filename, "a");
+  publishers_to_files_[self]     = file;
+  publishers_to_locations_[self] = e->get_stream()->get_location_table()->intern(file->get_path());
 }
 
 void FileTransport::put(const std::shared_ptr<Variable>& var, size_t size)
@@ -38,10 +42,34 @@ void FileTransport::put(const std::shared_ptr<Variable>& var, size_t size)
   auto tid  = get_engine()->get_current_transaction();
   auto self = sg4::Actor::self();
   auto file = publishers_to_files_[self];
-  var->add_transaction_metadata(tid, self, file->get_path());
+  var->add_transaction_metadata(tid, self, publishers_to_locations_[self]);
+
+  auto* e       = static_cast<FileEngine*>(get_engine());
+  auto capacity = e->get_stream()->get_put_buffer_capacity();
+  if (capacity == 0) {
+    XBT_DEBUG("Actor '%s' is writing %lu bytes into file '%s'", self->get_cname(), size, file->get_path().c_str());
+    to_write_in_transaction_[self].emplace_back(file, size);
+    return;
+  }
+
+  // Write what the buffer holds before this put overflows it, then write the buffer as soon as it is full. A put
+  // larger than the buffer is thus written on its own.
+  XBT_DEBUG("Actor '%s' is buffering %lu bytes for file '%s'", self->get_cname(), size, file->get_path().c_str());
+  if (auto buffered = put_buffers_[self]; buffered > 0 && buffered + size > capacity)
+    e->perform_pub_puts();
+  put_buffers_[self] += size;
+  if (put_buffers_[self] >= capacity)
+    e->perform_pub_puts();
+}
 
-  XBT_DEBUG("Actor '%s' is writing %lu bytes into file '%s'", self->get_cname(), size, file->get_path().c_str());
-  to_write_in_transaction_[self].emplace_back(file, size);
+void FileTransport::flush_put_buffer(sg4::ActorPtr actor)
+{
+  auto* buffered = put_buffers_.find(actor);
+  if (buffered == nullptr || *buffered == 0)
+    return;
+  XBT_DEBUG("Actor '%s' flushes its put buffer of %llu bytes", actor->get_cname(), *buffered);
+  to_write_in_transaction_[actor].emplace_back(publishers_to_files_[actor], *buffered);
+  *buffered = 0;
 }
 
 void FileTransport::close_pub_files() const
@@ -58,15 +86,28 @@ void FileTransport::close_pub_files() const
 
 void FileTransport::get(const std::shared_ptr<Variable>& var)
 {
-  auto self = sg4::Actor::self();
-  auto fs   = static_cast<FileEngine*>(get_engine())->get_file_system();
-
-  // Determine which files contain blocks of the requested (selection of) the variable
-  auto blocks = check_selection_and_get_blocks_to_get(var);
-
-  for (const auto& [filename, size] : blocks) {
+  auto self       = sg4::Actor::self();
+  auto* e         = static_cast<FileEngine*>(get_engine());
+  auto fs         = e->get_file_system();
+  const auto& loc = var->get_metadata()->get_locations();
+
+  // The blocks of the selected transactions can only be found once their index records are read
+  e->read_selected_metadata_index(self, *var);
+
+  // Determine which files contain blocks of the requested (selection of) the variable, and in how many I/O operations
+  // they can be read if these operations are modeled
+  auto min_io_size = e->get_stream()->get_min_io_size();
+  std::vector<size_t> num_operations;
+  auto blocks = check_selection_and_get_blocks_to_get(var, min_io_size > 0 ? &num_operations : nullptr);
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    auto [location, size] = blocks[i];
     // if there is indeed something to read in this block
     if (size > 0) {
+      // Each I/O operation transfers at least min_io_size bytes, so reading many short runs costs more than their size
+      if (min_io_size > 0)
+        size = std::max<sg_size_t>(size, num_operations[i] * min_io_size);
+      const auto& filename = loc->get_name(location);
       // open the corresponding file in read mode.
       XBT_DEBUG("Actor '%s' is opening file '%s'", self->get_cname(), filename.c_str());
       auto file = fs->open(filename, "r");
@@ -85,6 +126,27 @@ void FileTransport::close_sub_files(sg4::ActorPtr self)
   }
 }
 
+////////////////////////////////////////////
+////////////// INTROSPECTION ///////////////
+////////////////////////////////////////////
+
+void FileTransport::add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const
+{
+  // Per-actor state takes one slot per actor that ever got one, whether it holds a value for this actor or not
+  structures["publishers_to_files"] = publishers_to_files_.get_num_slots() * publishers_to_files_.get_slot_size();
+  structures["publishers_to_locations"] =
+      publishers_to_locations_.get_num_slots() * publishers_to_locations_.get_slot_size();
+  for (const auto& [name, per_actor] : {std::make_pair("to_write_in_transaction", &to_write_in_transaction_),
+                                        std::make_pair("to_read_in_transaction", &to_read_in_transaction_)}) {
+    size_t footprint = per_actor->get_num_slots() * per_actor->get_slot_size();
+    for (const auto& [actor, files] : *per_actor)
+      footprint += files.capacity() * sizeof(files[0]);
+    structures[name] = footprint;
+  }
+  // Put buffers are simulated: only the slots that record how much of each one is used take host memory
+  structures["put_buffers"] = put_buffers_.get_num_slots() * put_buffers_.get_slot_size();
+}
+
 /// \endcond
 
 } // namespace dtlmod
@@ -3,85 +3,677 @@
 /* This program is free software; you can redistribute it and/or modify it
  * under the terms of the license (GNU LGPL) which comes with this package. */
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
 
+#include "dtlmod/BinaryMetadataWriter.hpp"
+#include "dtlmod/MetadataJournal.hpp"
+#include "dtlmod/MetadataReader.hpp"
+#include "dtlmod/Stream.hpp"
 #include "dtlmod/Variable.hpp"
 
 XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_metadata, dtlmod, "DTL logging about Metadata");
 
 namespace dtlmod {
 /// \cond EXCLUDE_FROM_DOCUMENTATION
-void Metadata::add_transaction(unsigned int id,
-                               const std::pair<std::vector<size_t>, std::vector<size_t>>& start_and_count,
-                               const std::string& location, sg4::ActorPtr publisher)
+void BlockTable::add(const Extents& start, const Extents& count, LocationId location_id, unsigned int publisher_id,
+                     const std::optional<ValueRange>& value_range)
 {
-  transaction_infos_[id][start_and_count] = std::make_pair(location, publisher);
+  if (empty())
+    ndims_ = start.size();
+  xbt_assert(start.size() == ndims_ && count.size() == ndims_,
+             "Internal error: all the blocks of a transaction must have the same number of dimensions");
+  constexpr double lowest  = -std::numeric_limits<double>::infinity();
+  constexpr double highest = std::numeric_limits<double>::infinity();
+  if (value_range && value_mins_.empty()) { // The blocks added so far may hold any value
+    value_mins_.assign(size(), lowest);
+    value_maxs_.assign(size(), highest);
+  }
+  starts_.insert(starts_.end(), start.begin(), start.end());
+  counts_.insert(counts_.end(), count.begin(), count.end());
+  location_ids_.push_back(location_id);
+  publisher_ids_.push_back(publisher_id);
+  if (value_range || has_value_ranges()) {
+    value_mins_.push_back(value_range ? value_range->first : lowest);
+    value_maxs_.push_back(value_range ? value_range->second : highest);
+  }
+  sealed_ = false;
+  index_.reset();
+  fingerprint_.reset();
+}
+
+void BlockTable::seal()
+{
+  if (sealed_)
+    return;
+  sealed_ = true;
+
+  // Order the blocks by (start, count). The sort is stable so that among blocks written at the same place, the last
+  // one to arrive comes last in its run and is the one kept.
+  auto compare = [this](size_t a, size_t b) {
+    auto by_start =
+        std::lexicographical_compare(get_start(a), get_start(a) + ndims_, get_start(b), get_start(b) + ndims_);
+    if (by_start || !std::equal(get_start(a), get_start(a) + ndims_, get_start(b)))
+      return by_start;
+    return std::lexicographical_compare(get_count(a), get_count(a) + ndims_, get_count(b), get_count(b) + ndims_);
+  };
+  auto same_place = [this](size_t a, size_t b) {
+    return std::equal(get_start(a), get_start(a) + ndims_, get_start(b)) &&
+           std::equal(get_count(a), get_count(a) + ndims_, get_count(b));
+  };
+
+  std::vector<size_t> order(size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), compare);
+  keep_in_order(order, same_place);
+}
+
+void BlockTable::seal_in_writer_order(const std::vector<size_t>& writer_ranks)
+{
+  if (sealed_)
+    return;
+  sealed_ = true;
+
+  // The sort is stable, so that the last block put by a writer comes last in its run and is the one kept
+  auto rank_of = [this, &writer_ranks](size_t block) { return writer_ranks[publisher_ids_[block]]; };
+  std::vector<size_t> order(size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&rank_of](size_t a, size_t b) { return rank_of(a) < rank_of(b); });
+  keep_in_order(order, [&rank_of](size_t a, size_t b) { return rank_of(a) == rank_of(b); });
+}
+
+template <typename SamePlace> void BlockTable::keep_in_order(const std::vector<size_t>& order, SamePlace same_place)
+{
+  std::vector<size_t> starts;
+  std::vector<size_t> counts;
+  std::vector<LocationId> location_ids;
+  std::vector<unsigned int> publisher_ids;
+  std::vector<double> value_mins;
+  std::vector<double> value_maxs;
+  starts.reserve(starts_.size());
+  counts.reserve(counts_.size());
+  location_ids.reserve(size());
+  publisher_ids.reserve(size());
+  for (size_t i = 0; i < order.size(); i++) {
+    auto block = order[i];
+    if (i + 1 < order.size() && same_place(block, order[i + 1]))
+      continue; // Overwritten by a later block
+    starts.insert(starts.end(), get_start(block), get_start(block) + ndims_);
+    counts.insert(counts.end(), get_count(block), get_count(block) + ndims_);
+    location_ids.push_back(location_ids_[block]);
+    publisher_ids.push_back(publisher_ids_[block]);
+    if (has_value_ranges()) {
+      value_mins.push_back(value_mins_[block]);
+      value_maxs.push_back(value_maxs_[block]);
+    }
+  }
+  starts_        = std::move(starts);
+  counts_        = std::move(counts);
+  location_ids_  = std::move(location_ids);
+  publisher_ids_ = std::move(publisher_ids);
+  value_mins_    = std::move(value_mins);
+  value_maxs_    = std::move(value_maxs);
+}
+
+size_t BlockTable::join(size_t dim)
+{
+  xbt_assert(sealed_ && (empty() || dim < ndims_), "Internal error: cannot join the blocks along dimension %zu", dim);
+  size_t extent = 0;
+  for (size_t b = 0; b < size(); b++) {
+    starts_[b * ndims_ + dim] = extent;
+    extent += counts_[b * ndims_ + dim];
+  }
+  index_.reset();
+  fingerprint_.reset();
+  return extent;
+}
+
+void BlockTable::build_index() const
+{
+  xbt_assert(sealed_, "Internal error: cannot index a BlockTable that is not sealed");
+  if (!index_ && size() >= MIN_BLOCKS_TO_INDEX)
+    index_ = std::make_shared<const BlockIndex>(*this);
+}
+
+void BlockTable::find_intersecting_blocks(const Extents& start, const Extents& count, std::vector<size_t>& hits) const
+{
+  build_index();
+  if (index_) {
+    index_->find_intersecting_blocks(*this, start, count, hits);
+    return;
+  }
+  for (size_t b = 0; b < size(); b++) {
+    const auto* block_start = get_start(b);
+    const auto* block_count = get_count(b);
+    bool overlaps           = true;
+    for (size_t d = 0; d < ndims_ && overlaps; d++)
+      overlaps = std::max(block_start[d], start[d]) < std::min(block_start[d] + block_count[d], start[d] + count[d]);
+    if (overlaps)
+      hits.push_back(b);
+  }
+}
+
+size_t BlockTable::get_overlap_volume(const Extents& start, const Extents& count, const Extents& stride,
+                                      size_t block) const noexcept
+{
+  const auto* block_start = get_start(block);
+  const auto* block_count = get_count(block);
+  size_t volume           = 1;
+  for (size_t d = 0; d < ndims_ && volume > 0; d++) {
+    size_t from = std::max(block_start[d], start[d]);
+    size_t to   = std::min(block_start[d] + block_count[d], start[d] + count[d]);
+    if (to <= from)
+      return 0;
+    if (stride.empty())
+      volume *= to - from;
+    else // Elements at start + k * stride, with k in [ceil((from - start) / stride), ceil((to - start) / stride))
+      volume *= (to - start[d] + stride[d] - 1) / stride[d] - (from - start[d] + stride[d] - 1) / stride[d];
+  }
+  return volume;
+}
+
+size_t BlockTable::get_num_contiguous_runs(const Extents& start, const Extents& count, const Extents& stride,
+                                           size_t block) const noexcept
+{
+  const size_t* block_start = get_start(block);
+  const size_t* block_count = get_count(block);
+  // Walk the dimensions from the fastest one. As long as the intersection covers the block in a dimension, a run spans
+  // it. The first dimension it does not cover ends the runs, unless a stride splits it into one run per element.
+  // Every outer dimension then multiplies the number of runs.
+  size_t num_runs             = 1;
+  bool spans_inner_dimensions = true;
+  for (size_t d = ndims_; d-- > 0;) {
+    size_t from     = std::max(block_start[d], start[d]);
+    size_t to       = std::min(block_start[d] + block_count[d], start[d] + count[d]);
+    size_t selected = to - from;
+    bool strided    = not stride.empty() && stride[d] > 1;
+    if (strided)
+      selected = (to - start[d] + stride[d] - 1) / stride[d] - (from - start[d] + stride[d] - 1) / stride[d];
+    if (spans_inner_dimensions) {
+      if (selected == block_count[d])
+        continue;
+      spans_inner_dimensions = false;
+      if (not strided)
+        continue;
+    }
+    num_runs *= selected;
+  }
+  return num_runs;
+}
+
+bool BlockTable::has_same_layout(const BlockTable& other) const noexcept
+{
+  return ndims_ == other.ndims_ && starts_ == other.starts_ && counts_ == other.counts_ &&
+         location_ids_ == other.location_ids_ && publisher_ids_ == other.publisher_ids_ &&
+         value_mins_ == other.value_mins_ && value_maxs_ == other.value_maxs_;
+}
+
+size_t BlockTable::get_layout_fingerprint() const noexcept
+{
+  if (fingerprint_)
+    return *fingerprint_;
+  // FNV-1a over the words of the table
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix      = [&hash](uint64_t word) {
+    hash ^= word;
+    hash *= 1099511628211ULL;
+  };
+  auto mix_all = [&mix](const auto& values) {
+    mix(values.size());
+    for (const auto& v : values) {
+      uint64_t word = 0;
+      std::memcpy(&word, &v, sizeof(v));
+      mix(word);
+    }
+  };
+  mix(ndims_);
+  mix_all(starts_);
+  mix_all(counts_);
+  mix_all(location_ids_);
+  mix_all(publisher_ids_);
+  mix_all(value_mins_);
+  mix_all(value_maxs_);
+  fingerprint_ = static_cast<size_t>(hash);
+  return *fingerprint_;
+}
+
+size_t BlockTable::get_memory_footprint() const noexcept
+{
+  return sizeof(BlockTable) + (starts_.capacity() + counts_.capacity()) * sizeof(size_t) +
+         location_ids_.capacity() * sizeof(LocationId) + publisher_ids_.capacity() * sizeof(unsigned int) +
+         (value_mins_.capacity() + value_maxs_.capacity()) * sizeof(double) +
+         (index_ ? index_->get_memory_footprint() : 0);
+}
+
+unsigned int Metadata::get_publisher_id(sg4::ActorPtr publisher)
+{
+  auto [it, inserted] = publisher_ids_.try_emplace(publisher.get(), static_cast<unsigned int>(publishers_.size()));
+  if (inserted)
+    publishers_.push_back(publisher);
+  return it->second;
+}
+
+void Metadata::add_transaction(unsigned int id, const std::pair<Extents, Extents>& start_and_count,
+                               LocationId location, sg4::ActorPtr publisher,
+                               const std::optional<ValueRange>& value_range)
+{
+  const auto& [start, count] = start_and_count;
+  auto& blocks                = transaction_infos_[id];
+  if (!blocks)
+    blocks = std::make_shared<BlockTable>();
+  else if (blocks.use_count() > 1) // Shared layout: copy it before modifying it
+    blocks = std::make_shared<BlockTable>(*blocks);
+  blocks->add(start, count, location, get_publisher_id(publisher), value_range);
+}
+
+std::vector<size_t> Metadata::get_writer_ranks(const Variable& var) const
+{
+  // Publishers that the Engine does not know (anymore) come after the others, in the order in which they first put the
+  // Variable. Ranks must stay distinct, as the blocks of a same rank are those of a same writer.
+  auto stream = var.defined_in_stream_.lock();
+  std::vector<std::optional<unsigned int>> engine_ranks(publishers_.size());
+  size_t num_ranks = 0;
+  for (size_t id = 0; id < publishers_.size(); id++) {
+    engine_ranks[id] = stream ? stream->get_publisher_rank(publishers_[id].get()) : std::nullopt;
+    if (engine_ranks[id])
+      num_ranks = std::max(num_ranks, static_cast<size_t>(*engine_ranks[id]) + 1);
+  }
+  std::vector<size_t> ranks(publishers_.size());
+  for (size_t id = 0; id < publishers_.size(); id++)
+    ranks[id] = engine_ranks[id] ? *engine_ranks[id] : num_ranks + id;
+  return ranks;
+}
+
+const BlockTable& Metadata::seal(std::shared_ptr<BlockTable>& blocks)
+{
+  if (blocks->is_sealed())
+    return *blocks;
+  auto var = variable_.lock();
+  if (var && var->get_kind() != Variable::Kind::GlobalArray && reader_) {
+    // Imported blocks have no publisher, but they were exported in writer order, and already joined
+    blocks->seal_as_added();
+  } else if (var && var->get_kind() != Variable::Kind::GlobalArray) {
+    blocks->seal_in_writer_order(get_writer_ranks(*var));
+    if (var->get_kind() == Variable::Kind::JoinedArray)
+      blocks->join(var->get_joined_dimension());
+  } else
+    blocks->seal();
+  // Most simulations use the same domain decomposition at every step. Share the layout of the previous transaction
+  // when it is the same.
+  if (last_layout_ && last_layout_->has_same_layout(*blocks)) {
+    XBT_DEBUG("Reuse the block layout of a previous transaction (%zu blocks)", blocks->size());
+    blocks = last_layout_;
+  } else
+    last_layout_ = blocks;
+  return *blocks;
+}
+
+const BlockTable& Metadata::get_blocks_for_transaction(unsigned int id)
+{
+  static const BlockTable no_blocks;
+  auto it = find_transaction(id);
+  if (it == transaction_infos_.end())
+    return no_blocks;
+  return seal(it->second);
+}
+
+std::shared_ptr<const BlockTable> Metadata::get_layout(unsigned int id)
+{
+  auto it = find_transaction(id);
+  if (it == transaction_infos_.end())
+    return nullptr;
+  seal(it->second);
+  return it->second;
+}
+
+size_t Metadata::get_index_size(unsigned int tx_id)
+{
+  const auto& blocks = get_blocks_for_transaction(tx_id);
+  if (blocks.empty())
+    return 0;
+  // A transaction record, then the starts, counts, and location ids of the blocks, padded to 8 bytes
+  auto size = sizeof(binary_metadata::TransactionRecord) + blocks.size() * get_index_entry_size(blocks.get_num_dims());
+  return (size + 7) / 8 * 8;
+}
+
+decltype(Metadata::transaction_infos_)::iterator Metadata::find_transaction(unsigned int id)
+{
+  auto it = transaction_infos_.find(id);
+  if (it != transaction_infos_.end())
+    return it;
+  // A spilled transaction, or an imported transaction evicted once all the subscribers read it, is read again
+  if (auto spilled = spilled_.find(id); spilled != spilled_.end())
+    return reload_transaction(spilled);
+  if (reader_ && id <= imported_transaction_)
+    return read_transaction(id);
+  return transaction_infos_.end();
+}
+
+decltype(Metadata::transaction_infos_)::iterator
+Metadata::reload_transaction(decltype(spilled_)::const_iterator spilled)
+{
+  const auto& record = spilled->second;
+  auto blocks        = cached_layout_.lock();
+  if (blocks && cached_record_.offset == record.offset) {
+    XBT_DEBUG("Transaction %u shares a layout still in memory (%zu blocks)", spilled->first, blocks->size());
+  } else {
+    blocks         = spill_store_->read(record);
+    cached_layout_ = blocks;
+    cached_record_ = record;
+  }
+  return transaction_infos_.try_emplace(spilled->first, std::move(blocks)).first;
+}
+
+decltype(Metadata::transaction_infos_)::iterator Metadata::read_transaction(unsigned int id)
+{
+  auto blocks = reader_->get_blocks(reader_variable_, id);
+  if (!blocks) // This Variable was not written in that transaction
+    return transaction_infos_.end();
+
+  auto table = std::make_shared<BlockTable>();
+  Extents start(blocks->num_dims);
+  Extents count(blocks->num_dims);
+  for (size_t b = 0; b < blocks->num_blocks; b++) {
+    std::copy_n(blocks->get_start(b), blocks->num_dims, start.begin());
+    std::copy_n(blocks->get_count(b), blocks->num_dims, count.begin());
+    table->add(start, count, reader_locations_->at(blocks->get_location_id(b)), 0);
+  }
+  XBT_DEBUG("Read %zu blocks of transaction %u from the imported metadata file", blocks->num_blocks, id);
+  return transaction_infos_.try_emplace(id, std::move(table)).first;
+}
+
+void Metadata::record_shape(unsigned int tx_id, const std::vector<size_t>& shape)
+{
+  // Shapes are only stored when they change, so that a Variable whose shape is fixed keeps a single one
+  if (shapes_.empty() || shapes_.rbegin()->second != shape)
+    shapes_[tx_id] = shape;
+}
+
+std::vector<size_t> Metadata::get_shape(unsigned int tx_id) const
+{
+  auto it = shapes_.upper_bound(tx_id);
+  if (it != shapes_.begin())
+    return std::prev(it)->second;
+  if (reader_)
+    return reader_->get_shape(reader_variable_);
+  auto var = variable_.lock();
+  xbt_assert(var, "Metadata::get_shape called after its Variable has been destroyed");
+  return var->get_shape();
+}
+
+void Metadata::seal_transaction(unsigned int tx_id)
+{
+  auto it = transaction_infos_.find(tx_id);
+  if (it == transaction_infos_.end())
+    return;
+  const auto& blocks = seal(it->second);
+  blocks.build_index();
+
+  // All the publishers put their block: the extent of a joined array along its joined dimension is now known
+  auto var = variable_.lock();
+  if (var && var->get_kind() == Variable::Kind::JoinedArray && !blocks.empty()) {
+    auto dim         = var->get_joined_dimension();
+    auto last        = blocks.size() - 1;
+    var->shape_[dim] = blocks.get_start(last)[dim] + blocks.get_count(last)[dim];
+    record_shape(tx_id, var->shape_);
+  }
+}
+
+size_t Metadata::get_num_layouts() const
+{
+  std::unordered_set<const BlockTable*> layouts;
+  for (const auto& [id, blocks] : transaction_infos_)
+    layouts.insert(blocks.get());
+  return layouts.size();
 }
 
-static void write_block_entries(std::ofstream& ostream,
-                                const std::map<std::pair<std::vector<size_t>, std::vector<size_t>>,
-                                               std::pair<std::string, sg4::ActorPtr>, std::less<>>& transaction)
+size_t Metadata::get_memory_footprint() const noexcept
 {
-  for (const auto& [block_info, location] : transaction) {
-    const auto& [block_start, block_count] = block_info;
-    const auto& [where, actor]             = location;
+  size_t footprint = sizeof(Metadata);
+  std::unordered_set<const BlockTable*> counted;
+  for (const auto& [id, blocks] : transaction_infos_) {
+    footprint += sizeof(unsigned int) + sizeof(blocks) + 4 * sizeof(void*); // map node overhead
+    if (counted.insert(blocks.get()).second)
+      footprint += blocks->get_memory_footprint() + 2 * sizeof(long); // shared_ptr control block
+  }
+  if (last_layout_ && counted.find(last_layout_.get()) == counted.end())
+    footprint += last_layout_->get_memory_footprint();
+  footprint += spilled_.size() * (sizeof(unsigned int) + sizeof(MetadataSpillStore::Record) + 4 * sizeof(void*));
+  for (const auto& [id, shape] : shapes_)
+    footprint += sizeof(id) + sizeof(shape) + shape.capacity() * sizeof(size_t) + 4 * sizeof(void*);
+  footprint += publishers_.capacity() * sizeof(sg4::ActorPtr) +
+               publisher_ids_.size() * (sizeof(void*) + sizeof(unsigned int) + 2 * sizeof(void*));
+  return footprint;
+}
+
+void Metadata::add_transaction_footprints(std::map<unsigned int, size_t, std::less<>>& footprints) const
+{
+  const BlockTable* previous = nullptr;
+  for (const auto& [id, blocks] : transaction_infos_) {
+    auto& footprint = footprints[id];
+    footprint += sizeof(unsigned int) + sizeof(blocks) + 4 * sizeof(void*); // map node overhead
+    // Only consecutive transactions share a layout
+    if (blocks.get() != previous)
+      footprint += blocks->get_memory_footprint() + 2 * sizeof(long); // shared_ptr control block
+    previous = blocks.get();
+  }
+}
+
+// When the shape of the Variable changed, the first transaction with each shape gives it after its id
+void Metadata::write_transaction_header(std::ostream& ostream, unsigned int tx_id) const
+{
+  ostream << "  Transaction " << tx_id << ":";
+  if (auto it = shapes_.find(tx_id); it != shapes_.end() && shapes_.size() > 1) {
+    ostream << " {";
+    for (size_t d = 0; d < it->second.size(); d++)
+      ostream << (d > 0 ? "," : "") << it->second[d];
+    ostream << "}";
+  }
+  ostream << "\n";
+}
+
+void Metadata::write_block_entries(std::ostream& ostream, const BlockTable& blocks) const
+{
+  const auto ndims = blocks.get_num_dims();
+  for (size_t b = 0; b < blocks.size(); b++) {
+    const auto* block_start = blocks.get_start(b);
+    const auto* block_count = blocks.get_count(b);
+    const auto& where       = locations_->get_name(blocks.get_location_id(b));
 
     ostream << "    " << where.c_str() << ": [";
-    XBT_DEBUG("    Actor %s wrote:", actor->get_cname());
-    unsigned long last = block_start.size() - 1;
+    if (auto publisher_id = blocks.get_publisher_id(b); publisher_id < publishers_.size()) // imported blocks have none
+      XBT_DEBUG("    Actor %s wrote:", publishers_[publisher_id]->get_cname());
+    unsigned long last = ndims - 1;
     for (unsigned long i = 0; i < last; i++) {
       ostream << block_start[i] << ":" << block_start[i] + block_count[i] << ", ";
       XBT_DEBUG("      Dimension %lu : [%zu..%zu]", i + 1, block_start[i], block_start[i] + block_count[i]);
     }
-    ostream << block_start[last] << ":" << block_start[last] + block_count[last] << "]" << std::endl;
+    ostream << block_start[last] << ":" << block_start[last] + block_count[last] << "]\n";
     XBT_DEBUG("      Dimension %lu : [%zu..%zu]", last + 1, block_start[last], block_start[last] + block_count[last]);
     XBT_DEBUG("    in: %s", where.c_str());
   }
 }
 
-void Metadata::write_transaction_to_stream(unsigned int tx_id, std::ofstream& out)
+void Metadata::write_transaction_to_journal(unsigned int tx_id, MetadataJournal& journal)
 {
-  auto it = transaction_infos_.find(tx_id);
+  auto it = find_transaction(tx_id);
   if (it == transaction_infos_.end())
     return;
+  auto var = variable_.lock();
+  xbt_assert(var, "Metadata::write_transaction_to_journal called after its Variable has been destroyed");
   XBT_DEBUG("  Transaction %u:", tx_id);
-  out << "  Transaction " << tx_id << ":" << std::endl;
-  write_block_entries(out, it->second);
+  auto& out = journal.get_entries(var->get_name());
+  write_transaction_header(out, tx_id);
+  write_block_entries(out, seal(it->second));
   flushed_count_++;
   transaction_infos_.erase(it);
+  spilled_.erase(tx_id);
 }
 
 void Metadata::evict_transaction(unsigned int tx_id)
 {
   transaction_infos_.erase(tx_id);
+  spilled_.erase(tx_id);
 }
 
-void Metadata::export_to_file(std::ofstream& ostream, const std::string& prog_file_path) const
+std::vector<unsigned int> Metadata::get_resident_transaction_ids() const
+{
+  std::vector<unsigned int> ids;
+  ids.reserve(transaction_infos_.size());
+  for (const auto& [id, blocks] : transaction_infos_)
+    ids.push_back(id);
+  return ids;
+}
+
+std::vector<unsigned int> Metadata::get_transaction_ids() const
+{
+  auto resident = get_resident_transaction_ids();
+  std::vector<unsigned int> spilled;
+  spilled.reserve(spilled_.size());
+  for (const auto& [id, record] : spilled_)
+    spilled.push_back(id);
+  std::vector<unsigned int> ids;
+  std::set_union(resident.begin(), resident.end(), spilled.begin(), spilled.end(), std::back_inserter(ids));
+  return ids;
+}
+
+decltype(Metadata::transaction_infos_)::const_iterator Metadata::find_latest_sealed_transaction() const
+{
+  auto it = std::find_if(transaction_infos_.rbegin(), transaction_infos_.rend(),
+                         [](const auto& tx) { return tx.second->is_sealed(); });
+  return it == transaction_infos_.rend() ? transaction_infos_.end() : std::prev(it.base());
+}
+
+size_t Metadata::get_spillable_footprint() const noexcept
+{
+  auto latest = find_latest_sealed_transaction();
+  if (latest == transaction_infos_.end())
+    return 0;
+  // Tables shared with the newest sealed transaction or kept as the last layout are not freed by spilling
+  std::unordered_set<const BlockTable*> counted{latest->second.get(), last_layout_.get()};
+  size_t footprint = 0;
+  for (auto it = transaction_infos_.begin(); it != latest; ++it) {
+    if (!it->second->is_sealed())
+      continue;
+    footprint += sizeof(unsigned int) + sizeof(it->second) + 4 * sizeof(void*); // map node overhead
+    if (counted.insert(it->second.get()).second)
+      footprint += it->second->get_memory_footprint() + 2 * sizeof(long); // shared_ptr control block
+  }
+  return footprint;
+}
+
+size_t Metadata::spill_transaction(unsigned int tx_id, const std::shared_ptr<MetadataSpillStore>& store)
+{
+  auto it = transaction_infos_.find(tx_id);
+  if (it == transaction_infos_.end() || !it->second->is_sealed() || it == find_latest_sealed_transaction())
+    return 0;
+  // Imported transactions can be read again from the imported file, and reloaded ones are already in the store
+  if (!reader_ && spilled_.find(tx_id) == spilled_.end()) {
+    spill_store_ = store;
+    if (cached_layout_.lock() != it->second) {
+      cached_record_ = store->write(*it->second);
+      cached_layout_ = it->second;
+    }
+    spilled_.try_emplace(tx_id, cached_record_);
+  }
+
+  auto blocks = std::move(it->second);
+  transaction_infos_.erase(it);
+  size_t freed = sizeof(unsigned int) + sizeof(blocks) + 4 * sizeof(void*);
+  if (blocks.use_count() == 1) // Not shared with another transaction nor kept as the last layout
+    freed += blocks->get_memory_footprint() + 2 * sizeof(long);
+  return freed;
+}
+
+template <typename F> void Metadata::for_each_transaction(F&& f)
+{
+  std::shared_ptr<BlockTable> previous; // keeps a layout shared by the next spilled transactions in memory
+  for (auto id : get_transaction_ids()) {
+    bool resident = transaction_infos_.find(id) != transaction_infos_.end();
+    auto it       = find_transaction(id);
+    f(id, it->second);
+    previous = it->second;
+    if (!resident) // Only read back from the spill store for this export
+      transaction_infos_.erase(it);
+  }
+}
+
+void Metadata::export_to_file(std::ostream& ostream, MetadataJournal* journal)
 {
   auto var = variable_.lock();
   xbt_assert(var, "Metadata::export_to_file called after its Variable has been destroyed");
   XBT_DEBUG("Variable %s:", var->get_cname());
-  unsigned int total = flushed_count_ + static_cast<unsigned int>(transaction_infos_.size());
+  unsigned int total = flushed_count_ + static_cast<unsigned int>(get_transaction_ids().size());
   ostream << var->get_element_size() << "\t" << var->get_cname() << "\t" << total;
   ostream << "*{";
   auto shape            = var->get_shape();
   const auto last_index = shape.size() - 1;
   for (unsigned int i = 0; i < last_index; i++)
     ostream << shape[i] << ",";
-  ostream << shape[last_index] << "}" << std::endl;
+  ostream << shape[last_index] << "}";
+  // The blocks of local and joined arrays are listed in the order of the ranks of their writers
+  if (var->get_kind() == Variable::Kind::LocalArray)
+    ostream << "\tlocal";
+  else if (var->get_kind() == Variable::Kind::JoinedArray)
+    ostream << "\tjoined:" << var->get_joined_dimension();
+  ostream << "\n";
 
-  // Copy already-flushed entries from the per-variable prog file (if any)
-  if (!prog_file_path.empty()) {
-    std::ifstream prog(prog_file_path, std::ios::binary);
-    ostream << prog.rdbuf();
-  }
+  // Copy already-flushed entries from the journal (if any)
+  if (journal)
+    journal->copy_entries(var->get_name(), ostream);
 
-  // Write remaining in-memory entries
-  for (const auto& [id, transaction] : transaction_infos_) {
+  // Write remaining entries, in memory or spilled
+  for_each_transaction([this, &ostream](unsigned int id, std::shared_ptr<BlockTable>& transaction) {
     XBT_DEBUG("  Transaction %u:", id);
-    ostream << "  Transaction " << id << ":" << std::endl;
-    write_block_entries(ostream, transaction);
-  }
+    write_transaction_header(ostream, id);
+    write_block_entries(ostream, seal(transaction));
+  });
+}
+
+void Metadata::write_transaction_to_binary(unsigned int tx_id, BinaryMetadataWriter& writer)
+{
+  auto it = find_transaction(tx_id);
+  if (it == transaction_infos_.end())
+    return;
+  auto var = variable_.lock();
+  xbt_assert(var, "Metadata::write_transaction_to_binary called after its Variable has been destroyed");
+  seal(it->second);
+  writer.add_transaction(var->get_name(), tx_id, it->second);
+  flushed_count_++;
+  transaction_infos_.erase(it);
+  spilled_.erase(tx_id);
+}
+
+void Metadata::import_from(std::shared_ptr<const MetadataReader> reader, size_t var,
+                           std::shared_ptr<const std::vector<LocationId>> location_ids)
+{
+  reader_           = std::move(reader);
+  reader_variable_  = var;
+  reader_locations_ = std::move(location_ids);
+}
+
+void Metadata::load_transaction(unsigned int tx_id)
+{
+  imported_transaction_ = std::max(imported_transaction_, tx_id);
+  if (transaction_infos_.find(tx_id) != transaction_infos_.end())
+    return;
+  // Sort and index the blocks before subscribers start querying them, as seal_transaction() does for publishers
+  if (auto it = read_transaction(tx_id); it != transaction_infos_.end())
+    seal(it->second).build_index();
+}
+
+void Metadata::export_to_binary(BinaryMetadataWriter& writer)
+{
+  auto var = variable_.lock();
+  xbt_assert(var, "Metadata::export_to_binary called after its Variable has been destroyed");
+  for_each_transaction([this, &var, &writer](unsigned int id, std::shared_ptr<BlockTable>& transaction) {
+    seal(transaction);
+    writer.add_transaction(var->get_name(), id, transaction);
+  });
 }
 /// \endcond
 
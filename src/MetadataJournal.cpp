@@ -0,0 +1,88 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include <algorithm>
+#include <cstdio>
+#include <xbt/log.h>
+
+#include "dtlmod/MetadataJournal.hpp"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_metadata_journal, dtlmod_metadata, "DTL logging about the metadata journal");
+
+namespace dtlmod {
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+
+void MetadataJournal::flush_if_needed()
+{
+  uint64_t pending = 0;
+  for (auto& [name, entries] : variables_)
+    pending += static_cast<uint64_t>(entries.pending.tellp());
+  if (pending >= FLUSH_THRESHOLD)
+    flush();
+}
+
+size_t MetadataJournal::get_memory_footprint()
+{
+  size_t footprint = sizeof(MetadataJournal);
+  for (auto& [name, entries] : variables_)
+    footprint += name.capacity() + sizeof(VariableEntries) + 4 * sizeof(void*) +
+                 static_cast<size_t>(entries.pending.tellp()) + entries.segments.capacity() * sizeof(Segment);
+  return footprint;
+}
+
+void MetadataJournal::flush()
+{
+  if (!out_.is_open())
+    out_.open(path_, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+  uint64_t start = offset_;
+  for (auto& [name, entries] : variables_) {
+    const auto& buffer = entries.pending.str();
+    if (buffer.empty())
+      continue;
+    entries.segments.push_back({offset_, buffer.size()});
+    out_.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    offset_ += buffer.size();
+    entries.pending.str("");
+  }
+  out_.flush();
+  XBT_DEBUG("Flushed %lu bytes to %s", static_cast<unsigned long>(offset_ - start), path_.c_str());
+}
+
+void MetadataJournal::copy_entries(const std::string& var_name, std::ostream& out)
+{
+  auto it = variables_.find(var_name);
+  if (it == variables_.end())
+    return;
+  auto& entries = it->second;
+
+  if (!entries.segments.empty()) {
+    out_.flush();
+    std::ifstream in(path_, std::ifstream::in | std::ifstream::binary);
+    std::vector<char> chunk(1024 * 1024);
+    for (const auto& segment : entries.segments) {
+      in.seekg(static_cast<std::streamoff>(segment.offset));
+      for (uint64_t left = segment.size; left > 0;) {
+        auto size = static_cast<std::streamsize>(std::min<uint64_t>(left, chunk.size()));
+        in.read(chunk.data(), size);
+        out.write(chunk.data(), size);
+        left -= static_cast<uint64_t>(size);
+      }
+    }
+  }
+  out << entries.pending.str();
+}
+
+void MetadataJournal::discard()
+{
+  if (out_.is_open()) {
+    out_.close();
+    std::remove(path_.c_str());
+  }
+  variables_.clear();
+  offset_ = 0;
+}
+/// \endcond
+
+} // namespace dtlmod
@@ -0,0 +1,221 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dtlmod/DTLException.hpp"
+#include "dtlmod/MetadataReader.hpp"
+
+XBT_LOG_EXTERNAL_DEFAULT_CATEGORY(dtlmod_binary_metadata);
+
+namespace dtlmod {
+using namespace binary_metadata;
+
+template <typename T> const T* MetadataReader::at(uint64_t offset, uint64_t count) const
+{
+  if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T))
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Section out of bounds at offset " + std::to_string(offset));
+  return reinterpret_cast<const T*>(data_ + offset);
+}
+
+MetadataReader::MetadataReader(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Cannot open " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    throw InvalidMetadataFileException(XBT_THROW_POINT, path + " is too short");
+  }
+  size_     = static_cast<size_t>(st.st_size);
+  void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Cannot map " + path);
+  data_ = static_cast<const char*>(map);
+
+  try {
+    header_ = at<Header>(0, 1);
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0)
+      throw InvalidMetadataFileException(XBT_THROW_POINT, path + " is not a DTLMod metadata file");
+    if (header_->byte_order != BYTE_ORDER_MARK)
+      throw InvalidMetadataFileException(XBT_THROW_POINT, path + " was written on a host with another byte order");
+    if (header_->version != VERSION)
+      throw InvalidMetadataFileException(XBT_THROW_POINT, path + " has an unsupported version (" +
+                                                              std::to_string(header_->version) + ")");
+    variables_      = at<VariableRecord>(header_->variables_offset, header_->num_variables);
+    transactions_   = at<TransactionRecord>(header_->transactions_offset, header_->num_transactions);
+    location_sizes_ = at<uint64_t>(header_->location_sizes_offset, header_->num_locations);
+    num_strings_    = *at<uint64_t>(header_->strings_offset, 1);
+    // Bound the count before computing sizes from it, so that a corrupted one cannot wrap around
+    if (num_strings_ >= size_ / sizeof(uint64_t) ||
+        num_strings_ != header_->num_locations + header_->num_variables)
+      throw InvalidMetadataFileException(XBT_THROW_POINT, path + " has an inconsistent string table");
+    string_offsets_ = at<uint64_t>(header_->strings_offset + sizeof(uint64_t), num_strings_ + 1);
+    // Strings are laid out one after the other, so that each one ends where the next one starts
+    if (string_offsets_[0] != 0 || not std::is_sorted(string_offsets_, string_offsets_ + num_strings_ + 1))
+      throw InvalidMetadataFileException(XBT_THROW_POINT, path + " has unordered string offsets");
+    string_chars_ = at<char>(header_->strings_offset + (num_strings_ + 2) * sizeof(uint64_t),
+                             string_offsets_[num_strings_]);
+  } catch (const InvalidMetadataFileException&) {
+    munmap(const_cast<char*>(data_), size_);
+    throw;
+  }
+  XBT_DEBUG("Mapped %s: %lu variables, %lu transactions, %lu locations", path.c_str(),
+            static_cast<unsigned long>(header_->num_variables), static_cast<unsigned long>(header_->num_transactions),
+            static_cast<unsigned long>(header_->num_locations));
+}
+
+MetadataReader::~MetadataReader()
+{
+  munmap(const_cast<char*>(data_), size_);
+}
+
+std::string_view MetadataReader::get_string(uint64_t index) const
+{
+  // String offsets were checked to be in order when the file was mapped
+  if (index >= num_strings_)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Invalid string index " + std::to_string(index));
+  return {string_chars_ + string_offsets_[index], string_offsets_[index + 1] - string_offsets_[index]};
+}
+
+const VariableRecord& MetadataReader::get_variable(size_t var) const
+{
+  if (var >= header_->num_variables)
+    throw std::out_of_range("Invalid variable index " + std::to_string(var));
+  return variables_[var];
+}
+
+const TransactionRecord* MetadataReader::get_transactions(const VariableRecord& record) const
+{
+  if (record.first_transaction > header_->num_transactions ||
+      record.num_transactions > header_->num_transactions - record.first_transaction)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Transaction records out of bounds");
+  return transactions_ + record.first_transaction;
+}
+
+std::optional<size_t> MetadataReader::find_variable(std::string_view name) const
+{
+  // Variable records are sorted by name
+  size_t lo = 0;
+  size_t hi = header_->num_variables;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    auto cmp   = get_string(variables_[mid].name).compare(name);
+    if (cmp == 0)
+      return mid;
+    if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return std::nullopt;
+}
+
+std::string_view MetadataReader::get_variable_name(size_t var) const
+{
+  return get_string(get_variable(var).name);
+}
+
+size_t MetadataReader::get_element_size(size_t var) const
+{
+  return get_variable(var).element_size;
+}
+
+std::vector<size_t> MetadataReader::get_shape(size_t var) const
+{
+  const auto& record = get_variable(var);
+  const auto* shape  = at<uint64_t>(record.shape_offset, record.num_dims);
+  return {shape, shape + record.num_dims};
+}
+
+std::vector<std::pair<unsigned int, std::vector<size_t>>> MetadataReader::get_shape_changes(size_t var) const
+{
+  const auto& record = get_variable(var);
+  // Each change is a transaction id followed by a shape
+  uint64_t entry_size = record.num_dims + 1ULL;
+  if (record.num_shape_changes > size_ / sizeof(uint64_t) / entry_size)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Shape changes out of bounds");
+  const auto* entries = at<uint64_t>(record.shape_changes_offset, record.num_shape_changes * entry_size);
+  std::vector<std::pair<unsigned int, std::vector<size_t>>> changes;
+  changes.reserve(record.num_shape_changes);
+  for (uint64_t i = 0; i < record.num_shape_changes; i++) {
+    const auto* entry = entries + i * entry_size;
+    if (entry[0] > std::numeric_limits<unsigned int>::max() || (!changes.empty() && entry[0] <= changes.back().first))
+      throw InvalidMetadataFileException(XBT_THROW_POINT, "Unordered shape changes");
+    changes.emplace_back(static_cast<unsigned int>(entry[0]), std::vector<size_t>(entry + 1, entry + entry_size));
+  }
+  return changes;
+}
+
+unsigned int MetadataReader::get_kind(size_t var) const
+{
+  return get_variable(var).kind;
+}
+
+size_t MetadataReader::get_joined_dimension(size_t var) const
+{
+  return get_variable(var).joined_dimension;
+}
+
+std::vector<unsigned int> MetadataReader::get_transaction_ids(size_t var) const
+{
+  const auto& record = get_variable(var);
+  const auto* first  = get_transactions(record);
+  std::vector<unsigned int> ids;
+  ids.reserve(record.num_transactions);
+  for (uint64_t i = 0; i < record.num_transactions; i++)
+    ids.push_back(first[i].transaction_id);
+  return ids;
+}
+
+std::optional<MetadataReader::Blocks> MetadataReader::get_blocks(size_t var, unsigned int transaction_id) const
+{
+  const auto& record = get_variable(var);
+  const auto* first  = get_transactions(record);
+  const auto* last   = first + record.num_transactions;
+  // The records of a variable are sorted by transaction id
+  const auto* it = std::lower_bound(first, last, transaction_id,
+                                    [](const TransactionRecord& r, unsigned int id) { return r.transaction_id < id; });
+  if (it == last || it->transaction_id != transaction_id)
+    return std::nullopt;
+
+  // Bound the number of blocks before computing sizes from it, so that a corrupted one cannot wrap around
+  if (record.num_dims > 0 && it->num_blocks > size_ / sizeof(uint64_t) / record.num_dims)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Blocks of transaction " + std::to_string(transaction_id) +
+                                                            " out of bounds");
+  Blocks blocks;
+  blocks.num_dims   = record.num_dims;
+  blocks.num_blocks = it->num_blocks;
+  auto num_values   = it->num_blocks * record.num_dims;
+  blocks.starts     = at<uint64_t>(it->blocks_offset, num_values);
+  blocks.counts     = at<uint64_t>(it->blocks_offset + num_values * sizeof(uint64_t), num_values);
+  blocks.locations  = at<uint32_t>(it->blocks_offset + 2 * num_values * sizeof(uint64_t), it->num_blocks);
+  return blocks;
+}
+
+std::string_view MetadataReader::get_location(uint32_t location_id) const
+{
+  if (location_id >= header_->num_locations)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Invalid location id " + std::to_string(location_id));
+  return get_string(location_id);
+}
+
+uint64_t MetadataReader::get_location_size(uint32_t location_id) const
+{
+  if (location_id >= header_->num_locations)
+    throw InvalidMetadataFileException(XBT_THROW_POINT, "Invalid location id " + std::to_string(location_id));
+  return location_sizes_[location_id];
+}
+
+} // namespace dtlmod
@@ -0,0 +1,90 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+#include <cstdio>
+
+#include "dtlmod/DTLException.hpp"
+#include "dtlmod/Metadata.hpp"
+#include "dtlmod/MetadataSpillStore.hpp"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_metadata_spill, dtlmod_metadata, "DTL logging about spilled metadata");
+
+namespace dtlmod {
+/// \cond EXCLUDE_FROM_DOCUMENTATION
+
+MetadataSpillStore::~MetadataSpillStore()
+{
+  if (file_.is_open()) {
+    file_.close();
+    std::remove(path_.c_str());
+  }
+}
+
+MetadataSpillStore::Record MetadataSpillStore::write(const BlockTable& blocks)
+{
+  xbt_assert(blocks.is_sealed(), "Internal error: only sealed block tables can be spilled");
+  if (!file_.is_open()) {
+    file_.open(path_, std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    if (!file_.is_open())
+      throw MetadataSpillException(XBT_THROW_POINT, "Cannot create " + path_);
+  }
+
+  Record record{size_, blocks.size(), static_cast<uint32_t>(blocks.get_num_dims()), blocks.has_value_ranges()};
+  auto write_vector = [this](const auto& values) {
+    auto bytes = values.size() * sizeof(values[0]);
+    file_.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(bytes));
+    size_ += bytes;
+  };
+  file_.seekp(static_cast<std::streamoff>(record.offset));
+  write_vector(blocks.starts_);
+  write_vector(blocks.counts_);
+  write_vector(blocks.location_ids_);
+  write_vector(blocks.publisher_ids_);
+  write_vector(blocks.value_mins_);
+  write_vector(blocks.value_maxs_);
+  if (!file_.good())
+    throw MetadataSpillException(XBT_THROW_POINT, "Cannot write " + std::to_string(blocks.size()) +
+                                                      " blocks at offset " + std::to_string(record.offset) + " of " +
+                                                      path_);
+  XBT_DEBUG("Spilled %zu blocks at offset %lu of %s", blocks.size(), static_cast<unsigned long>(record.offset),
+            path_.c_str());
+  return record;
+}
+
+std::shared_ptr<BlockTable> MetadataSpillStore::read(const Record& record)
+{
+  auto blocks    = std::make_shared<BlockTable>();
+  blocks->ndims_ = record.num_dims;
+  blocks->starts_.resize(record.num_blocks * record.num_dims);
+  blocks->counts_.resize(record.num_blocks * record.num_dims);
+  blocks->location_ids_.resize(record.num_blocks);
+  blocks->publisher_ids_.resize(record.num_blocks);
+  if (record.has_value_ranges) {
+    blocks->value_mins_.resize(record.num_blocks);
+    blocks->value_maxs_.resize(record.num_blocks);
+  }
+
+  auto read_vector = [this](auto& values) {
+    auto bytes = values.size() * sizeof(values[0]);
+    file_.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(bytes));
+  };
+  file_.seekg(static_cast<std::streamoff>(record.offset));
+  read_vector(blocks->starts_);
+  read_vector(blocks->counts_);
+  read_vector(blocks->location_ids_);
+  read_vector(blocks->publisher_ids_);
+  read_vector(blocks->value_mins_);
+  read_vector(blocks->value_maxs_);
+  if (!file_.good())
+    throw MetadataSpillException(XBT_THROW_POINT, "Cannot read " + std::to_string(record.num_blocks) +
+                                                      " blocks at offset " + std::to_string(record.offset) + " of " +
+                                                      path_);
+  XBT_DEBUG("Reloaded %lu blocks from offset %lu of %s", static_cast<unsigned long>(record.num_blocks),
+            static_cast<unsigned long>(record.offset), path_.c_str());
+  return blocks;
+}
+/// \endcond
+
+} // namespace dtlmod
@@ -11,6 +11,9 @@
 #include <simgrid/s4u/Engine.hpp>
 #include <simgrid/s4u/MessageQueue.hpp>
 
+#include <string>
+#include <utility>
+
 #include "dtlmod/DTL.hpp"
 #include "dtlmod/DTLException.hpp"
 #include "dtlmod/StagingEngine.hpp"
@@ -28,9 +31,13 @@ void StagingEngine::cancel_activities()
   // cleanup when the cancellation unblocks them.
   cancel_pending_activities(get_pub_transaction());
   cancel_pending_activities(get_sub_transaction());
+  // Killing the servers of the staged transactions cancels what they are sending
+  for (const auto& [pid, server] : std::exchange(staging_servers_, {}))
+    server->kill();
   first_pub_transaction_started_->notify_all();
   sub_transaction_started_->notify_all();
   pub_transaction_completed_->notify_all();
+  staged_transaction_served_->notify_all();
 }
 
 void StagingEngine::create_transport(const Transport::Method& transport_method)
@@ -53,6 +60,58 @@ std::shared_ptr<StagingTransport> StagingEngine::get_staging_transport() const
   return transport;
 } // LCOV_EXCL_LINE
 
+// Publishers can begin a transaction once the subscribers have begun the one that is as many transactions earlier as
+// the depth of the staging queue. The first transaction is always begun in lockstep, so that publishers know how many
+// subscribers will request their data.
+bool StagingEngine::is_pub_too_far_ahead() const
+{
+  auto depth = current_pub_transaction_id_ > 1 ? get_stream()->get_staging_queue_depth() : 0;
+  return current_pub_transaction_id_ > current_sub_transaction_id_ + depth;
+}
+
+// Leave the data of a completed transaction in staging: an actor on the host of the publisher serves the requests of
+// the subscribers for this transaction, while the publisher moves on to the next one.
+void StagingEngine::stage_transaction(sg4::ActorPtr publisher, unsigned int transaction_id)
+{
+  num_staged_transactions_[publisher]++;
+  auto server_name = publisher->get_name() + "_staging_" + std::to_string(transaction_id);
+  auto server      = publisher->get_host()->add_actor(server_name, [this, publisher, transaction_id]() {
+    sg4::ActivitySet puts;
+    get_staging_transport()->get_requests_and_do_put(publisher, transaction_id, puts);
+    try {
+      puts.wait_all();
+    } catch (const simgrid::CancelException&) {
+      if (!is_canceled())
+        throw;
+      drain(puts);
+    } catch (const simgrid::NetworkFailureException&) { // LCOV_EXCL_START
+      if (!is_canceled())
+        throw;
+      drain(puts);
+    } // LCOV_EXCL_STOP
+    XBT_DEBUG("Transaction %u of %s has left staging", transaction_id, publisher->get_cname());
+    staging_servers_.erase(sg4::this_actor::get_pid());
+    // The publisher forgets its count when it closes, which only a canceled engine lets it do before this point
+    if (auto* num_staged = num_staged_transactions_.find(publisher))
+      (*num_staged)--;
+    staged_transaction_served_->notify_all();
+  });
+  // The last subscriber to close kills the servers of the transactions it left in staging. A subscriber that never
+  // closes the engine leaves its servers waiting for requests: they must not keep the simulation alive.
+  server->daemonize();
+  staging_servers_.try_emplace(server->get_pid(), server);
+}
+
+// No subscriber is left to get the transactions held in staging: drop them, so that their publishers can close
+void StagingEngine::release_staged_transactions()
+{
+  for (const auto& [pid, server] : std::exchange(staging_servers_, {}))
+    server->kill();
+  for (auto& [publisher, num_staged] : num_staged_transactions_)
+    num_staged = 0;
+  staged_transaction_served_->notify_all();
+}
+
 void StagingEngine::begin_pub_transaction()
 {
   if (is_transaction_canceled(current_pub_transaction_id_ + 1))
@@ -93,9 +152,9 @@ void StagingEngine::begin_pub_transaction()
       throw TransactionCanceledException(XBT_THROW_POINT);
   }
 
-  // Then we wait for all subscribers to be at the same transaction
+  // Then we wait for all subscribers to be close enough to this transaction
   while (!is_transaction_canceled(current_pub_transaction_id_) &&
-         (get_subscribers().is_empty() || current_pub_transaction_id_ > current_sub_transaction_id_)) {
+         (get_subscribers().is_empty() || is_pub_too_far_ahead())) {
     XBT_DEBUG("Wait for subscribers");
     sub_transaction_started_->wait(lock);
   }
@@ -106,19 +165,31 @@ void StagingEngine::begin_pub_transaction()
 
 void StagingEngine::end_pub_transaction()
 {
+  auto self           = sg4::Actor::self();
+  auto transaction_id = current_pub_transaction_id_;
+
   // This is the end of the first transaction, create a barrier
   if (auto pub_barrier = get_publishers().get_or_create_barrier())
     XBT_DEBUG("Barrier created for %zu publishers", get_publishers().count());
 
+  // Subscribers can only find the blocks of this transaction once the metadata of all publishers has been gathered
+  aggregate_metadata();
+
   // A new pub transaction has been completed, notify subscribers that they can starting getting variables
   if (get_publishers().is_last_at_barrier() && (completed_pub_transaction_id_ < current_pub_transaction_id_)) {
+    get_stream()->seal_transaction_metadata(current_pub_transaction_id_);
     completed_pub_transaction_id_++;
+    record_staging_queue_occupancy(completed_pub_transaction_id_ - completed_sub_transaction_id_);
     pub_transaction_completed_->notify_all();
   }
 
-  // Wait for the put requests and actually put (asynchrously) comm/mess in Mbox/MQ
-  get_staging_transport()->get_requests_and_do_put(sg4::Actor::self());
-  XBT_DEBUG("Start publish activities for the transaction");
+  if (get_stream()->get_staging_queue_depth() == 0) {
+    // Wait for the put requests and actually put (asynchrously) comm/mess in Mbox/MQ
+    get_staging_transport()->get_requests_and_do_put(self, transaction_id, get_pub_transaction());
+    XBT_DEBUG("Start publish activities for the transaction");
+  } else {
+    stage_transaction(self, transaction_id);
+  }
 
   if (get_publishers().is_last_at_barrier()) // Mark this transaction as over
     pub_transaction_in_progress_ = false;
@@ -129,6 +200,14 @@ void StagingEngine::pub_close()
   auto self = sg4::Actor::self();
 
   XBT_DEBUG("Publisher '%s' is closing the engine '%s'", self->get_cname(), get_cname());
+  // Subscribers get the transactions this publisher left in staging from it, wait for them to be read
+  {
+    std::unique_lock lock(*get_publishers().get_mutex());
+    while (!is_canceled() && num_staged_transactions_[self] > 0)
+      staged_transaction_served_->wait(lock);
+    num_staged_transactions_.erase(self);
+  }
+
   if (!pub_closing_) {
     // I'm the first to close
     pub_closing_ = true;
@@ -149,7 +228,7 @@ void StagingEngine::pub_close()
     XBT_DEBUG("[%s] last publish transaction is over", get_cname());
     current_pub_transaction_id_++;
   }
-  get_publishers().remove(self);
+  remove_publisher(self);
 
   if (get_publishers().is_last_at_barrier()) {
     XBT_DEBUG("All publishers have called the Engine::close() function");
@@ -221,8 +300,7 @@ void StagingEngine::begin_sub_transaction()
             sg4::Actor::self()->get_cname(), num_subscribers_starting_.load(), get_subscribers().count());
 
   // The last subscriber to start a transaction notifies the publishers
-  if (num_subscribers_starting_.load() == get_subscribers().count() &&
-      current_pub_transaction_id_ == current_sub_transaction_id_) {
+  if (num_subscribers_starting_.load() == get_subscribers().count() && not is_pub_too_far_ahead()) {
     XBT_DEBUG("Notify Publishers that they can start their transaction");
     sub_transaction_started_->notify_all();
   }
@@ -260,9 +338,12 @@ void StagingEngine::end_sub_transaction()
   }
 
   // Prevent subscribers to start a new transaction before this one is really over
-  if (get_subscribers().is_last_at_barrier())
-    // Mark this transaction as over
+  if (get_subscribers().is_last_at_barrier()) {
+    // Mark this transaction as over, its data leaves staging
     sub_transaction_in_progress_ = false;
+    completed_sub_transaction_id_++;
+    record_staging_queue_occupancy(completed_pub_transaction_id_ - completed_sub_transaction_id_);
+  }
   // Decrease counter for next iteration
   num_subscribers_starting_--;
   XBT_DEBUG("Subscribe Transaction %u end by %s (%u/%lu)", current_sub_transaction_id_, sg4::Actor::self()->get_cname(),
@@ -292,10 +373,11 @@ void StagingEngine::sub_close()
     get_sub_transaction().clear();
   }
 
-  get_subscribers().remove(self);
+  remove_subscriber(self);
 
   if (get_subscribers().is_last_at_barrier()) {
     XBT_DEBUG("All subscribers have called the Engine::close() function");
+    release_staged_transactions();
     close_stream();
     XBT_DEBUG("Engine '%s' is now closed for all subscribers ", get_cname());
   }
@@ -18,41 +18,54 @@ namespace dtlmod {
 void StagingMboxTransport::create_rendez_vous_points()
 {
   auto publish_actors  = get_engine()->get_publishers().get_actors();
-  auto subscriber_name = sg4::Actor::self()->get_cname();
+  auto self            = sg4::Actor::self();
+  auto subscriber_name = self->get_cname();
   XBT_DEBUG("Actor '%s' is creating new mailboxes", subscriber_name);
   for (const auto& pub : publish_actors) {
     std::string mbox_name = pub->get_name() + "_" + subscriber_name + "_mbox";
-    mboxes_[mbox_name]    = sg4::Mailbox::by_name(mbox_name);
+    RendezVousKey key{get_publisher_location(*pub), self->get_pid()};
+    mboxes_[key] = sg4::Mailbox::by_name(mbox_name);
   }
 }
 
-void StagingMboxTransport::get_requests_and_do_put(sg4::ActorPtr publisher)
+void StagingMboxTransport::get_requests_and_do_put(sg4::ActorPtr publisher, unsigned int transaction_id,
+                                                   sg4::ActivitySet& puts)
 {
-  auto pub_name = publisher->get_name();
+  const auto& pub_name = publisher->get_name();
+  auto location        = get_publisher_location(*publisher);
+  sg4::ActivitySet requests;
+  get_put_requests_for(location, transaction_id, requests);
   // Wait for the reception of the messages. If something is requested, post a put in the mailbox for the
   // corresponding publisher-subscriber couple
-  while (pending_put_requests_exist_for(pub_name)) {
-    auto request           = boost::static_pointer_cast<sg4::Mess>(wait_any_pending_put_request_for(pub_name));
+  while (not requests.empty()) {
+    auto request           = boost::static_pointer_cast<sg4::Mess>(requests.wait_any());
     const auto* subscriber = request->get_sender();
     // Take ownership of the payload received from the subscriber
     std::unique_ptr<size_t> req_size(static_cast<size_t*>(request->get_payload()));
     if (*req_size > 0) {
-      std::string mbox_name = pub_name + "_" + subscriber->get_name() + "_mbox";
+      auto* rdv = mboxes_.at({location, subscriber->get_pid()});
       XBT_DEBUG("%s received a put request from %s. Put a Message in %s with %lu as payload", pub_name.c_str(),
-                subscriber->get_cname(), mbox_name.c_str(), *req_size);
+                subscriber->get_cname(), rdv->get_cname(), *req_size);
       // Send a static dummy payload - subscribers don't use the actual data, only the simulated transfer size
       static size_t dummy = 0;
-      auto comm           = mboxes_[mbox_name]->put_init(&dummy, *req_size);
-      get_engine()->get_pub_transaction().push(comm->start());
+      auto comm           = rdv->put_init(&dummy, *req_size);
+      puts.push(comm->start());
     }
   }
 }
 
-void StagingMboxTransport::get_rendez_vous_point_and_do_get(std::string_view name)
+void StagingMboxTransport::get_rendez_vous_point_and_do_get(LocationId publisher)
 {
   // We use a static dummy buffer since we don't use the actual data in simulation
   static size_t* dummy_buffer;
-  get_engine()->get_sub_transaction().push(mboxes_[std::string(name) + "_mbox"]->get_async(&dummy_buffer));
+  auto* mbox = mboxes_.at({publisher, sg4::Actor::self()->get_pid()});
+  get_engine()->get_sub_transaction().push(mbox->get_async(&dummy_buffer));
+}
+
+void StagingMboxTransport::add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const
+{
+  StagingTransport::add_memory_footprint(structures);
+  structures["mailboxes"] = mboxes_.size() * (sizeof(RendezVousKey) + sizeof(sg4::Mailbox*) + 4 * sizeof(void*));
 }
 
 /// \endcond
@@ -16,42 +16,55 @@ namespace dtlmod {
 void StagingMqTransport::create_rendez_vous_points()
 {
   auto publish_actors  = get_engine()->get_publishers().get_actors();
-  auto subscriber_name = sg4::Actor::self()->get_cname();
+  auto self            = sg4::Actor::self();
+  auto subscriber_name = self->get_cname();
   // When a new subscriber joins the stream, create a message queue with each know publishers
   XBT_DEBUG("Actor '%s' is creating new message queues", subscriber_name);
   for (const auto& pub : publish_actors) {
     std::string mq_name = pub->get_name() + "_" + subscriber_name + "_mq";
-    mqueues_[mq_name]   = sg4::MessageQueue::by_name(mq_name);
+    RendezVousKey key{get_publisher_location(*pub), self->get_pid()};
+    mqueues_[key] = sg4::MessageQueue::by_name(mq_name);
   }
 }
 
-void StagingMqTransport::get_requests_and_do_put(sg4::ActorPtr publisher)
+void StagingMqTransport::get_requests_and_do_put(sg4::ActorPtr publisher, unsigned int transaction_id,
+                                                 sg4::ActivitySet& puts)
 {
-  auto pub_name = publisher->get_name();
+  const auto& pub_name = publisher->get_name();
+  auto location        = get_publisher_location(*publisher);
+  sg4::ActivitySet requests;
+  get_put_requests_for(location, transaction_id, requests);
   // Wait for the reception of the messages. If something is requested, post a put in the message queue for the
   // corresponding publisher-subscriber couple
-  while (pending_put_requests_exist_for(pub_name)) {
-    auto request           = boost::static_pointer_cast<sg4::Mess>(wait_any_pending_put_request_for(pub_name));
+  while (not requests.empty()) {
+    auto request           = boost::static_pointer_cast<sg4::Mess>(requests.wait_any());
     const auto* subscriber = request->get_sender();
     // Take ownership of the payload received from the subscriber
     std::unique_ptr<size_t> req_size(static_cast<size_t*>(request->get_payload()));
     if (*req_size > 0) {
-      std::string mq_name = pub_name + "_" + subscriber->get_name() + "_mq";
+      auto* rdv = mqueues_.at({location, subscriber->get_pid()});
       XBT_DEBUG("%s received a put request from %s. Put a Message in %s with %lu as payload", pub_name.c_str(),
-                subscriber->get_cname(), mq_name.c_str(), *req_size);
+                subscriber->get_cname(), rdv->get_cname(), *req_size);
       // Send a static dummy payload - subscribers don't use the actual data, only the simulated transfer size
       static size_t dummy = 0;
-      auto mess           = mqueues_[mq_name]->put_init(&dummy);
-      get_engine()->get_pub_transaction().push(mess->start());
+      auto mess           = rdv->put_init(&dummy);
+      puts.push(mess->start());
     }
   }
 }
 
-void StagingMqTransport::get_rendez_vous_point_and_do_get(std::string_view name)
+void StagingMqTransport::get_rendez_vous_point_and_do_get(LocationId publisher)
 {
   // The payload will be received via the Mess object but we don't use it in simulation
-  get_engine()->get_sub_transaction().push(mqueues_[std::string(name) + "_mq"]->get_async());
+  get_engine()->get_sub_transaction().push(mqueues_.at({publisher, sg4::Actor::self()->get_pid()})->get_async());
 }
+void StagingMqTransport::add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const
+{
+  StagingTransport::add_memory_footprint(structures);
+  structures["message_queues"] =
+      mqueues_.size() * (sizeof(RendezVousKey) + sizeof(sg4::MessageQueue*) + 4 * sizeof(void*));
+}
+
 /// \endcond
 
 } // namespace dtlmod
@@ -15,69 +15,96 @@ XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_staging_transport, dtlmod_transport, "DTL
 namespace dtlmod {
 /// \cond EXCLUDE_FROM_DOCUMENTATION
 
-void StagingTransport::add_publisher(unsigned long /*publisher_id*/)
+// Publishers are identified by their name, interned in the location table of the Stream
+LocationId StagingTransport::get_publisher_location(const sg4::Actor& publisher)
 {
-  set_publisher_put_requests_mq(sg4::Actor::self()->get_name());
-}
-// Create a message queue to receive request for variable pieces from subscribers
-void StagingTransport::set_publisher_put_requests_mq(std::string_view publisher_name)
-{
-  publisher_put_requests_mq_[std::string(publisher_name)] = sg4::MessageQueue::by_name(std::string(publisher_name));
+  auto pid = publisher.get_pid();
+  auto it  = publisher_locations_.find(pid);
+  if (it == publisher_locations_.end()) {
+    auto location = get_engine()->get_stream()->get_location_table()->intern(publisher.get_name());
+    it            = publisher_locations_.try_emplace(pid, location).first;
+  }
+  return it->second;
 }
 
-sg4::MessageQueue* StagingTransport::get_publisher_put_requests_mq(std::string_view publisher_name) const
+sg4::MessageQueue* StagingTransport::get_put_requests_mq(LocationId publisher, unsigned int transaction_id)
 {
-  return publisher_put_requests_mq_.at(std::string(publisher_name));
+  const auto& publisher_name = get_engine()->get_stream()->get_location_table()->get_name(publisher);
+  return sg4::MessageQueue::by_name(publisher_name + "_put_requests_" + std::to_string(transaction_id));
 }
 
 void StagingTransport::put(const std::shared_ptr<Variable>& var, size_t /* simulated_size_in_bytes*/)
 {
   // Register who (this actor) writes in this transaction
-  auto* e              = get_engine();
-  auto tid             = e->get_current_transaction();
-  auto self            = sg4::Actor::self();
-  const auto& pub_name = self->get_name();
+  auto* e       = get_engine();
+  auto tid      = e->get_current_transaction();
+  auto self     = sg4::Actor::self();
+  auto location = get_publisher_location(*self);
 
   // Use actor's name as temporary location. It's only half of the Mailbox Name
-  var->add_transaction_metadata(tid, self, pub_name);
+  var->add_transaction_metadata(tid, self, location);
 
   // Each Subscriber will send a put request to each publisher in the Stream. They can request for a certain size if
-  // they need something from this publisher or 0 otherwise.
-  // Start with posting all asynchronous gets and creating an ActivitySet.
-  const auto num_subscribers = e->get_subscribers().count();
-  for (size_t i = 0; i < num_subscribers; i++)
-    pending_put_requests_[pub_name].push(get_publisher_put_requests_mq(pub_name)->get_async());
+  // they need something from this publisher or 0 otherwise. Count them, they are received when the data is served.
+  expected_put_requests_[location][tid] += e->get_subscribers().count();
+}
+
+void StagingTransport::get_put_requests_for(LocationId publisher, unsigned int transaction_id,
+                                            sg4::ActivitySet& requests)
+{
+  auto& expected = expected_put_requests_[publisher];
+  auto it        = expected.find(transaction_id);
+  if (it == expected.end())
+    return;
+  auto* mq = get_put_requests_mq(publisher, transaction_id);
+  for (size_t i = 0; i < it->second; i++)
+    requests.push(mq->get_async());
+  expected.erase(it);
 }
 
 void StagingTransport::get(const std::shared_ptr<Variable>& var)
 {
-  auto publishers = get_engine()->get_publishers().get_actors();
+  auto* e         = get_engine();
+  auto publishers = e->get_publishers().get_actors();
   auto self       = sg4::Actor::self();
   auto blocks     = check_selection_and_get_blocks_to_get(var);
 
   // Prepare messages to send to publishers to indicate them whether they have to send something to this subscriber
   // or not. The payload is 0 by default and will be changed when browsing the blocks to get.
-  std::unordered_map<std::string, std::unique_ptr<size_t>> put_requests;
+  std::unordered_map<LocationId, std::unique_ptr<size_t>> put_requests;
   for (const auto& pub : publishers)
-    put_requests[pub->get_name()] = std::make_unique<size_t>(0);
+    put_requests[get_publisher_location(*pub)] = std::make_unique<size_t>(0);
 
-  for (const auto& [publisher_name, size] : blocks) {
-    std::string rdv_name = publisher_name + "_" + self->get_name();
-    XBT_DEBUG("Have to exchange data of size %llu from '%s' to '%s' using the '%s' rendez-vous point", size,
-              publisher_name.c_str(), self->get_cname(), rdv_name.c_str());
+  for (const auto& [publisher, size] : blocks) {
+    XBT_DEBUG("Have to exchange data of size %llu from '%s' to '%s'", size,
+              var->get_metadata()->get_location(publisher).c_str(), self->get_cname());
 
     // Update the payload of the put request to send to this publisher if necessary.
     if (size > 0) {
-      put_requests[publisher_name] = std::make_unique<size_t>(size);
+      put_requests[publisher] = std::make_unique<size_t>(size);
       // Add an activity to the transaction.
-      get_rendez_vous_point_and_do_get(rdv_name);
+      get_rendez_vous_point_and_do_get(publisher);
     }
   }
 
-  // Send the put requests for that get to all publishers in the Stream in a detached mode.
+  // Send the put requests for that get to all publishers in the Stream in a detached mode. Subscribers read in their
+  // transaction the one publishers completed with the same id: address the requests to the server of that transaction.
+  auto tid = e->get_current_sub_transaction_impl();
   for (auto& [pub, size_ptr] : put_requests)
-    get_publisher_put_requests_mq(pub)->put_init(size_ptr.release())->detach();
+    get_put_requests_mq(pub, tid)->put_init(size_ptr.release())->detach();
+}
+void StagingTransport::add_memory_footprint(std::map<std::string, size_t, std::less<>>& structures) const
+{
+  constexpr size_t node_overhead = 2 * sizeof(void*); // hash map node and bucket
+  structures["publisher_locations"] =
+      publisher_locations_.size() * (sizeof(aid_t) + sizeof(LocationId) + node_overhead);
+  size_t footprint = 0;
+  for (const auto& [publisher, requests] : expected_put_requests_)
+    footprint += sizeof(publisher) + sizeof(requests) + node_overhead +
+                 requests.size() * (sizeof(unsigned int) + sizeof(size_t) + 4 * sizeof(void*));
+  structures["expected_put_requests"] = footprint;
 }
+
 /// \endcond
 
 } // namespace dtlmod
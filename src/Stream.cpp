@@ -3,10 +3,12 @@
 /* This program is free software; you can redistribute it and/or modify it
  * under the terms of the license (GNU LGPL) which comes with this package. */
 
+#include <algorithm>
 #include <array>
 #include <boost/algorithm/string/replace.hpp>
 #include <chrono>
 #include <fstream>
+#include <set>
 
 #include "dtlmod/CompressionReductionMethod.hpp"
 #include "dtlmod/DTL.hpp"
@@ -154,46 +156,231 @@ Stream& Stream::unset_metadata_export() noexcept
   return *this;
 }
 
-void Stream::export_metadata_to_file()
+Stream& Stream::set_metadata_export_format(MetadataFormat format) noexcept
+{
+  metadata_format_ = format;
+  return *this;
+}
+
+Stream& Stream::set_metadata_import(const std::string& file_name)
+{
+  metadata_import_file_ = file_name;
+  return *this;
+}
+
+Stream& Stream::set_metadata_memory_budget(size_t bytes) noexcept
+{
+  metadata_memory_budget_ = bytes;
+  return *this;
+}
+
+Stream& Stream::set_min_io_size(size_t bytes) noexcept
+{
+  min_io_size_ = bytes;
+  return *this;
+}
+
+Stream& Stream::set_put_buffer_capacity(size_t bytes) noexcept
+{
+  put_buffer_capacity_ = bytes;
+  return *this;
+}
+
+Stream& Stream::set_staging_queue_depth(unsigned int transactions) noexcept
+{
+  staging_queue_depth_ = transactions;
+  return *this;
+}
+
+Stream& Stream::set_metadata_io_simulation() noexcept
+{
+  metadata_io_simulation_ = true;
+  return *this;
+}
+Stream& Stream::unset_metadata_io_simulation() noexcept
+{
+  metadata_io_simulation_ = false;
+  return *this;
+}
+
+Stream& Stream::set_metadata_aggregation(unsigned int arity) noexcept
+{
+  metadata_aggregation_arity_ = arity;
+  return *this;
+}
+
+BinaryMetadataWriter& Stream::get_binary_metadata_writer()
+{
+  if (!binary_metadata_writer_)
+    binary_metadata_writer_ = std::make_unique<BinaryMetadataWriter>(metadata_file_);
+  return *binary_metadata_writer_;
+}
+
+void Stream::export_metadata_to_file(const std::vector<uint64_t>& location_sizes)
 {
   metadata_exported_ = true;
-  if (metadata_export_) {
-    std::ofstream export_stream(metadata_file_, std::ofstream::out);
+  if (metadata_export_ && metadata_format_ == MetadataFormat::Binary) {
+    // Transactions flushed so far are already in the file. Append the others, then the index.
+    auto& writer = get_binary_metadata_writer();
+    std::vector<std::shared_ptr<Variable>> variables;
     for (const auto& [name, v] : variables_) {
-      auto it          = var_prog_file_paths_.find(name);
-      std::string prog = (it != var_prog_file_paths_.end()) ? it->second : "";
-      v->get_metadata()->export_to_file(export_stream, prog);
+      v->get_metadata()->export_to_binary(writer);
+      variables.push_back(v);
     }
+    writer.finish(variables, *locations_, location_sizes);
+  } else if (metadata_export_) {
+    // Assemble the final file in a single pass, variable by variable, from the journal and the in-memory transactions
+    std::ofstream export_stream(metadata_file_, std::ofstream::out);
+    for (const auto& [name, v] : variables_)
+      v->get_metadata()->export_to_file(export_stream, metadata_journal_.get());
     export_stream.close();
-    // Remove per-variable prog files now that the final file is written
-    for (const auto& [name, path] : var_prog_file_paths_)
-      std::remove(path.c_str());
-    var_prog_file_paths_.clear();
+    if (metadata_journal_) {
+      metadata_journal_->discard();
+      metadata_journal_.reset();
+    }
   }
 }
 
 void Stream::flush_and_evict_transaction(unsigned int tx_id)
 {
-  if (metadata_exported_) {
-    // Sequential scenario or post-export: the metadata file is already complete; just free memory
+  if (metadata_exported_ || metadata_reader_) {
+    // Sequential scenario, post-export, or imported metadata: the metadata file is already complete; just free memory
     for (const auto& [name, v] : variables_)
       v->get_metadata()->evict_transaction(tx_id);
     return;
   }
-  if (metadata_export_) {
-    for (const auto& [name, v] : variables_) {
-      if (!var_prog_file_paths_.count(name))
-        var_prog_file_paths_[name] = metadata_file_ + "." + name + ".prog";
-      std::ofstream out(var_prog_file_paths_.at(name), std::ofstream::app);
-      v->get_metadata()->write_transaction_to_stream(tx_id, out);
-      // write_transaction_to_stream also increments flushed_count_ and evicts from transaction_infos_
-    }
+  if (metadata_export_ && metadata_format_ == MetadataFormat::Binary) {
+    for (const auto& [name, v] : variables_)
+      v->get_metadata()->write_transaction_to_binary(tx_id, get_binary_metadata_writer());
+  } else if (metadata_export_) {
+    if (!metadata_journal_)
+      metadata_journal_ = std::make_unique<MetadataJournal>(metadata_file_ + ".journal");
+    for (const auto& [name, v] : variables_)
+      v->get_metadata()->write_transaction_to_journal(tx_id, *metadata_journal_);
+    // Entries are buffered, the journal file is only written once they grow large enough
+    metadata_journal_->flush_if_needed();
   } else {
     for (const auto& [name, v] : variables_)
       v->get_metadata()->evict_transaction(tx_id);
   }
 }
 
+// Reserve the record of a complete transaction at the end of the simulated metadata index and return its size
+sg_size_t Stream::add_metadata_index_record(unsigned int tx_id)
+{
+  sg_size_t size = 0;
+  for (const auto& [name, v] : variables_)
+    size += v->get_metadata()->get_index_size(tx_id);
+  // Transactions completed before metadata I/O was simulated have an empty record
+  auto offset = metadata_index_ends_.empty() ? 0 : metadata_index_ends_.back();
+  metadata_index_ends_.resize(std::max<size_t>(tx_id, metadata_index_ends_.size()), offset);
+  metadata_index_ends_[tx_id - 1] = offset + size;
+  XBT_DEBUG("The index record of transaction %u takes %llu bytes", tx_id, size);
+  return size;
+}
+
+// Offset and size of the consecutive records of the transactions in [begin, begin + count) in the metadata index. The
+// records of transactions that are not in the index yet are left out.
+std::pair<sg_size_t, sg_size_t> Stream::get_metadata_index_records(unsigned int begin, unsigned int count) const
+{
+  if (begin == 0 || count == 0 || begin > metadata_index_ends_.size())
+    return {0, 0};
+  auto end    = std::min<size_t>(begin + count - 1, metadata_index_ends_.size());
+  auto offset = begin > 1 ? metadata_index_ends_[begin - 2] : 0;
+  return {offset, metadata_index_ends_[end - 1] - offset};
+}
+
+void Stream::seal_transaction_metadata(unsigned int tx_id)
+{
+  // All the blocks of this transaction are known: sort and index them once, before subscribers start querying them
+  for (const auto& [name, v] : variables_)
+    v->get_metadata()->seal_transaction(tx_id);
+  enforce_metadata_memory_budget();
+}
+
+void Stream::enforce_metadata_memory_budget()
+{
+  if (metadata_memory_budget_ == 0)
+    return;
+  // Only compare what spilling can free with the budget: the blocks of the newest transaction and the tables that are
+  // never spilled would otherwise make every transaction read back leave memory again, even if that frees nothing
+  size_t footprint = 0;
+  std::set<unsigned int> resident;
+  for (const auto& [name, v] : variables_) {
+    footprint += v->get_metadata()->get_spillable_footprint();
+    auto ids = v->get_metadata()->get_resident_transaction_ids();
+    resident.insert(ids.begin(), ids.end());
+  }
+  if (footprint <= metadata_memory_budget_)
+    return;
+
+  if (!metadata_spill_store_)
+    metadata_spill_store_ = std::make_shared<MetadataSpillStore>(metadata_file_ + ".spill");
+  // The oldest transactions are the coldest ones. Transactions still in progress are not sealed and stay in memory, as
+  // does the newest sealed one.
+  size_t spilled = 0;
+  for (auto tx_id : resident) {
+    if (footprint <= metadata_memory_budget_)
+      break;
+    for (const auto& [name, v] : variables_)
+      footprint -= std::min(footprint, v->get_metadata()->spill_transaction(tx_id, metadata_spill_store_));
+    spilled++;
+  }
+  XBT_DEBUG("Stream '%s' moved %zu transactions out of memory, about %zu bytes of its metadata can still be moved",
+            get_cname(), spilled, footprint);
+}
+
+/// Define the Variables described in the imported metadata file and return the id of its last transaction. The blocks
+/// of a transaction are only read when subscribers reach it, see load_transaction_metadata().
+unsigned int Stream::import_metadata_from_file()
+{
+  metadata_reader_ = std::make_shared<MetadataReader>(metadata_import_file_);
+
+  // Locations are interned in the table of this Stream, the blocks read from the file are translated through this map
+  auto location_ids = std::make_shared<std::vector<LocationId>>();
+  for (uint32_t l = 0; l < metadata_reader_->get_num_locations(); l++)
+    location_ids->push_back(locations_->intern(std::string(metadata_reader_->get_location(l))));
+
+  unsigned int last_transaction = 0;
+  for (size_t v = 0; v < metadata_reader_->get_num_variables(); v++) {
+    std::string name(metadata_reader_->get_variable_name(v));
+    auto [it, inserted] = variables_.try_emplace(name, nullptr);
+    if (inserted) {
+      it->second = std::make_shared<Variable>(name, metadata_reader_->get_element_size(v),
+                                              metadata_reader_->get_shape(v), shared_from_this());
+      // The kind of a Variable tells how the blocks of its transactions are ordered and selected
+      auto kind             = metadata_reader_->get_kind(v);
+      auto joined_dimension = metadata_reader_->get_joined_dimension(v);
+      if (kind > static_cast<unsigned int>(Variable::Kind::JoinedArray) ||
+          (kind == static_cast<unsigned int>(Variable::Kind::JoinedArray) &&
+           joined_dimension >= it->second->get_shape().size()))
+        throw InvalidMetadataFileException(XBT_THROW_POINT, "Invalid kind for variable " + name);
+      it->second->kind_             = static_cast<Variable::Kind>(kind);
+      it->second->joined_dimension_ = joined_dimension;
+      it->second->create_metadata(locations_);
+    }
+    it->second->get_metadata()->import_from(metadata_reader_, v, location_ids);
+    // Whole-variable reads of a transaction use the shape the Variable had in it
+    for (const auto& [transaction_id, shape] : metadata_reader_->get_shape_changes(v)) {
+      if (shape.size() != it->second->get_shape().size())
+        throw InvalidMetadataFileException(XBT_THROW_POINT, "Invalid shape change for variable " + name);
+      it->second->get_metadata()->record_shape(transaction_id, shape);
+    }
+    auto transaction_ids = metadata_reader_->get_transaction_ids(v);
+    if (!transaction_ids.empty())
+      last_transaction = std::max(last_transaction, transaction_ids.back());
+  }
+  XBT_DEBUG("Stream '%s' imported %zu variables and %u transactions from '%s'", get_cname(),
+            metadata_reader_->get_num_variables(), last_transaction, metadata_import_file_.c_str());
+  return last_transaction;
+}
+
+void Stream::load_transaction_metadata(unsigned int tx_id)
+{
+  for (const auto& [name, v] : variables_)
+    v->get_metadata()->load_transaction(tx_id);
+}
+
 std::shared_ptr<ReductionMethod> Stream::define_reduction_method(const std::string& name)
 {
   if (auto it = reduction_methods_.find(name); it != reduction_methods_.end())
@@ -224,6 +411,8 @@ void Stream::validate_open_parameters(std::string_view name, Mode mode) const
     throw UndefinedTransportMethodException(XBT_THROW_POINT, std::string(name));
   if (!is_valid_mode(mode))
     throw UnknownOpenModeException(XBT_THROW_POINT, mode_to_str(mode));
+  if (does_import_metadata() && (engine_type_ != Engine::Type::File || mode != Mode::Subscribe))
+    throw InvalidMetadataImportException(XBT_THROW_POINT, std::string(name));
 }
 
 /// Create the Engine if this is the first actor opening the Stream.
@@ -241,6 +430,10 @@ void Stream::create_engine_if_needed(std::string_view name, Mode mode)
     } else if (engine_type_ == Engine::Type::File) {
       temp_engine = std::make_shared<FileEngine>(name, shared_from_this());
       temp_engine->create_transport(transport_method_);
+      if (does_import_metadata()) {
+        auto last_transaction = import_metadata_from_file();
+        std::static_pointer_cast<FileEngine>(temp_engine)->import_metadata(*metadata_reader_, last_transaction);
+      }
     }
 
     // Only commit if fully initialized
@@ -358,36 +551,97 @@ void Stream::validate_variable_parameters(const std::vector<size_t>& shape, cons
   }
 }
 
-/// This function creates a new Variable and the corresponding entry in the internal directory of the Stream that
-/// stores all the known variables. This definition does not refer to the data carried by the Variable but provides
-/// information about its shape (here a multi-dimensional array) and element type.
-std::shared_ptr<Variable> Stream::define_variable(std::string_view name, const std::vector<size_t>& shape,
-                                                  const std::vector<size_t>& start, const std::vector<size_t>& count,
-                                                  size_t element_size)
+/// Create a Variable of the given kind, or add the calling publisher to the Variable of that name if it already exists
+/// with the same definition.
+std::shared_ptr<Variable> Stream::add_variable(std::string_view name, const std::vector<size_t>& shape,
+                                               const std::vector<size_t>& start, const std::vector<size_t>& count,
+                                               size_t element_size, Variable::Kind kind, size_t joined_dimension)
 {
-  // Validate parameters
-  validate_variable_parameters(shape, start, count, element_size);
-
   std::unique_lock lock(*mutex_);
   auto publisher = sg4::Actor::self();
   std::string name_str(name);
   auto var = variables_.find(name_str);
   if (var != variables_.end()) {
-    if (var->second->get_shape().size() != shape.size() || var->second->get_element_size() != element_size)
+    if (var->second->get_shape().size() != shape.size() || var->second->get_element_size() != element_size ||
+        var->second->get_kind() != kind || var->second->get_joined_dimension() != joined_dimension)
       throw MultipleVariableDefinitionException(XBT_THROW_POINT, name_str + " already exists in Stream " + get_name());
     else {
-      var->second->set_local_start_and_count(publisher, std::make_pair(start, count));
+      var->second->set_local_start_and_count(publisher, {start, count});
       return var->second;
     }
   } else {
-    auto new_var = std::make_shared<Variable>(name_str, element_size, shape, shared_from_this());
-    new_var->set_local_start_and_count(publisher, std::make_pair(start, count));
-    new_var->create_metadata();
+    auto new_var               = std::make_shared<Variable>(name_str, element_size, shape, shared_from_this());
+    new_var->kind_             = kind;
+    new_var->joined_dimension_ = joined_dimension;
+    new_var->set_local_start_and_count(publisher, {start, count});
+    new_var->create_metadata(locations_);
     variables_.try_emplace(name_str, new_var);
     return new_var;
   }
 }
 
+/// This function creates a new Variable and the corresponding entry in the internal directory of the Stream that
+/// stores all the known variables. This definition does not refer to the data carried by the Variable but provides
+/// information about its shape (here a multi-dimensional array) and element type.
+std::shared_ptr<Variable> Stream::define_variable(std::string_view name, const std::vector<size_t>& shape,
+                                                  const std::vector<size_t>& start, const std::vector<size_t>& count,
+                                                  size_t element_size)
+{
+  // Validate parameters
+  validate_variable_parameters(shape, start, count, element_size);
+  return add_variable(name, shape, start, count, element_size, Variable::Kind::GlobalArray);
+}
+
+/// The blocks of a local array have no position: they are all stored at the origin, and the shape of the Variable is
+/// the count of the publisher that defined it first. Blocks are told apart by the rank of their publisher.
+std::shared_ptr<Variable> Stream::define_local_array(std::string_view name, const std::vector<size_t>& count,
+                                                     size_t element_size)
+{
+  std::vector<size_t> start(count.size(), 0);
+  validate_variable_parameters(count, start, count, element_size);
+  return add_variable(name, count, start, count, element_size, Variable::Kind::LocalArray);
+}
+
+/// The blocks of a joined array are put at the origin. Their start along the joined dimension, and the extent of the
+/// Variable along this dimension, are only set when the transaction is sealed, once all the publishers put theirs.
+std::shared_ptr<Variable> Stream::define_joined_array(std::string_view name, const std::vector<size_t>& count,
+                                                      size_t joined_dimension, size_t element_size)
+{
+  std::vector<size_t> start(count.size(), 0);
+  validate_variable_parameters(count, start, count, element_size);
+  if (joined_dimension >= count.size())
+    throw InconsistentVariableDefinitionException(XBT_THROW_POINT, "Cannot join Variable " + std::string(name) +
+                                                                       " along dimension " +
+                                                                       std::to_string(joined_dimension) + " of " +
+                                                                       std::to_string(count.size()));
+  return add_variable(name, count, start, count, element_size, Variable::Kind::JoinedArray, joined_dimension);
+}
+
+size_t Stream::MemoryFootprint::get_total() const noexcept
+{
+  size_t total = locations + journal;
+  for (const auto& [name, bytes] : variables)
+    total += bytes;
+  for (const auto& [name, bytes] : transport)
+    total += bytes;
+  return total;
+}
+
+Stream::MemoryFootprint Stream::get_memory_footprint() const
+{
+  MemoryFootprint footprint;
+  for (const auto& [name, v] : variables_) {
+    footprint.variables[name] = v->get_metadata()->get_memory_footprint();
+    v->get_metadata()->add_transaction_footprints(footprint.transactions);
+  }
+  footprint.locations = locations_->get_memory_footprint();
+  if (metadata_journal_)
+    footprint.journal = metadata_journal_->get_memory_footprint();
+  if (engine_ && engine_->get_transport())
+    engine_->get_transport()->add_memory_footprint(footprint.transport);
+  return footprint;
+}
+
 std::vector<std::string> Stream::get_all_variables() const
 {
   std::vector<std::string> variable_names;
@@ -408,10 +662,12 @@ std::shared_ptr<Variable> Stream::inquire_variable(std::string_view name) const
   if (not engine_ || engine_->get_publishers().contains(actor))
     return var->second;
   else {
-    auto new_var = std::make_shared<Variable>(name_str, var->second->get_element_size(), var->second->get_shape(),
-                                              shared_from_this());
-    new_var->set_local_start_and_count(actor, std::make_pair(std::vector<size_t>(var->second->get_shape().size(), 0),
-                                                             std::vector<size_t>(var->second->get_shape().size(), 0)));
+    auto num_dims = var->second->get_shape().size();
+    auto new_var  = std::make_shared<Variable>(name_str, var->second->get_element_size(), var->second->get_shape(),
+                                               shared_from_this());
+    new_var->kind_             = var->second->get_kind();
+    new_var->joined_dimension_ = var->second->get_joined_dimension();
+    new_var->set_local_start_and_count(actor, {Extents(num_dims, 0), Extents(num_dims, 0)});
     new_var->set_metadata(var->second->get_metadata());
 
     // Propagate reduction state so subscribers can detect publisher-side reduction
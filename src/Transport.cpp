@@ -14,30 +14,15 @@ XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dtlmod_transport, dtlmod_engine, "DTL logging ab
 namespace dtlmod {
 /// \cond EXCLUDE_FROM_DOCUMENTATION
 
-std::vector<std::pair<std::string, sg_size_t>>
-Transport::check_selection_and_get_blocks_to_get(std::shared_ptr<Variable> var) const
+std::vector<std::pair<LocationId, sg_size_t>>
+Transport::check_selection_and_get_blocks_to_get(std::shared_ptr<Variable> var,
+                                                 std::vector<size_t>* num_operations) const
 {
   auto self = sg4::Actor::self();
-  // If the actor made no selection, get the full variable, ie. use a vector full of zeros as start and the global
-  // shape of the variable as count.
-  auto start = std::vector<size_t>(var->get_shape().size(), 0);
-
-  std::vector<size_t> count;
-  if (var->is_reduced_by_subscriber())
-    count = var->get_reduction_method()->get_reduced_variable_shape(*var);
-  else
-    count = var->get_shape();
-
   // If the actor made no transaction selection, get the last one
   unsigned int transaction_start = var->get_metadata()->get_current_transaction();
   unsigned int transaction_count = 1;
 
-  // Check if a selection has been made by this actor, update start and count accordingly if it is the case.
-  if (var->subscriber_has_a_selection(self)) {
-    XBT_DEBUG("Actor %s made a selection for Variable %s", self->get_cname(), var->get_cname());
-    std::tie(start, count) = var->get_subscriber_selection(self);
-  }
-
   // Check if a transaction selection has been made by this actor, update transaction_id and transaction_count
   // accordingly if it is the case.
   if (var->subscriber_has_a_transaction_selection(self)) {
@@ -45,21 +30,115 @@ Transport::check_selection_and_get_blocks_to_get(std::shared_ptr<Variable> var)
     std::tie(transaction_start, transaction_count) = var->get_subscriber_transaction_selection(self);
   }
 
+  // If the actor made no selection, get the full variable, ie. use a vector full of zeros as start and the global
+  // shape the variable had in the transaction as count. Extents are stored inline, so this does not allocate.
+  Extents start(var->get_shape().size(), 0);
+
+  Extents count       = var->get_transaction_shape(transaction_start);
+  bool whole_variable = true;
+  // A subscriber that reduces the Variable itself only reads the elements the reduction keeps, in the shape of each
+  // transaction.
+  Extents whole_stride;
+  if (var->is_reduced_by_subscriber())
+    whole_stride = var->get_reduction_method()->get_read_stride(*var);
+
+  // Check if a selection has been made by this actor, update start and count accordingly if it is the case.
+  Extents stride = whole_stride;
+  if (var->subscriber_has_a_selection(self)) {
+    XBT_DEBUG("Actor %s made a selection for Variable %s", self->get_cname(), var->get_cname());
+    std::tie(start, count) = var->get_subscriber_selection(self);
+    stride                 = var->get_subscriber_selection_stride(self);
+    whole_variable         = false;
+    whole_stride           = Extents();
+  }
+
   if ((transaction_start + transaction_count - 1) > var->get_metadata()->get_current_transaction())
     throw GetWhenNoTransactionException(XBT_THROW_POINT, var->get_name());
 
-  // Store the local count and start for 'var' on this actor
-  var->set_local_start_and_count(self, std::make_pair(start, count));
+  // A block selection takes precedence over the geometric one: the actor stores the region covered by these blocks.
+  auto block_selection = var->get_subscriber_block_selection(self);
+  if (block_selection) {
+    XBT_DEBUG("Actor %s selected %zu block(s) from block %zu of Variable %s", self->get_cname(),
+              block_selection->second, block_selection->first, var->get_cname());
+    std::tie(start, count) =
+        var->get_bounding_box_of_blocks(transaction_start, block_selection->first, block_selection->second);
+    stride         = Extents();
+    whole_variable = false;
+    whole_stride   = Extents();
+  }
+  // So does a publisher selection, whose blocks are looked for in each transaction, as their ids may change.
+  auto publisher_selection = var->get_subscriber_publisher_selection(self);
+  if (publisher_selection) {
+    XBT_DEBUG("Actor %s selected the blocks of publisher %u of Variable %s", self->get_cname(), *publisher_selection,
+              var->get_cname());
+    std::tie(start, count) = var->get_bounding_box_of_blocks(
+        transaction_start, var->get_blocks_of_publisher(transaction_start, *publisher_selection));
+    stride         = Extents();
+    whole_variable = false;
+    whole_stride   = Extents();
+  }
+
+  // Local and joined arrays are read by block: without any selection, the actor gets all the blocks of a transaction,
+  // found by their id rather than by intersecting them with the shape of the Variable.
+  bool all_blocks = whole_variable && whole_stride.empty() && var->get_kind() != Variable::Kind::GlobalArray;
+  if (all_blocks) {
+    if (auto num_blocks = var->get_num_blocks(transaction_start); num_blocks > 0)
+      std::tie(start, count) = var->get_bounding_box_of_blocks(transaction_start, 0, num_blocks);
+  }
+
+  // Store the local count and start for 'var' on this actor. With a stride, it only stores the selected elements.
+  Extents local_count = count;
+  for (size_t d = 0; d < stride.size(); d++)
+    local_count[d] = (count[d] + stride[d] - 1) / stride[d];
+  var->set_local_start_and_count(self, {start, local_count});
 
   // Update the number of stored transactions. Every transaction reset this information
   var->set_transaction_start(std::min(transaction_start, var->get_metadata()->get_current_transaction()));
   var->set_transaction_count(transaction_count);
 
   // Determine what data blocks to read for each requested transaction
-  auto blocks = var->get_sizes_to_get_per_block(transaction_start, start, count);
+  auto value_selection = var->get_subscriber_value_selection(self);
+  const auto& regions  = var->get_subscriber_selection_regions(self);
+  auto get_sizes       = [&](unsigned int transaction_id, std::vector<size_t>* operations) {
+    if (all_blocks) {
+      auto num_blocks = var->get_num_blocks(transaction_id);
+      return num_blocks > 0
+                 ? var->get_sizes_to_get_for_blocks(transaction_id, 0, num_blocks, value_selection, operations)
+                 : std::vector<std::pair<LocationId, sg_size_t>>();
+    }
+    if (publisher_selection)
+      return var->get_sizes_to_get_for_blocks(
+          transaction_id, var->get_blocks_of_publisher(transaction_id, *publisher_selection), value_selection,
+          operations);
+    if (block_selection)
+      return var->get_sizes_to_get_for_blocks(transaction_id, block_selection->first, block_selection->second,
+                                              value_selection, operations);
+    if (not regions.empty())
+      return var->get_sizes_to_get_for_regions(transaction_id, regions, value_selection, operations);
+    // The shape of the Variable may differ from one transaction to the next
+    if (whole_variable && transaction_id != transaction_start)
+      return var->get_read_plan(self, transaction_id, start, var->get_transaction_shape(transaction_id),
+                                value_selection, whole_stride, operations);
+    return var->get_read_plan(self, transaction_id, start, count, value_selection, stride, operations);
+  };
+  // Consecutive transactions with the same block layout need the same sizes from the same locations. Only resolve the
+  // first transaction of each such run, and repeat what it needs for the others.
+  std::vector<size_t> run_operations;
+  auto* operations = num_operations ? &run_operations : nullptr;
+  auto run         = get_sizes(transaction_start, operations);
+  auto blocks      = run;
+  blocks.reserve(run.size() * transaction_count);
+  if (num_operations)
+    num_operations->insert(num_operations->end(), run_operations.begin(), run_operations.end());
   for (unsigned int i = 1; i < transaction_count; i++) {
-    auto extra_block = var->get_sizes_to_get_per_block(transaction_start + i, start, count);
-    blocks.insert(blocks.end(), extra_block.begin(), extra_block.end());
+    auto transaction_id = transaction_start + i;
+    if (not var->have_same_layout(transaction_id, transaction_id - 1)) {
+      run_operations.clear();
+      run = get_sizes(transaction_id, operations);
+    }
+    blocks.insert(blocks.end(), run.begin(), run.end());
+    if (num_operations)
+      num_operations->insert(num_operations->end(), run_operations.begin(), run_operations.end());
   }
   return blocks;
 }
@@ -7,6 +7,7 @@
 #include "dtlmod/CompressionReductionMethod.hpp"
 #include "dtlmod/DTLException.hpp"
 #include "dtlmod/Stream.hpp"
+#include <algorithm>
 #include <limits>
 #include <numeric>
 #include <stdexcept>
@@ -37,21 +38,123 @@ size_t Variable::get_global_size() const
 }
 
 /// The local size of a Variable corresponds to the product of the number of elements in each dimension of the count
-/// vector by the element size. If variable was published to the DTL over multiple transactions, multiply the size by
-/// the number of transactions.
+/// vector by the element size. A subscriber that selected several regions gets the sum of their sizes instead. If
+/// variable was published to the DTL over multiple transactions, multiply the size by the number of transactions.
 size_t Variable::get_local_size() const
 {
-  const auto& start_and_count = local_start_and_count_.at(sg4::Actor::self()).second;
-  auto total_size =
-      std::accumulate(start_and_count.begin(), start_and_count.end(), element_size_, dtlmod::checked_multiply{});
+  auto self         = sg4::Actor::self();
+  size_t total_size = 0;
+  // Block and publisher selections take precedence over the regions, as in
+  // Transport::check_selection_and_get_blocks_to_get()
+  const auto* regions = subscriber_selection_regions_.find(self);
+  bool by_blocks = subscriber_block_selections_.contains(self) || subscriber_publisher_selections_.contains(self);
+  if (regions && not by_blocks) {
+    for (const auto& [start, count] : *regions)
+      total_size += std::accumulate(count.begin(), count.end(), element_size_, dtlmod::checked_multiply{});
+  } else {
+    const auto& count = local_start_and_count_.at(self).second;
+    total_size        = std::accumulate(count.begin(), count.end(), element_size_, dtlmod::checked_multiply{});
+  }
   if (transaction_count_ > 0)
     total_size *= transaction_count_;
   return total_size;
 }
 
+void Variable::set_shape(const std::vector<size_t>& shape)
+{
+  const auto& [start, count] = local_start_and_count_.at(sg4::Actor::self());
+  set_shape(shape, start, count);
+}
+
+void Variable::set_shape(const std::vector<size_t>& shape, const std::vector<size_t>& start,
+                         const std::vector<size_t>& count)
+{
+  if (shape.size() != shape_.size() || start.size() != shape.size() || count.size() != shape.size())
+    throw InconsistentVariableDefinitionException(XBT_THROW_POINT, "The shape of Variable " + name_ +
+                                                                       " cannot change its number of dimensions");
+  for (size_t i = 0; i < shape.size(); i++) {
+    if (start[i] > shape[i] || count[i] > shape[i] - start[i])
+      throw InconsistentVariableDefinitionException(
+          XBT_THROW_POINT, std::string("start + count exceeds the new shape in dimension ") + std::to_string(i) +
+                               " (start: " + std::to_string(start[i]) + ", count: " + std::to_string(count[i]) +
+                               ", shape: " + std::to_string(shape[i]) + ")");
+  }
+  shape_                                     = shape;
+  local_start_and_count_[sg4::Actor::self()] = std::make_pair(start, count);
+  // A reduction applied by the publisher depends on the shape, reduce the Variable again
+  if (is_reduced_with_ && reduction_origin_ == ReductionOrigin::Publisher)
+    is_reduced_with_->reduce_variable(*this);
+}
+
 void Variable::set_selection(const std::vector<size_t>& start, const std::vector<size_t>& count)
 {
+  check_selection_by_region();
   subscriber_selections_[sg4::Actor::self()] = std::make_pair(start, count);
+  subscriber_selection_strides_.erase(sg4::Actor::self());
+  subscriber_selection_regions_.erase(sg4::Actor::self());
+}
+
+void Variable::set_selection(const std::vector<size_t>& start, const std::vector<size_t>& count,
+                             const std::vector<size_t>& stride)
+{
+  check_selection_by_region();
+  if (stride.size() != start.size() || std::find(stride.begin(), stride.end(), 0) != stride.end())
+    throw InvalidSelectionStrideException(XBT_THROW_POINT, std::to_string(stride.size()) + " stride value(s) for " +
+                                                               std::to_string(start.size()) + " dimension(s)");
+  subscriber_selections_[sg4::Actor::self()] = std::make_pair(start, count);
+  subscriber_selection_regions_.erase(sg4::Actor::self());
+  // A unit stride in all dimensions selects all the elements, as the plain selection does
+  if (std::all_of(stride.begin(), stride.end(), [](size_t s) { return s == 1; }))
+    subscriber_selection_strides_.erase(sg4::Actor::self());
+  else
+    subscriber_selection_strides_[sg4::Actor::self()] = stride;
+}
+
+void Variable::set_selection(const std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>>& regions)
+{
+  check_selection_by_region();
+  if (regions.empty())
+    throw InvalidSelectionException(XBT_THROW_POINT, "No region to select in Variable " + name_);
+
+  // The selection of the subscriber is the bounding box of the regions, but the regions are kept to get only them
+  Extents lower(shape_.size(), std::numeric_limits<size_t>::max());
+  Extents upper(shape_.size(), 0);
+  std::vector<std::pair<Extents, Extents>> selected_regions;
+  selected_regions.reserve(regions.size());
+  for (const auto& [start, count] : regions) {
+    if (start.size() != shape_.size() || count.size() != shape_.size())
+      throw InvalidSelectionException(XBT_THROW_POINT, "Region with " + std::to_string(start.size()) +
+                                                           " start(s) and " + std::to_string(count.size()) +
+                                                           " count(s) for " + std::to_string(shape_.size()) +
+                                                           " dimension(s)");
+    for (size_t d = 0; d < shape_.size(); d++) {
+      if (start[d] > shape_[d] || count[d] > shape_[d] - start[d])
+        throw InvalidSelectionException(XBT_THROW_POINT, "Region " + std::to_string(selected_regions.size()) +
+                                                             " exceeds the shape of Variable " + name_ +
+                                                             " in dimension " + std::to_string(d));
+      lower[d] = std::min(lower[d], start[d]);
+      upper[d] = std::max(upper[d], start[d] + count[d]);
+    }
+    // Regions are few, comparing each of them with the previous ones is cheaper than sorting them
+    for (size_t r = 0; r < selected_regions.size(); r++) {
+      const auto& [other_start, other_count] = selected_regions[r];
+      bool overlap                           = true;
+      for (size_t d = 0; d < shape_.size() && overlap; d++)
+        overlap = start[d] < other_start[d] + other_count[d] && other_start[d] < start[d] + count[d];
+      if (overlap)
+        throw InvalidSelectionException(XBT_THROW_POINT, "Regions " + std::to_string(r) + " and " +
+                                                             std::to_string(selected_regions.size()) +
+                                                             " of the selection overlap");
+    }
+    selected_regions.emplace_back(start, count);
+  }
+  for (size_t d = 0; d < shape_.size(); d++)
+    upper[d] -= lower[d];
+
+  auto self                           = sg4::Actor::self();
+  subscriber_selections_[self]        = std::make_pair(lower, upper);
+  subscriber_selection_regions_[self] = std::move(selected_regions);
+  subscriber_selection_strides_.erase(self);
 }
 
 void Variable::set_transaction_selection(unsigned int begin, unsigned int count)
@@ -59,6 +162,49 @@ void Variable::set_transaction_selection(unsigned int begin, unsigned int count)
   subscriber_transaction_selections_[sg4::Actor::self()] = std::make_pair(begin, count);
 }
 
+void Variable::set_value_selection(double min, double max)
+{
+  if (min > max)
+    throw InvalidValueRangeException(XBT_THROW_POINT, "[" + std::to_string(min) + ", " + std::to_string(max) + "]");
+  subscriber_value_selections_[sg4::Actor::self()] = std::make_pair(min, max);
+}
+
+void Variable::unset_value_selection()
+{
+  subscriber_value_selections_.erase(sg4::Actor::self());
+}
+
+void Variable::set_block_selection(size_t begin, size_t count)
+{
+  if (count == 0)
+    throw InvalidBlockSelectionException(XBT_THROW_POINT, "Empty range of blocks starting at " + std::to_string(begin));
+  subscriber_block_selections_[sg4::Actor::self()] = std::make_pair(begin, count);
+  subscriber_publisher_selections_.erase(sg4::Actor::self());
+}
+
+void Variable::unset_block_selection()
+{
+  subscriber_block_selections_.erase(sg4::Actor::self());
+}
+
+void Variable::set_publisher_selection(unsigned int rank)
+{
+  subscriber_publisher_selections_[sg4::Actor::self()] = rank;
+  subscriber_block_selections_.erase(sg4::Actor::self());
+}
+
+void Variable::unset_publisher_selection()
+{
+  subscriber_publisher_selections_.erase(sg4::Actor::self());
+}
+
+void Variable::set_value_range(double min, double max)
+{
+  if (min > max)
+    throw InvalidValueRangeException(XBT_THROW_POINT, "[" + std::to_string(min) + ", " + std::to_string(max) + "]");
+  publisher_value_ranges_[sg4::Actor::self()] = std::make_pair(min, max);
+}
+
 void Variable::set_reduction_operation(std::shared_ptr<ReductionMethod> method,
                                        const std::map<std::string, std::string, std::less<>>& parameters)
 {
@@ -95,93 +241,376 @@ void Variable::set_reduction_operation(std::shared_ptr<ReductionMethod> method,
 ////////////////////////////////////////////
 
 /// \cond EXCLUDE_FROM_DOCUMENTATION
+void Variable::check_selection_by_region() const
+{
+  if (kind_ == Kind::LocalArray)
+    throw InvalidSelectionException(XBT_THROW_POINT, "Variable " + name_ +
+                                                         " is a local array, its blocks can only be selected by id");
+}
+
+void Variable::forget_subscriber(const sg4::ActorPtr& actor) noexcept
+{
+  subscriber_selections_.erase(actor);
+  subscriber_selection_strides_.erase(actor);
+  subscriber_selection_regions_.erase(actor);
+  subscriber_transaction_selections_.erase(actor);
+  subscriber_value_selections_.erase(actor);
+  subscriber_block_selections_.erase(actor);
+  subscriber_publisher_selections_.erase(actor);
+  read_plans_.erase(actor);
+}
+
 bool Variable::subscriber_has_a_selection(sg4::ActorPtr actor) const
 {
-  return subscriber_selections_.find(actor) != subscriber_selections_.end();
+  return subscriber_selections_.contains(actor);
 }
 
 bool Variable::subscriber_has_a_transaction_selection(sg4::ActorPtr actor) const
 {
-  return subscriber_transaction_selections_.find(actor) != subscriber_transaction_selections_.end();
+  return subscriber_transaction_selections_.contains(actor);
 }
 
-const std::pair<std::vector<size_t>, std::vector<size_t>>& Variable::get_subscriber_selection(sg4::ActorPtr actor) const
+const std::pair<Extents, Extents>& Variable::get_subscriber_selection(sg4::ActorPtr actor) const
 {
   return subscriber_selections_.at(actor);
 }
 
+Extents Variable::get_subscriber_selection_stride(sg4::ActorPtr actor) const
+{
+  const auto* stride = subscriber_selection_strides_.find(actor);
+  if (not stride)
+    return Extents();
+  return *stride;
+}
+
+const std::vector<std::pair<Extents, Extents>>& Variable::get_subscriber_selection_regions(sg4::ActorPtr actor) const
+{
+  static const std::vector<std::pair<Extents, Extents>> no_regions;
+  const auto* regions = subscriber_selection_regions_.find(actor);
+  if (not regions)
+    return no_regions;
+  return *regions;
+}
+
 const std::pair<unsigned int, unsigned int>& Variable::get_subscriber_transaction_selection(sg4::ActorPtr actor) const
 {
   return subscriber_transaction_selections_.at(actor);
 }
 
-void Variable::add_transaction_metadata(unsigned int transaction_id, sg4::ActorPtr publisher,
-                                        const std::string& location)
+std::optional<ValueRange> Variable::get_subscriber_value_selection(sg4::ActorPtr actor) const
 {
+  const auto* value_selection = subscriber_value_selections_.find(actor);
+  if (not value_selection)
+    return std::nullopt;
+  return *value_selection;
+}
+
+std::optional<std::pair<size_t, size_t>> Variable::get_subscriber_block_selection(sg4::ActorPtr actor) const
+{
+  const auto* block_selection = subscriber_block_selections_.find(actor);
+  if (not block_selection)
+    return std::nullopt;
+  return *block_selection;
+}
+
+std::optional<unsigned int> Variable::get_subscriber_publisher_selection(sg4::ActorPtr actor) const
+{
+  const auto* publisher_selection = subscriber_publisher_selections_.find(actor);
+  if (not publisher_selection)
+    return std::nullopt;
+  return *publisher_selection;
+}
+
+std::optional<ValueRange>
+Variable::get_publisher_value_range(sg4::ActorPtr publisher, unsigned int transaction_id,
+                                    const std::pair<Extents, Extents>& start_and_count) const
+{
+  // Value statistics given by the publisher itself take precedence over the model of the Variable
+  if (const auto* value_range = publisher_value_ranges_.find(publisher))
+    return *value_range;
+  if (value_model_)
+    return value_model_(transaction_id, start_and_count.first, start_and_count.second);
+  return std::nullopt;
+}
+
+void Variable::add_transaction_metadata(unsigned int transaction_id, sg4::ActorPtr publisher, LocationId location)
+{
+  // The shape of a joined array in a transaction is only known when the transaction is sealed, local arrays have none
+  if (kind_ == Kind::GlobalArray) {
+    // The shape can only change between transactions: all the blocks of a transaction share the same shape
+    if (metadata_->transaction_infos_.find(transaction_id) != metadata_->transaction_infos_.end() &&
+        metadata_->get_shape(transaction_id) != shape_)
+      throw InconsistentVariableDefinitionException(XBT_THROW_POINT, "Shape of Variable " + name_ +
+                                                                         " changed during transaction " +
+                                                                         std::to_string(transaction_id));
+    metadata_->record_shape(transaction_id, shape_);
+  }
   if (is_reduced_with_) {
-    auto start_and_count = is_reduced_with_->get_reduced_start_and_count_for(*this, publisher);
-    metadata_->add_transaction(transaction_id, start_and_count, location, publisher);
-  } else
-    metadata_->add_transaction(transaction_id, local_start_and_count_[publisher], location, publisher);
+    // Reduction methods return std::vector<size_t>, as in the public API, while the metadata stores Extents
+    const std::pair<Extents, Extents> start_and_count =
+        is_reduced_with_->get_reduced_start_and_count_for(*this, publisher);
+    metadata_->add_transaction(transaction_id, start_and_count, location, publisher,
+                               get_publisher_value_range(publisher, transaction_id, start_and_count));
+  } else {
+    const auto& start_and_count = local_start_and_count_[publisher];
+    metadata_->add_transaction(transaction_id, start_and_count, location, publisher,
+                               get_publisher_value_range(publisher, transaction_id, start_and_count));
+  }
+  // The values of the next block are not those of this one
+  publisher_value_ranges_.erase(publisher);
 }
 
-std::vector<std::pair<std::string, sg_size_t>>
-Variable::get_sizes_to_get_per_block(unsigned int transaction_id, const std::vector<size_t>& start,
-                                     const std::vector<size_t>& count) const
+std::vector<std::pair<LocationId, sg_size_t>>
+Variable::get_sizes_to_get_per_block(unsigned int transaction_id, const Extents& start, const Extents& count,
+                                     const std::optional<ValueRange>& value_selection, const Extents& stride,
+                                     std::vector<size_t>* num_operations) const
 {
   // Defensive check (should never trigger due to earlier validation)
-  xbt_assert(start.size() == count.size() && start.size() == shape_.size(),
+  xbt_assert(start.size() == count.size() && start.size() == shape_.size() &&
+                 (stride.empty() || stride.size() == start.size()),
              "Internal error: dimension mismatch in get_sizes_to_get_per_block");
 
-  std::vector<std::pair<std::string, sg_size_t>> get_sizes_per_block;
+  std::vector<std::pair<LocationId, sg_size_t>> get_sizes_per_block;
   // Validate transaction_id is within valid range (defense-in-depth: Transport also checks this)
   if (transaction_id > metadata_->get_current_transaction())                              // LCOV_EXCL_LINE
     throw InvalidTransactionIdException(XBT_THROW_POINT, std::to_string(transaction_id)); // LCOV_EXCL_LINE
 
-  auto blocks = metadata_->get_blocks_for_transaction(transaction_id);
-  XBT_DEBUG("%zu block(s) to check for transaction %u", blocks.size(), transaction_id);
-  // For each block, compute the intersection between the requested region [start, start+count)
-  // and the available block region [block_start, block_start+block_count) in each dimension.
-  // Two cases of overlap are checked:
-  //   1. Block starts within or after the requested region: start <= block_start < start+count
-  //   2. Request starts within the block: block_start < start < block_start+block_count
-  // The size to retrieve is the product of intersection sizes across all dimensions.
-  // If any dimension has no overlap, nothing is retrieved from this block.
-  for (const auto& [block_info, location] : blocks) {
-    size_t size_to_get              = element_size_;
-    auto [block_start, block_count] = block_info;
-    auto [where, actor]             = location;
-    auto something_to_get           = std::vector<bool>(start.size(), false);
-    // Determine whether some elements have to be retrieved from this particular block
-    for (unsigned i = 0; i < start.size(); i++) {
-      XBT_DEBUG("Subscriber %s checks Publisher %s", sg4::Actor::self()->get_cname(), actor->get_cname());
-      XBT_DEBUG("Dimension %u: wanted [%zu, %zu] vs. in block [%zu, %zu]", i, start[i], count[i], block_start[i],
-                block_count[i]);
-      size_t size_in_dim = 0;
-      bool element_found = false;
-      if (start[i] <= block_start[i] && (block_start[i] - start[i]) <= count[i]) {
-        size_in_dim   = std::min(block_count[i], count[i] - (block_start[i] - start[i]));
-        element_found = true;
-      }
-      if (start[i] > block_start[i] && (start[i] - block_start[i]) <= block_count[i]) {
-        size_in_dim   = std::min(count[i], block_count[i] - (start[i] - block_start[i]));
-        element_found = true;
-      }
+  const auto& blocks = metadata_->get_blocks_for_transaction(transaction_id);
+  // Only visit the blocks that intersect the requested region [start, start+count). For large transactions, they are
+  // found through a spatial index rather than by scanning all the blocks.
+  std::vector<size_t> hits;
+  blocks.find_intersecting_blocks(start, count, hits);
+  XBT_DEBUG("%zu block(s) out of %zu intersect the selection for transaction %u", hits.size(), blocks.size(),
+            transaction_id);
+  // Then skip the blocks whose values cannot match the value selection, before any read or transfer is scheduled
+  if (value_selection && blocks.has_value_ranges()) {
+    auto num_hits = hits.size();
+    hits.erase(std::remove_if(hits.begin(), hits.end(),
+                              [&blocks, &value_selection](size_t b) {
+                                return not blocks.may_hold_values_in(b, *value_selection);
+                              }),
+               hits.end());
+    XBT_DEBUG("%zu block(s) skipped by the value selection [%g, %g]", num_hits - hits.size(), value_selection->first,
+              value_selection->second);
+  }
+  // The size to retrieve from a block is the product, across all dimensions, of the sizes of the intersection between
+  // the requested region and the block region [block_start, block_start+block_count). With a stride, only the selected
+  // elements of this intersection count, and a block that holds none of them is not read at all.
+  for (auto b : hits) {
+    auto volume = blocks.get_overlap_volume(start, count, stride, b);
+    if (volume == 0)
+      continue;
+    size_t size_to_get = element_size_ * volume;
+    auto where         = blocks.get_location_id(b);
+    // Blocks read from an imported metadata file have no publisher, name the location instead
+    XBT_DEBUG("Subscriber %s gets %zu bytes from %s", sg4::Actor::self()->get_cname(), size_to_get,
+              metadata_->get_locations()->get_cname(where));
+    get_sizes_per_block.emplace_back(where, size_to_get);
+    if (num_operations)
+      num_operations->push_back(blocks.get_num_contiguous_runs(start, count, stride, b));
+  }
+  return get_sizes_per_block;
+}
+
+std::vector<std::pair<LocationId, sg_size_t>>
+Variable::get_read_plan(sg4::ActorPtr actor, unsigned int transaction_id, const Extents& start, const Extents& count,
+                        const std::optional<ValueRange>& value_selection, const Extents& stride,
+                        std::vector<size_t>* num_operations) const
+{
+  // Consecutive transactions usually share their block layout and subscribers keep the same selection. Then the blocks
+  // to get are those found for the previous transaction.
+  auto layout      = metadata_->get_layout(transaction_id);
+  const auto* plan = read_plans_.find(actor);
+  auto same_layout = [&layout](const ReadPlan& p) {
+    auto planned = p.layout.lock();
+    return layout && planned &&
+           (planned == layout || (planned->get_layout_fingerprint() == layout->get_layout_fingerprint() &&
+                                  planned->has_same_layout(*layout)));
+  };
+  if (plan && plan->start == start && plan->count == count && plan->stride == stride &&
+      plan->value_selection == value_selection && same_layout(*plan)) {
+    XBT_DEBUG("Reuse the read plan of %s for transaction %u", actor->get_cname(), transaction_id);
+    read_plan_cache_hits_++;
+    if (num_operations)
+      num_operations->insert(num_operations->end(), plan->num_operations.begin(), plan->num_operations.end());
+    return plan->blocks;
+  }
+  read_plan_cache_misses_++;
+  std::vector<size_t> plan_operations;
+  auto blocks = get_sizes_to_get_per_block(transaction_id, start, count, value_selection, stride, &plan_operations);
+  if (num_operations)
+    num_operations->insert(num_operations->end(), plan_operations.begin(), plan_operations.end());
+  read_plans_[actor] = {start, count, stride, value_selection, layout, blocks, std::move(plan_operations)};
+  return blocks;
+}
+
+std::vector<std::pair<LocationId, sg_size_t>>
+Variable::get_sizes_to_get_for_regions(unsigned int transaction_id,
+                                       const std::vector<std::pair<Extents, Extents>>& regions,
+                                       const std::optional<ValueRange>& value_selection,
+                                       std::vector<size_t>* num_operations) const
+{
+  if (transaction_id > metadata_->get_current_transaction())                              // LCOV_EXCL_LINE
+    throw InvalidTransactionIdException(XBT_THROW_POINT, std::to_string(transaction_id)); // LCOV_EXCL_LINE
 
-      if (element_found && size_in_dim > 0) {
-        something_to_get[i] = true;
-        XBT_DEBUG("Multiply size to read by %zu elements", size_in_dim);
-        size_to_get *= size_in_dim;
+  const auto& blocks = metadata_->get_blocks_for_transaction(transaction_id);
+  // What each region needs from each location is added to a single entry per location, in the order in which the
+  // locations are first met. Then a subscriber makes one transfer per location, whatever the number of regions.
+  std::vector<std::pair<LocationId, sg_size_t>> get_sizes_per_location;
+  std::vector<size_t> operations_per_location;
+  std::unordered_map<LocationId, size_t> entry_of_location;
+  std::vector<size_t> hits;
+  for (const auto& [start, count] : regions) {
+    hits.clear();
+    blocks.find_intersecting_blocks(start, count, hits);
+    for (auto b : hits) {
+      if (value_selection && blocks.has_value_ranges() && not blocks.may_hold_values_in(b, *value_selection))
+        continue;
+      auto volume          = blocks.get_overlap_volume(start, count, Extents(), b);
+      auto where           = blocks.get_location_id(b);
+      auto [entry, is_new] = entry_of_location.try_emplace(where, get_sizes_per_location.size());
+      if (is_new) {
+        get_sizes_per_location.emplace_back(where, 0);
+        operations_per_location.push_back(0);
       }
+      get_sizes_per_location[entry->second].second += element_size_ * volume;
+      if (volume > 0)
+        operations_per_location[entry->second] += blocks.get_num_contiguous_runs(start, count, Extents(), b);
     }
+  }
+  if (num_operations)
+    num_operations->insert(num_operations->end(), operations_per_location.begin(), operations_per_location.end());
+  XBT_DEBUG("%zu region(s) of transaction %u are read from %zu location(s)", regions.size(), transaction_id,
+            get_sizes_per_location.size());
+  return get_sizes_per_location;
+}
 
-    if (std::all_of(something_to_get.begin(), something_to_get.end(), [](bool v) { return v; })) {
-      XBT_DEBUG("Total size to read from %s: %zu)", where.c_str(), size_to_get);
-      get_sizes_per_block.emplace_back(where, size_to_get);
-    }
+// Block ids are positions in the sealed table of the transaction: by starting position for global arrays, by rank of
+// their publisher for local and joined arrays.
+const BlockTable& Variable::get_selected_blocks(unsigned int transaction_id, size_t begin, size_t count) const
+{
+  if (transaction_id > metadata_->get_current_transaction())                              // LCOV_EXCL_LINE
+    throw InvalidTransactionIdException(XBT_THROW_POINT, std::to_string(transaction_id)); // LCOV_EXCL_LINE
+
+  const auto& blocks = metadata_->get_blocks_for_transaction(transaction_id);
+  if (begin >= blocks.size() || count > blocks.size() - begin)
+    throw InvalidBlockSelectionException(XBT_THROW_POINT, "Blocks [" + std::to_string(begin) + ", " +
+                                                              std::to_string(begin + count) + ") of transaction " +
+                                                              std::to_string(transaction_id) + " (" +
+                                                              std::to_string(blocks.size()) + " blocks)");
+  return blocks;
+}
+
+std::vector<std::pair<LocationId, sg_size_t>>
+Variable::get_sizes_to_get_for_blocks(unsigned int transaction_id, size_t begin, size_t count,
+                                      const std::optional<ValueRange>& value_selection,
+                                      std::vector<size_t>* num_operations) const
+{
+  // Blocks are sealed in a fixed order, so selected blocks are found by their id without any intersection test and the
+  // full block is retrieved, in a single I/O operation.
+  const auto& blocks = get_selected_blocks(transaction_id, begin, count);
+  std::vector<std::pair<LocationId, sg_size_t>> get_sizes_per_block;
+  for (auto b = begin; b < begin + count; b++) {
+    if (value_selection && not blocks.may_hold_values_in(b, *value_selection))
+      continue;
+    const auto* block_count = blocks.get_count(b);
+    auto size_to_get =
+        std::accumulate(block_count, block_count + blocks.get_num_dims(), element_size_, dtlmod::checked_multiply{});
+    auto where = blocks.get_location_id(b);
+    XBT_DEBUG("Subscriber %s gets block %zu (%zu bytes) from %s", sg4::Actor::self()->get_cname(), b, size_to_get,
+              metadata_->get_locations()->get_cname(where));
+    get_sizes_per_block.emplace_back(where, size_to_get);
+    if (num_operations)
+      num_operations->push_back(1);
   }
   return get_sizes_per_block;
 }
+
+std::vector<std::pair<LocationId, sg_size_t>>
+Variable::get_sizes_to_get_for_blocks(unsigned int transaction_id, const std::vector<size_t>& block_ids,
+                                      const std::optional<ValueRange>& value_selection,
+                                      std::vector<size_t>* num_operations) const
+{
+  std::vector<std::pair<LocationId, sg_size_t>> get_sizes_per_block;
+  for (auto b : block_ids) {
+    auto sizes = get_sizes_to_get_for_blocks(transaction_id, b, 1, value_selection, num_operations);
+    get_sizes_per_block.insert(get_sizes_per_block.end(), sizes.begin(), sizes.end());
+  }
+  return get_sizes_per_block;
+}
+
+std::pair<Extents, Extents>
+Variable::get_bounding_box_of_blocks(unsigned int transaction_id, const std::vector<size_t>& block_ids) const
+{
+  auto [lower, extent] = get_bounding_box_of_blocks(transaction_id, block_ids.front(), 1);
+  for (size_t i = 1; i < block_ids.size(); i++) {
+    auto [start, count] = get_bounding_box_of_blocks(transaction_id, block_ids[i], 1);
+    for (size_t d = 0; d < lower.size(); d++) {
+      auto upper = std::max(lower[d] + extent[d], start[d] + count[d]);
+      lower[d]   = std::min(lower[d], start[d]);
+      extent[d]  = upper - lower[d];
+    }
+  }
+  return std::make_pair(lower, extent);
+}
+
+std::vector<size_t> Variable::get_blocks_of_publisher(unsigned int transaction_id, unsigned int rank) const
+{
+  if (transaction_id > metadata_->get_current_transaction())                              // LCOV_EXCL_LINE
+    throw InvalidTransactionIdException(XBT_THROW_POINT, std::to_string(transaction_id)); // LCOV_EXCL_LINE
+
+  // Blocks record the id of their publisher in the metadata, which the Engine knows by its rank. Imported blocks have
+  // no publisher, and thus no rank.
+  const auto& blocks = metadata_->get_blocks_for_transaction(transaction_id);
+  std::vector<size_t> block_ids;
+  if (not metadata_->reader_) {
+    auto ranks = metadata_->get_writer_ranks(*this);
+    for (size_t b = 0; b < blocks.size(); b++)
+      if (ranks[blocks.get_publisher_id(b)] == rank)
+        block_ids.push_back(b);
+  }
+  if (block_ids.empty())
+    throw InvalidBlockSelectionException(XBT_THROW_POINT, "No block put by the publisher of rank " +
+                                                              std::to_string(rank) + " in transaction " +
+                                                              std::to_string(transaction_id));
+  return block_ids;
+}
+
+std::pair<Extents, Extents>
+Variable::get_bounding_box_of_blocks(unsigned int transaction_id, size_t begin, size_t count) const
+{
+  const auto& blocks = get_selected_blocks(transaction_id, begin, count);
+  auto num_dims      = blocks.get_num_dims();
+  Extents lower(blocks.get_start(begin), blocks.get_start(begin) + num_dims);
+  Extents upper(num_dims);
+  for (auto b = begin; b < begin + count; b++) {
+    for (size_t i = 0; i < num_dims; i++) {
+      lower[i] = std::min(lower[i], blocks.get_start(b)[i]);
+      upper[i] = std::max(upper[i], blocks.get_start(b)[i] + blocks.get_count(b)[i]);
+    }
+  }
+  Extents extent(num_dims);
+  for (size_t i = 0; i < num_dims; i++)
+    extent[i] = upper[i] - lower[i];
+  return std::make_pair(lower, extent);
+}
+
+size_t Variable::get_num_blocks(unsigned int transaction_id) const
+{
+  if (transaction_id > metadata_->get_current_transaction())                              // LCOV_EXCL_LINE
+    throw InvalidTransactionIdException(XBT_THROW_POINT, std::to_string(transaction_id)); // LCOV_EXCL_LINE
+  return metadata_->get_blocks_for_transaction(transaction_id).size();
+}
+
+bool Variable::have_same_layout(unsigned int transaction_id, unsigned int other_transaction_id) const
+{
+  // Transactions that share a sealed table are found without comparing it. Otherwise, tables whose fingerprints differ
+  // cannot have the same layout, and those that match are compared block by block, as fingerprints can collide.
+  const auto& blocks       = metadata_->get_blocks_for_transaction(transaction_id);
+  const auto& other_blocks = metadata_->get_blocks_for_transaction(other_transaction_id);
+  return &blocks == &other_blocks || (blocks.get_layout_fingerprint() == other_blocks.get_layout_fingerprint() &&
+                                      blocks.has_same_layout(other_blocks));
+}
 /// \endcond
 
 } // namespace dtlmod
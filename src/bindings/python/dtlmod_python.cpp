@@ -76,6 +76,10 @@ PYBIND11_MODULE(dtlmod, m)
   py::register_exception<dtlmod::IncorrectPathDefinitionException>(m, "IncorrectPathDefinitionException");
 
   py::register_exception<dtlmod::GetWhenNoTransactionException>(m, "GetWhenNoTransactionException");
+  py::register_exception<dtlmod::InvalidValueRangeException>(m, "InvalidValueRangeException");
+  py::register_exception<dtlmod::InvalidBlockSelectionException>(m, "InvalidBlockSelectionException");
+  py::register_exception<dtlmod::InvalidSelectionException>(m, "InvalidSelectionException");
+  py::register_exception<dtlmod::InvalidSelectionStrideException>(m, "InvalidSelectionStrideException");
 
   py::register_exception<dtlmod::UnknownReductionMethodException>(m, "UnknownReductionMethodException");
   py::register_exception<dtlmod::InconsistentDecimationStrideException>(m, "InconsistentDecimationStrideException");
@@ -89,6 +93,11 @@ PYBIND11_MODULE(dtlmod, m)
   py::register_exception<dtlmod::InconsistentCompressionRatioException>(m, "InconsistentCompressionRatioException");
   py::register_exception<dtlmod::SubscriberSideCompressionException>(m, "SubscriberSideCompressionException");
 
+  py::register_exception<dtlmod::UnknownMetadataFormatException>(m, "UnknownMetadataFormatException");
+  py::register_exception<dtlmod::InvalidMetadataFileException>(m, "InvalidMetadataFileException");
+  py::register_exception<dtlmod::InvalidMetadataImportException>(m, "InvalidMetadataImportException");
+  py::register_exception<dtlmod::MetadataSpillException>(m, "MetadataSpillException");
+
   py::register_exception<dtlmod::TransactionCanceledException>(m, "TransactionCanceledException");
   py::register_exception<dtlmod::EndOfStreamException>(m, "EndOfStreamException");
 
@@ -103,12 +112,18 @@ PYBIND11_MODULE(dtlmod, m)
       .def("put", py::overload_cast<const std::shared_ptr<Variable>&, size_t>(&Engine::put, py::const_), py::arg("var"),
            py::arg("simulated_size_in_bytes"), py::call_guard<simgrid::SimGridGilGuard>(),
            "Put a Variable in the DTL using this Engine")
+      .def("perform_puts", &Engine::perform_puts, py::call_guard<simgrid::SimGridGilGuard>(),
+           "Write out the data put so far in the current transaction, without waiting for its end")
       .def("get", &Engine::get, py::arg("var"), py::call_guard<simgrid::SimGridGilGuard>(),
            "Get a Variable from the DTL using this Engine")
       .def("end_transaction", &Engine::end_transaction, py::call_guard<simgrid::SimGridGilGuard>(),
            "End a transaction on this Engine")
       .def_property_readonly("current_transaction", &Engine::get_current_transaction,
                              "The id of the current transaction on this Engine (read-only)")
+      .def_property_readonly("staging_queue_occupancy", &Engine::get_staging_queue_occupancy,
+                             "The number of transactions held in staging (read-only)")
+      .def_property_readonly("staging_queue_history", &Engine::get_staging_queue_history,
+                             "The (date, number of transactions held in staging) pairs recorded over time (read-only)")
       .def("cancel_transaction", &Engine::cancel_transaction, py::call_guard<simgrid::SimGridGilGuard>(),
            py::arg("transaction_id"),
            "Cancel all in-flight activities of a specific transaction (must be called from an external actor)")
@@ -178,6 +193,20 @@ PYBIND11_MODULE(dtlmod, m)
                              "Print out the access mode of this Stream (read-only)")
       .def_property_readonly("metadata_export", &Stream::does_export_metadata,
                              "Does the stream export metadata (read only)")
+      .def_property_readonly("metadata_export_format", &Stream::get_metadata_export_format,
+                             "Get the format in which the stream exports metadata (read-only)")
+      .def_property_readonly("metadata_memory_budget", &Stream::get_metadata_memory_budget,
+                             "Get the memory budget of the metadata of the stream, in bytes (read-only)")
+      .def_property_readonly("metadata_io_simulation", &Stream::does_simulate_metadata_io,
+                             "Does the stream simulate the I/O operations on metadata (read-only)")
+      .def_property_readonly("metadata_aggregation_arity", &Stream::get_metadata_aggregation_arity,
+                             "Get the arity of the tree along which metadata is aggregated, 0 if free (read-only)")
+      .def_property_readonly("min_io_size", &Stream::get_min_io_size,
+                             "Get the smallest size of an I/O operation, in bytes, 0 if not modeled (read-only)")
+      .def_property_readonly("put_buffer_capacity", &Stream::get_put_buffer_capacity,
+                             "Get the capacity of the put buffer of each publisher, in bytes, 0 if none (read-only)")
+      .def_property_readonly("staging_queue_depth", &Stream::get_staging_queue_depth,
+                             "Get the number of transactions publishers can be ahead of subscribers (read-only)")
       .def("set_engine_type", &Stream::set_engine_type, py::arg("type"),
            "Set the engine type associated to this Stream")
       .def("set_transport_method", &Stream::set_transport_method, py::arg("method"),
@@ -186,6 +215,24 @@ PYBIND11_MODULE(dtlmod, m)
            "Specify that metadata must be exported for that stream")
       .def("unset_metadata_export", &Stream::unset_metadata_export,
            "Specify that metadata must not be exported for that stream")
+      .def("set_metadata_export_format", &Stream::set_metadata_export_format, py::arg("format"),
+           "Set the format in which metadata is exported for that stream")
+      .def("set_metadata_import", &Stream::set_metadata_import, py::arg("file_name"),
+           "Specify that subscribers read the metadata of that stream from a file exported in the binary format")
+      .def("set_metadata_memory_budget", &Stream::set_metadata_memory_budget, py::arg("bytes"),
+           "Bound the memory used by the metadata of that stream (0 means unlimited)")
+      .def("set_metadata_io_simulation", &Stream::set_metadata_io_simulation,
+           "Specify that the I/O operations on metadata must be simulated for that stream")
+      .def("unset_metadata_io_simulation", &Stream::unset_metadata_io_simulation,
+           "Specify that metadata must not cost any simulated time for that stream")
+      .def("set_metadata_aggregation", &Stream::set_metadata_aggregation, py::arg("arity"),
+           "Simulate the aggregation of the metadata of the publishers of that stream along a tree (0 means free)")
+      .def("set_min_io_size", &Stream::set_min_io_size, py::arg("bytes"),
+           "Set the smallest amount of data transferred by an I/O operation of a subscriber (0 means not modeled)")
+      .def("set_put_buffer_capacity", &Stream::set_put_buffer_capacity, py::arg("bytes"),
+           "Buffer the puts of each publisher of that stream and write them in one operation (0 means no buffer)")
+      .def("set_staging_queue_depth", &Stream::set_staging_queue_depth, py::arg("transactions"),
+           "Let the publishers of that stream be that many transactions ahead of the subscribers (0 means lockstep)")
       // Engine factory
       .def("open", &Stream::open, py::arg("name"), py::call_guard<simgrid::SimGridGilGuard>(), py::arg("mode"),
            "Open a Stream and create an Engine")
@@ -208,28 +255,74 @@ PYBIND11_MODULE(dtlmod, m)
              size_t element_size) { return self.define_variable(name, shape, start, count, element_size); },
           py::call_guard<simgrid::SimGridGilGuard>(), py::arg("name"), py::arg("shape"), py::arg("start"),
           py::arg("count"), py::arg("element_size"), "Define a variable for this Stream")
+      .def("define_local_array", &Stream::define_local_array, py::call_guard<simgrid::SimGridGilGuard>(),
+           py::arg("name"), py::arg("count"), py::arg("element_size"),
+           "Define a variable for this Stream made of one array per publisher, addressed by the rank of its writer")
+      .def("define_joined_array", &Stream::define_joined_array, py::call_guard<simgrid::SimGridGilGuard>(),
+           py::arg("name"), py::arg("count"), py::arg("joined_dimension"), py::arg("element_size"),
+           "Define a variable for this Stream whose publishers' arrays are laid end to end along one dimension")
       .def_property_readonly("all_variables", &Stream::get_all_variables, "Retrieve the list of Variables by names")
       .def_property_readonly("metadata_file_name", &Stream::get_metadata_file_name,
                              "The name of the file in which the stream stores metadata (read-only)")
+      .def_property_readonly("metadata_import_file_name", &Stream::get_metadata_import_file_name,
+                             "The name of the file from which the stream imports metadata (read-only)")
       .def("inquire_variable", &Stream::inquire_variable, py::arg("name"), "Retrieve a Variable information by name")
       .def("remove_variable", &Stream::remove_variable, py::arg("name"), "Remove a Variable from this Stream")
       .def("define_reduction_method", &Stream::define_reduction_method, py::arg("name"),
-           "Define a reduction method for this Stream (e.g. 'decimation' or 'compression')");
+           "Define a reduction method for this Stream (e.g. 'decimation' or 'compression')")
+      .def_property_readonly("memory_footprint", &Stream::get_memory_footprint,
+                             "The approximate host memory used by the metadata and the transport of this Stream "
+                             "(read-only)");
 
   py::enum_<Stream::Mode>(stream, "Mode", "The access mode for a Stream")
       .value("Publish", Stream::Mode::Publish)
       .value("Subscribe", Stream::Mode::Subscribe);
 
+  py::enum_<Stream::MetadataFormat>(stream, "MetadataFormat", "The format of the exported metadata file")
+      .value("Text", Stream::MetadataFormat::Text)
+      .value("Binary", Stream::MetadataFormat::Binary);
+
+  py::class_<Stream::MemoryFootprint>(stream, "MemoryFootprint",
+                                      "The approximate host memory used by a Stream, in bytes")
+      .def_readonly("variables", &Stream::MemoryFootprint::variables, "Memory used by the metadata of each Variable")
+      .def_readonly("transactions", &Stream::MemoryFootprint::transactions,
+                    "Memory used by the blocks of each transaction held in memory")
+      .def_readonly("transport", &Stream::MemoryFootprint::transport,
+                    "Memory used by each internal structure of the Transport")
+      .def_readonly("locations", &Stream::MemoryFootprint::locations, "Memory used by the table of locations")
+      .def_readonly("journal", &Stream::MemoryFootprint::journal, "Memory used by buffered text metadata")
+      .def_property_readonly("total", &Stream::MemoryFootprint::get_total, "Total memory used by the Stream");
+
   /* Class Variable */
-  py::class_<Variable, std::shared_ptr<Variable>>(
-      m, "Variable", "A Variable defines a data object that can be injected into or retrieved from a Stream")
-      .def_property_readonly("name", &Variable::get_name, "The name of the Variable (read-only)")
+  py::class_<Variable, std::shared_ptr<Variable>> variable(
+      m, "Variable", "A Variable defines a data object that can be injected into or retrieved from a Stream");
+  variable.def_property_readonly("name", &Variable::get_name, "The name of the Variable (read-only)")
       .def_property_readonly("shape", &Variable::get_shape, "The shape of the Variable (read-only)")
+      .def_property_readonly("kind", &Variable::get_kind,
+                             "How the blocks put by publishers are laid out in the Variable (read-only)")
+      .def_property_readonly("joined_dimension", &Variable::get_joined_dimension,
+                             "The dimension along which the arrays of a joined array are laid end to end (read-only)")
       .def_property_readonly("element_size", &Variable::get_element_size,
                              "The element size of the Variable (read-only)")
       .def_property_readonly("local_size", &Variable::get_local_size,
                              "The local size of the Variable for the current actor (read-only)")
       .def_property_readonly("global_size", &Variable::get_global_size, "The global size of the Variable (read-only)")
+      .def(
+          "set_shape", [](Variable& self, const std::vector<size_t>& shape) { self.set_shape(shape); },
+          py::arg("shape"), "Change the shape of the Variable for the next transactions")
+      .def(
+          "set_shape",
+          [](Variable& self, const std::vector<size_t>& shape, const std::vector<size_t>& start,
+             const std::vector<size_t>& count) { self.set_shape(shape, start, count); },
+          py::arg("shape"), py::arg("start"), py::arg("count"),
+          "Change the shape of the Variable and the region owned by this publisher for the next transactions")
+      .def("get_transaction_shape", &Variable::get_transaction_shape, py::arg("transaction_id"),
+           "Get the shape the Variable had in a given transaction")
+      .def_property_readonly("read_plan_cache_hits", &Variable::get_read_plan_cache_hits,
+                             "The number of get operations that reused the blocks of the previous transaction "
+                             "(read-only)")
+      .def_property_readonly("read_plan_cache_misses", &Variable::get_read_plan_cache_misses,
+                             "The number of get operations that searched the blocks to read (read-only)")
       .def(
           "set_transaction_selection",
           [](Variable& self, unsigned int transaction_id) { self.set_transaction_selection(transaction_id); },
@@ -238,8 +331,45 @@ PYBIND11_MODULE(dtlmod, m)
           "set_transaction_selection",
           [](Variable& self, unsigned int begin, unsigned int count) { self.set_transaction_selection(begin, count); },
           py::arg("begin"), py::arg("count"), "Set the selection of transactions to consider for this Variable")
-      .def("set_selection", &Variable::set_selection, py::arg("start"), py::arg("count"),
-           "Set the selection of elements to consider for this Variable")
+      .def(
+          "set_selection",
+          [](Variable& self, const std::vector<size_t>& start, const std::vector<size_t>& count) {
+            self.set_selection(start, count);
+          },
+          py::arg("start"), py::arg("count"), "Set the selection of elements to consider for this Variable")
+      .def(
+          "set_selection",
+          [](Variable& self, const std::vector<size_t>& start, const std::vector<size_t>& count,
+             const std::vector<size_t>& stride) { self.set_selection(start, count, stride); },
+          py::arg("start"), py::arg("count"), py::arg("stride"),
+          "Set a selection of every stride-th element to consider for this Variable")
+      .def(
+          "set_selection",
+          [](Variable& self, const std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>>& regions) {
+            self.set_selection(regions);
+          },
+          py::arg("regions"), "Set several disjoint (start, count) regions of elements to consider for this Variable")
+      .def("set_value_selection", &Variable::set_value_selection, py::arg("min"), py::arg("max"),
+           "Only get the blocks of this Variable that may hold values in [min, max]")
+      .def("unset_value_selection", &Variable::unset_value_selection,
+           "Get the blocks of this Variable whatever the values they hold")
+      .def(
+          "set_block_selection", [](Variable& self, size_t block_id) { self.set_block_selection(block_id); },
+          py::arg("block_id"), "Only get one of the blocks of this Variable, designated by its id")
+      .def(
+          "set_block_selection",
+          [](Variable& self, size_t begin, size_t count) { self.set_block_selection(begin, count); },
+          py::arg("begin"), py::arg("count"), "Only get a range of consecutive blocks of this Variable")
+      .def("unset_block_selection", &Variable::unset_block_selection,
+           "Get the blocks of this Variable that intersect the selection again")
+      .def("set_publisher_selection", &Variable::set_publisher_selection, py::arg("rank"),
+           "Only get the blocks of this Variable put by the publisher of a given rank")
+      .def("unset_publisher_selection", &Variable::unset_publisher_selection,
+           "Get the blocks of this Variable put by all the publishers again")
+      .def("set_value_range", &Variable::set_value_range, py::arg("min"), py::arg("max"),
+           "Attach the range of the values of the published block to the next put operation")
+      .def("set_value_model", &Variable::set_value_model, py::arg("model"),
+           "Compute the range of the values of published blocks with model(transaction_id, start, count)")
       .def("set_reduction_operation", &Variable::set_reduction_operation, py::arg("method"), py::arg("parameters"),
            "Set a reduction operation on this Variable with the given method and parameters")
       .def_property_readonly("is_reduced", &Variable::is_reduced,
@@ -251,6 +381,11 @@ PYBIND11_MODULE(dtlmod, m)
       .def_property_readonly("reduction_method", &Variable::get_reduction_method,
                              "The reduction method applied to this Variable, or None (read-only)");
 
+  py::enum_<Variable::Kind>(variable, "Kind", "How the blocks put by publishers are laid out in a Variable")
+      .value("GlobalArray", Variable::Kind::GlobalArray)
+      .value("LocalArray", Variable::Kind::LocalArray)
+      .value("JoinedArray", Variable::Kind::JoinedArray);
+
   /* Class ReductionMethod */
   py::class_<ReductionMethod, std::shared_ptr<ReductionMethod>>(m, "ReductionMethod",
                                                                 "A reduction method applied to Variables in a Stream")
@@ -75,6 +75,19 @@ TEST_F(DTLConfigTest, ConfigFile)
       ASSERT_EQ(stream->get_access_mode(), dtlmod::Stream::Mode::Publish);
       XBT_INFO("Check if this stream is set to export metadata (it is)");
       ASSERT_TRUE(stream->does_export_metadata());
+      XBT_INFO("Check that metadata is exported in the binary format");
+      ASSERT_EQ(stream->get_metadata_export_format(), dtlmod::Stream::MetadataFormat::Binary);
+      ASSERT_TRUE(strcmp(stream->get_metadata_export_format_str(), "MetadataFormat::Binary") == 0);
+      XBT_INFO("Check that the metadata of this stream is bounded to 1 MiB");
+      ASSERT_EQ(stream->get_metadata_memory_budget(), 1048576U);
+      XBT_INFO("Check that the I/O operations on the metadata of this stream are simulated");
+      ASSERT_TRUE(stream->does_simulate_metadata_io());
+      XBT_INFO("Check that the metadata of this stream is aggregated along a 4-ary tree");
+      ASSERT_EQ(stream->get_metadata_aggregation_arity(), 4U);
+      XBT_INFO("Check that the I/O operations of the subscribers of this stream transfer at least 4kiB");
+      ASSERT_EQ(stream->get_min_io_size(), 4096U);
+      XBT_INFO("Check that the puts of the publishers of this stream are buffered in 16MiB");
+      ASSERT_EQ(stream->get_put_buffer_capacity(), 16777216U);
       XBT_INFO("Change the metadata export setting and check again");
       ASSERT_NO_THROW(stream->unset_metadata_export());
       ASSERT_FALSE(stream->does_export_metadata());
@@ -93,6 +106,8 @@ TEST_F(DTLConfigTest, ConfigFile)
                stream->get_transport_method_str().value_or("Unknown"));
       ASSERT_TRUE(strcmp(stream->get_engine_type_str().value(), "Engine::Type::Staging") == 0);
       ASSERT_TRUE(strcmp(stream->get_transport_method_str().value(), "Transport::Method::MQ") == 0);
+      XBT_INFO("Check that the publishers of this stream can be 2 transactions ahead of its subscribers");
+      ASSERT_EQ(stream->get_staging_queue_depth(), 2U);
       ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
       XBT_INFO("Close the engine");
       ASSERT_NO_THROW(engine->close());
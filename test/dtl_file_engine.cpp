@@ -5,8 +5,11 @@
 
 #include <gtest/gtest.h>
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <string>
 
 #include <fsmod/FileSystem.hpp>
@@ -21,6 +24,7 @@
 #include "./test_util.hpp"
 #include "dtlmod/DTL.hpp"
 #include "dtlmod/DTLException.hpp"
+#include "dtlmod/MetadataReader.hpp"
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(dtlmod_test_file_engine, "Logging category for this dtlmod test");
 
@@ -290,6 +294,48 @@ TEST_F(DTLFileEngineTest, MultiplePubSingleSubSharedStorage)
   });
 }
 
+TEST_F(DTLFileEngineTest, MetadataAggregation)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    for (long unsigned int i = 0; i < 4; i++) {
+      auto* host = sg4::Host::by_name("node-" + std::to_string(i));
+      host->add_actor(host->get_name() + "_pub", [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        auto var    = stream->define_variable("var", {20000, 20000}, {0, 5000 * i}, {20000, 5000}, sizeof(double));
+        auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+
+        XBT_INFO("Without aggregation, metadata reaches the stream for free");
+        ASSERT_EQ(stream->get_metadata_aggregation_arity(), 0U);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        auto start = sg4::Engine::get_clock();
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_DOUBLE_EQ(sg4::Engine::get_clock(), start);
+
+        XBT_INFO("Gather metadata along a binary tree: ending a transaction now takes time");
+        stream->set_metadata_aggregation(2);
+        ASSERT_EQ(stream->get_metadata_aggregation_arity(), 2U);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        start = sg4::Engine::get_clock();
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_GT(sg4::Engine::get_clock(), start);
+
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
 TEST_F(DTLFileEngineTest, SinglePubMultipleSubSharedStorage)
 {
   DO_TEST_WITH_FORK([this]() {
@@ -414,7 +460,7 @@ TEST_F(DTLFileEngineTest, SetTransactionSelection)
   });
 }
 
-TEST_F(DTLFileEngineTest, MetadataExport)
+TEST_F(DTLFileEngineTest, ReadPlanCache)
 {
   DO_TEST_WITH_FORK([this]() {
     this->setup_platform();
@@ -423,52 +469,1052 @@ TEST_F(DTLFileEngineTest, MetadataExport)
       auto stream = dtl->add_stream("my-output");
       stream->set_transport_method(dtlmod::Transport::Method::File);
       stream->set_engine_type(dtlmod::Engine::Type::File);
-      XBT_INFO("Set metadata export for that stream");
-      stream->set_metadata_export();
-      XBT_INFO("Create a 2D-array variable with 20kx20k double");
+      XBT_INFO("Publish a 2D-array variable with 20kx20k double in 5 transactions, always with the same layout");
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (int i = 0; i < 5; i++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+
+      ASSERT_NO_THROW(sg4::this_actor::sleep_until(10));
+      dtl    = dtlmod::DTL::connect();
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_NO_THROW(var_sub->set_selection({0, 0}, {10000, 20000}));
+      XBT_INFO("Read the first 3 transactions with the same selection: only the first one searches the blocks");
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(var_sub->set_transaction_selection(t));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      ASSERT_EQ(var_sub->get_read_plan_cache_misses(), 1U);
+      ASSERT_EQ(var_sub->get_read_plan_cache_hits(), 2U);
+      XBT_INFO("Changing the selection invalidates the read plan");
+      ASSERT_NO_THROW(var_sub->set_selection({10000, 0}, {10000, 20000}));
+      ASSERT_NO_THROW(var_sub->set_transaction_selection(4));
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_EQ(var_sub->get_read_plan_cache_misses(), 2U);
+      ASSERT_EQ(var_sub->get_read_plan_cache_hits(), 2U);
+      ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 10000 * 20000);
+      XBT_INFO("Read the 4 transactions at once: they share their layout, so only the first one looks for a plan");
+      ASSERT_NO_THROW(var_sub->set_transaction_selection(1, 4));
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_EQ(var_sub->get_read_plan_cache_misses(), 2U);
+      ASSERT_EQ(var_sub->get_read_plan_cache_hits(), 3U);
+      ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 4 * 8. * 10000 * 20000);
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, ContiguityAwareReads)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      XBT_INFO("Publish a 2D-array variable with 20kx20k double in a single block, in 2 transactions");
       auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
       auto engine =
           stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
-      XBT_INFO("Stream '%s' (Engine '%s') is ready for Publish data into the DTL", stream->get_cname(),
-               engine->get_cname());
       for (int i = 0; i < 2; i++) {
-        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
-        XBT_INFO("Start a Transaction");
         ASSERT_NO_THROW(engine->begin_transaction());
-        XBT_INFO("Put Variable 'var' into the DTL");
         ASSERT_NO_THROW(engine->put(var));
-        XBT_INFO("End a Transaction");
         ASSERT_NO_THROW(engine->end_transaction());
       }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
 
-      XBT_INFO("Close the engine");
+      ASSERT_NO_THROW(sg4::this_actor::sleep_until(10));
+      dtl = dtlmod::DTL::connect();
+      ASSERT_EQ(stream->get_min_io_size(), 0U);
+      stream->set_min_io_size(4096);
+      ASSERT_EQ(stream->get_min_io_size(), 4096U);
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+
+      XBT_INFO("Check that a slab of 100 rows is a single run, and a slab of 100 columns one run per row");
+      std::vector<size_t> num_operations;
+      auto sizes = var_sub->get_sizes_to_get_per_block(1, {0, 0}, {100, 20000}, std::nullopt, {}, &num_operations);
+      ASSERT_EQ(sizes[0].second, 8U * 100 * 20000);
+      sizes = var_sub->get_sizes_to_get_per_block(1, {0, 0}, {20000, 100}, std::nullopt, {}, &num_operations);
+      ASSERT_EQ(sizes[0].second, 8U * 20000 * 100);
+      ASSERT_EQ(num_operations, (std::vector<size_t>{1, 20000}));
+      XBT_INFO("Check that a stride along the rows splits a row slab into one run per element");
+      num_operations.clear();
+      sizes = var_sub->get_sizes_to_get_per_block(1, {0, 0}, {100, 20000}, std::nullopt, {1, 2}, &num_operations);
+      ASSERT_EQ(num_operations, (std::vector<size_t>{100 * 10000}));
+
+      XBT_INFO("Check that reading the column slab takes longer than reading the row slab of the same size");
+      ASSERT_NO_THROW(var_sub->set_selection({0, 0}, {100, 20000}));
+      auto begin = sg4::Engine::get_clock();
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      auto row_slab_time = sg4::Engine::get_clock() - begin;
+      ASSERT_NO_THROW(var_sub->set_selection({0, 0}, {20000, 100}));
+      begin = sg4::Engine::get_clock();
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_GT(sg4::Engine::get_clock() - begin, row_slab_time);
       ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
 
-      XBT_INFO("Get the name of the metadata file");
-      auto metadata_file_name = stream->get_metadata_file_name();
-      XBT_INFO("Check the contents of '%s'", metadata_file_name.c_str());
-      std::ifstream file(metadata_file_name);
-      ASSERT_TRUE(file.is_open());
-      std::string file_contents((std::istreambuf_iterator<char>(file)),
-                                 std::istreambuf_iterator<char>());
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
 
-      file.close();
-      const std::string& expected_contents =
-        "8\tvar\t2*{20000,20000}\n"
-        "  Transaction 1:\n"
-        "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n"
-        "  Transaction 2:\n"
-        "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n";
+TEST_F(DTLFileEngineTest, BufferedPuts)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl = dtlmod::DTL::connect();
+      // Put a 2D-array variable with 20kx20k double, compute for a second, end the transaction and wait for the data
+      // to be written. Return how long it took.
+      auto publish = [&dtl](const std::string& name, size_t put_buffer_capacity, bool perform_puts) {
+        auto stream = dtl->add_stream(name);
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        stream->set_put_buffer_capacity(put_buffer_capacity);
+        auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+        auto engine =
+            stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/" + name, dtlmod::Stream::Mode::Publish);
+        auto begin = sg4::Engine::get_clock();
+        engine->begin_transaction();
+        engine->put(var);
+        if (perform_puts)
+          engine->perform_puts();
+        sg4::this_actor::sleep_for(1);
+        engine->end_transaction();
+        engine->close();
+        return sg4::Engine::get_clock() - begin;
+      };
+
+      XBT_INFO("Without a buffer, the variable is only written at the end of the transaction");
+      double unbuffered_time = 0;
+      ASSERT_NO_THROW(unbuffered_time = publish("unbuffered", 0, false));
+      XBT_INFO("A buffer the size of the variable is full after the put, and written while computing");
+      double buffered_time = 0;
+      ASSERT_NO_THROW(buffered_time = publish("buffered", 8UL * 20000 * 20000, false));
+      ASSERT_LT(buffered_time, unbuffered_time);
+      XBT_INFO("A buffer twice as large waits for the end of the transaction");
+      double large_buffer_time = 0;
+      ASSERT_NO_THROW(large_buffer_time = publish("large-buffer", 2 * 8UL * 20000 * 20000, false));
+      ASSERT_DOUBLE_EQ(large_buffer_time, unbuffered_time);
+      XBT_INFO("Performing the puts explicitly writes the buffer before it is full");
+      double performed_time = 0;
+      ASSERT_NO_THROW(performed_time = publish("performed", 2 * 8UL * 20000 * 20000, true));
+      ASSERT_DOUBLE_EQ(performed_time, buffered_time);
+      dtlmod::DTL::disconnect();
+    });
 
-      ASSERT_EQ(file_contents, expected_contents);
-      std::remove(metadata_file_name.c_str());
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
 
-      XBT_INFO("Disconnect the actor");
+TEST_F(DTLFileEngineTest, PutAggregation)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    // The writes of the put buffer are the only Io activities of this scenario
+    std::vector<sg_size_t> write_sizes;
+    sg4::Io::on_completion_cb([&write_sizes](sg4::Io const& io) { write_sizes.push_back(io.get_performed_ioops()); });
+
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this, &write_sizes]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      XBT_INFO("Buffer three 8MB variables before writing them");
+      const sg_size_t var_size = 8UL * 1000 * 1000;
+      stream->set_put_buffer_capacity(3 * var_size);
+      std::vector<std::shared_ptr<dtlmod::Variable>> vars;
+      for (int i = 0; i < 4; i++)
+        vars.push_back(
+            stream->define_variable("var" + std::to_string(i), {1000, 1000}, {0, 0}, {1000, 1000}, sizeof(double)));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+
+      ASSERT_NO_THROW(engine->begin_transaction());
+      XBT_INFO("Two puts below the capacity are not written yet");
+      ASSERT_NO_THROW(engine->put(vars[0]));
+      ASSERT_NO_THROW(engine->put(vars[1]));
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+      ASSERT_TRUE(write_sizes.empty());
+      XBT_INFO("The third put fills the buffer, which is written in a single write before the end of the transaction");
+      ASSERT_NO_THROW(engine->put(vars[2]));
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+      ASSERT_EQ(write_sizes, std::vector<sg_size_t>{3 * var_size});
+      XBT_INFO("The end of the transaction writes what remains in the buffer");
+      ASSERT_NO_THROW(engine->put(vars[3]));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_NO_THROW(engine->close());
+      ASSERT_EQ(write_sizes, (std::vector<sg_size_t>{3 * var_size, var_size}));
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, ValueSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      XBT_INFO("Values of transaction t are in [10*t, 10*t+5] according to the model of the variable");
+      var->set_value_model([](unsigned int transaction_id, const std::vector<size_t>&, const std::vector<size_t>&) {
+        return dtlmod::ValueRange(10. * transaction_id, 10. * transaction_id + 5);
+      });
+      ASSERT_THROW(var->set_value_range(1, 0), dtlmod::InvalidValueRangeException);
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (unsigned int t = 1; t <= 3; t++) {
+        if (t == 3) {
+          XBT_INFO("The publisher gives the range of the values of the last transaction itself");
+          ASSERT_NO_THROW(var->set_value_range(0, 1));
+        }
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+
+      ASSERT_NO_THROW(sg4::this_actor::sleep_until(10));
+      dtl    = dtlmod::DTL::connect();
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_THROW(var_sub->set_value_selection(18, 12), dtlmod::InvalidValueRangeException);
+      XBT_INFO("Only get values in [12, 18]: only the block of transaction 1 may hold some");
+      ASSERT_NO_THROW(var_sub->set_value_selection(12, 18));
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(var_sub->set_transaction_selection(t));
+        auto start = sg4::Engine::get_clock();
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+        if (t == 1)
+          ASSERT_GT(sg4::Engine::get_clock(), start);
+        else
+          ASSERT_DOUBLE_EQ(sg4::Engine::get_clock(), start);
+      }
+      XBT_INFO("Without a value selection, the block of transaction 3 is read again");
+      ASSERT_NO_THROW(var_sub->unset_value_selection());
+      auto start = sg4::Engine::get_clock();
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_GT(sg4::Engine::get_clock(), start);
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, BlockSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("node-0"), sg4::Host::by_name("node-1")};
+    auto* sub_host                    = sg4::Host::by_name("node-2");
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor(pub_hosts[i]->get_name() + "_pub", [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        XBT_INFO("Create a 2D-array variable with 20kx20k double, each publisher owns one half (along 2nd dimension)");
+        auto var    = stream->define_variable("var", {20000, 20000}, {0, 10000 * i}, {20000, 10000}, sizeof(double));
+        auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sub_host->add_actor("node-2_sub", [this]() {
+      auto dtl = dtlmod::DTL::connect();
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(50));
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_THROW(var_sub->set_block_selection(0, 0), dtlmod::InvalidBlockSelectionException);
+      ASSERT_NO_THROW(var_sub->set_transaction_selection(1));
+
+      XBT_INFO("Only 2 blocks were published, block 2 does not exist");
+      ASSERT_NO_THROW(var_sub->set_block_selection(2));
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_THROW(engine->get(var_sub), dtlmod::InvalidBlockSelectionException);
+      XBT_INFO("Get the block written by the second publisher only");
+      ASSERT_NO_THROW(var_sub->set_block_selection(1));
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 20000 * 10000);
+      ASSERT_EQ(var_sub->get_local_start_and_count(sg4::Actor::self()).first, (std::vector<size_t>{0, 10000}));
+
+      XBT_INFO("Get both blocks, i.e., the entire Variable");
+      ASSERT_NO_THROW(var_sub->set_block_selection(0, 2));
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 20000 * 20000);
+      ASSERT_NO_THROW(var_sub->unset_block_selection());
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, MultiRegionSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("node-0"), sg4::Host::by_name("node-1")};
+    auto* sub_host                    = sg4::Host::by_name("node-2");
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor(pub_hosts[i]->get_name() + "_pub", [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        XBT_INFO("Create a 2D-array variable with 20kx20k double, each publisher owns one half (along 2nd dimension)");
+        auto var    = stream->define_variable("var", {20000, 20000}, {0, 10000 * i}, {20000, 10000}, sizeof(double));
+        auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sub_host->add_actor("node-2_sub", [this]() {
+      auto dtl = dtlmod::DTL::connect();
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(50));
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      auto self    = sg4::Actor::self();
+      ASSERT_THROW(var_sub->set_selection(std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>>()),
+                   dtlmod::InvalidSelectionException);
+      ASSERT_THROW(var_sub->set_selection({{{0}, {10}}}), dtlmod::InvalidSelectionException);
+      XBT_INFO("Check that regions out of the Variable or overlapping each other are rejected");
+      ASSERT_THROW(var_sub->set_selection({{{0, 19950}, {20000, 100}}}), dtlmod::InvalidSelectionException);
+      ASSERT_THROW(var_sub->set_selection({{{0, 0}, {20000, 100}}, {{10000, 50}, {10, 10}}}),
+                   dtlmod::InvalidSelectionException);
+      ASSERT_NO_THROW(var_sub->set_selection({{{0, 0}, {20000, 100}}, {{0, 100}, {20000, 100}}}));
+
+      XBT_INFO("Select the two boundary slabs of the Variable and a probe, one slab per publisher");
+      ASSERT_NO_THROW(var_sub->set_selection(
+          {{{0, 0}, {20000, 100}}, {{0, 19900}, {20000, 100}}, {{10000, 15000}, {10, 10}}}));
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      XBT_INFO("Check that the local size only counts the selected regions, not their bounding box");
+      ASSERT_EQ(var_sub->get_local_size(), 8U * (2 * 20000 * 100 + 10 * 10));
+
+      XBT_INFO("Check that each publisher is read once, for all the regions it holds");
+      auto sizes = var_sub->get_sizes_to_get_for_regions(1, var_sub->get_subscriber_selection_regions(self));
+      ASSERT_EQ(sizes.size(), 2U);
+      ASSERT_EQ(sizes[0].second, 8U * 20000 * 100);
+      ASSERT_EQ(sizes[1].second, 8U * (20000 * 100 + 10 * 10));
+
+      XBT_INFO("Check that a single region selection replaces the regions");
+      ASSERT_NO_THROW(var_sub->set_selection({0, 0}, {20000, 100}));
+      ASSERT_TRUE(var_sub->get_subscriber_selection_regions(self).empty());
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, LocalAndJoinedArrays)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("node-0"), sg4::Host::by_name("node-1")};
+    auto* sub_host                    = sg4::Host::by_name("node-2");
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor(pub_hosts[i]->get_name() + "_pub", [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        ASSERT_THROW(stream->define_joined_array("bogus", {100, 10}, 2, sizeof(double)),
+                     dtlmod::InconsistentVariableDefinitionException);
+        XBT_INFO("Create a local array and a joined array, the second publisher owning twice as many elements");
+        auto particles = stream->define_local_array("particles", {1000 * (i + 1)}, sizeof(double));
+        auto joined    = stream->define_joined_array("joined", {100 * (i + 1), 10}, 0, sizeof(double));
+        ASSERT_EQ(particles->get_kind(), dtlmod::Variable::Kind::LocalArray);
+        ASSERT_EQ(joined->get_kind(), dtlmod::Variable::Kind::JoinedArray);
+        ASSERT_THROW(stream->define_joined_array("joined", {100, 10}, 1, sizeof(double)),
+                     dtlmod::MultipleVariableDefinitionException);
+        auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(particles));
+        ASSERT_NO_THROW(engine->put(joined));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sub_host->add_actor("node-2_sub", [this]() {
+      auto dtl = dtlmod::DTL::connect();
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(50));
+      auto stream    = dtl->add_stream("my-output");
+      auto engine    = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto particles = stream->inquire_variable("particles");
+      auto joined    = stream->inquire_variable("joined");
+      auto self      = sg4::Actor::self();
+      ASSERT_EQ(particles->get_kind(), dtlmod::Variable::Kind::LocalArray);
+      ASSERT_THROW(particles->set_selection({0}, {10}), dtlmod::InvalidSelectionException);
+
+      XBT_INFO("Get both arrays whole: all their blocks are read, in the order of the ranks of their publishers");
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(particles));
+      ASSERT_NO_THROW(engine->get(joined));
+      ASSERT_NO_THROW(engine->end_transaction());
+      auto sizes = particles->get_sizes_to_get_for_blocks(1, 0, particles->get_num_blocks(1));
+      ASSERT_EQ(sizes.size(), 2U);
+      ASSERT_EQ(sizes[0].second, 8U * 1000);
+      ASSERT_EQ(sizes[1].second, 8U * 2000);
+
+      XBT_INFO("Check that the extent of the joined array is the sum of the counts of its publishers");
+      ASSERT_EQ(joined->get_transaction_shape(1), (std::vector<size_t>{300, 10}));
+      ASSERT_EQ(joined->get_local_start_and_count(self).second, (std::vector<size_t>{300, 10}));
+      ASSERT_EQ(joined->get_bounding_box_of_blocks(1, 1, 1).first, (std::vector<size_t>{100, 0}));
+
+      XBT_INFO("Check that the array put by the second publisher is its block");
+      ASSERT_EQ(particles->get_bounding_box_of_blocks(1, 1, 1).second, (std::vector<size_t>{2000}));
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, MetadataIOSimulation)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      XBT_INFO("Simulate the I/O operations on the metadata of that stream");
+      stream->set_metadata_io_simulation();
+      ASSERT_TRUE(stream->does_simulate_metadata_io());
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+
+      XBT_INFO("Each transaction appended a 64-byte record (24 + 1 block of 2 dimensions) to the index file");
+      auto file_system =
+          sgfs::FileSystem::get_file_systems_by_netzone(sg4::Engine::get_instance()->netzone_by_name_or_null("cluster"))
+              .at("my_fs");
+      ASSERT_EQ(file_system->file_size("/node-0/scratch/my-working-dir/my-output/md.idx"), 3U * 64);
+
+      XBT_INFO("Become a Subscriber: beginning a transaction now reads its index record");
+      ASSERT_NO_THROW(sg4::this_actor::sleep_until(10));
+      dtl    = dtlmod::DTL::connect();
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      auto start   = sg4::Engine::get_clock();
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_GT(sg4::Engine::get_clock(), start);
+      XBT_INFO("Getting the current transaction only does not read the index again");
+      start = sg4::Engine::get_clock();
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_DOUBLE_EQ(sg4::Engine::get_clock(), start);
+      XBT_INFO("Getting all the transactions reads the records of the other two");
+      var_sub->set_transaction_selection(1, 3);
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_GT(sg4::Engine::get_clock(), start);
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, MetadataExport)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      XBT_INFO("Set metadata export for that stream");
+      stream->set_metadata_export();
+      XBT_INFO("Create a 2D-array variable with 20kx20k double");
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      XBT_INFO("Stream '%s' (Engine '%s') is ready for Publish data into the DTL", stream->get_cname(),
+               engine->get_cname());
+      for (int i = 0; i < 2; i++) {
+        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+        XBT_INFO("Start a Transaction");
+        ASSERT_NO_THROW(engine->begin_transaction());
+        XBT_INFO("Put Variable 'var' into the DTL");
+        ASSERT_NO_THROW(engine->put(var));
+        XBT_INFO("End a Transaction");
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+
+      XBT_INFO("Close the engine");
+      ASSERT_NO_THROW(engine->close());
+
+      XBT_INFO("Get the name of the metadata file");
+      auto metadata_file_name = stream->get_metadata_file_name();
+      XBT_INFO("Check the contents of '%s'", metadata_file_name.c_str());
+      std::ifstream file(metadata_file_name);
+      ASSERT_TRUE(file.is_open());
+      std::string file_contents((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+
+      file.close();
+      const std::string& expected_contents =
+        "8\tvar\t2*{20000,20000}\n"
+        "  Transaction 1:\n"
+        "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n"
+        "  Transaction 2:\n"
+        "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n";
+
+      ASSERT_EQ(file_contents, expected_contents);
+      std::remove(metadata_file_name.c_str());
+
+      XBT_INFO("Disconnect the actor");
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, MetadataMemoryBudget)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      stream->set_metadata_export();
+      XBT_INFO("Bound the metadata of the stream to 1 byte, so that every transaction but the newest leaves memory");
+      stream->set_metadata_memory_budget(1);
+      ASSERT_EQ(stream->get_metadata_memory_budget(), 1U);
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+        XBT_INFO("Transaction %u stays in memory, the previous ones have been moved to the spill store", t);
+        ASSERT_EQ(var->get_metadata()->get_resident_transaction_ids(), std::vector<unsigned int>{t});
+        ASSERT_EQ(var->get_metadata()->get_num_spilled_transactions(), t - 1);
+        ASSERT_EQ(var->get_metadata()->get_current_transaction(), t);
+      }
+      ASSERT_TRUE(std::ifstream(stream->get_metadata_file_name() + ".spill").good());
+
+      XBT_INFO("Close the engine, spilled transactions must be exported");
+      ASSERT_NO_THROW(engine->close());
+      auto metadata_file_name = stream->get_metadata_file_name();
+      std::ifstream file(metadata_file_name);
+      ASSERT_TRUE(file.is_open());
+      std::string file_contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      file.close();
+      const std::string expected_contents = "8\tvar\t3*{20000,20000}\n"
+                                            "  Transaction 1:\n"
+                                            "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n"
+                                            "  Transaction 2:\n"
+                                            "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n"
+                                            "  Transaction 3:\n"
+                                            "    /node-0/scratch/my-working-dir/my-output/data.0: [0:20000, 0:20000]\n";
+      ASSERT_EQ(file_contents, expected_contents);
+      std::remove(metadata_file_name.c_str());
+      ASSERT_EQ(var->get_metadata()->get_resident_transaction_ids(), std::vector<unsigned int>{3});
+      dtlmod::DTL::disconnect();
+
+      XBT_INFO("Become a Subscriber and read back the older transactions from the spill store");
+      dtl    = dtlmod::DTL::connect();
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_NO_THROW(var_sub->set_selection({10000, 0}, {10000, 20000}));
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(var_sub->set_transaction_selection(t));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 10000 * 20000);
+        XBT_INFO("Only transaction 3 is kept in memory once transaction %u is read", t);
+        ASSERT_EQ(var_sub->get_metadata()->get_resident_transaction_ids(), std::vector<unsigned int>{3});
+      }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, MetadataMemoryBudgetBelowFloor)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      stream->set_metadata_export();
+      stream->set_metadata_memory_budget(1);
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      const auto& metadata = var->get_metadata();
+      XBT_INFO("The metadata that cannot be spilled is larger than the budget, but nothing is left to spill");
+      ASSERT_GT(metadata->get_memory_footprint(), stream->get_metadata_memory_budget());
+      ASSERT_EQ(metadata->get_spillable_footprint(), 0U);
+      ASSERT_EQ(metadata->get_resident_transaction_ids(), std::vector<unsigned int>{3});
+      ASSERT_EQ(metadata->get_num_spilled_transactions(), 2U);
+      auto spill_file_size = [&stream]() {
+        std::ifstream file(stream->get_metadata_file_name() + ".spill", std::ios::ate | std::ios::binary);
+        return static_cast<std::streamoff>(file.tellg());
+      };
+      auto spilled_bytes = spill_file_size();
+      ASSERT_GT(spilled_bytes, 0);
+      ASSERT_NO_THROW(engine->close());
+      std::remove(stream->get_metadata_file_name().c_str());
+      dtlmod::DTL::disconnect();
+
+      XBT_INFO("Read the newest transaction, then an older one, twice: nothing is written to the spill store again");
+      dtl    = dtlmod::DTL::connect();
+      engine = stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_NO_THROW(var_sub->set_selection({10000, 0}, {10000, 20000}));
+      for (unsigned int t : {3U, 1U, 3U, 1U}) {
+        ASSERT_NO_THROW(var_sub->set_transaction_selection(t));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_EQ(metadata->get_resident_transaction_ids(), std::vector<unsigned int>{3});
+        ASSERT_EQ(metadata->get_num_spilled_transactions(), 2U);
+        ASSERT_EQ(spill_file_size(), spilled_bytes);
+      }
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, BinaryMetadataExport)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      XBT_INFO("Set binary metadata export for that stream");
+      stream->set_metadata_export().set_metadata_export_format(dtlmod::Stream::MetadataFormat::Binary);
+      ASSERT_EQ(stream->get_metadata_export_format(), dtlmod::Stream::MetadataFormat::Binary);
+      auto var = stream->define_variable("var", {20000, 20000}, {0, 0}, {20000, 20000}, sizeof(double));
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+      for (int i = 0; i < 2; i++) {
+        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      XBT_INFO("Close the engine");
+      ASSERT_NO_THROW(engine->close());
+
+      auto metadata_file_name = stream->get_metadata_file_name();
+      XBT_INFO("Check the contents of '%s' with a MetadataReader", metadata_file_name.c_str());
+      {
+        dtlmod::MetadataReader reader(metadata_file_name);
+        ASSERT_EQ(reader.get_num_variables(), 1U);
+        ASSERT_FALSE(reader.find_variable("unknown").has_value());
+        auto v = reader.find_variable("var");
+        ASSERT_TRUE(v.has_value());
+        ASSERT_EQ(reader.get_variable_name(*v), "var");
+        ASSERT_EQ(reader.get_element_size(*v), sizeof(double));
+        ASSERT_EQ(reader.get_shape(*v), std::vector<size_t>({20000, 20000}));
+        ASSERT_EQ(reader.get_transaction_ids(*v), std::vector<unsigned int>({1, 2}));
+        for (unsigned int id : {1U, 2U}) {
+          auto blocks = reader.get_blocks(*v, id);
+          ASSERT_TRUE(blocks.has_value());
+          ASSERT_EQ(blocks->num_blocks, 1U);
+          ASSERT_EQ(blocks->get_start(0)[0], 0U);
+          ASSERT_EQ(blocks->get_start(0)[1], 0U);
+          ASSERT_EQ(blocks->get_count(0)[0], 20000U);
+          ASSERT_EQ(blocks->get_count(0)[1], 20000U);
+          ASSERT_EQ(reader.get_location(blocks->get_location_id(0)),
+                    "/node-0/scratch/my-working-dir/my-output/data.0");
+        }
+        ASSERT_FALSE(reader.get_blocks(*v, 3).has_value());
+      }
+
+      XBT_INFO("Check that corrupted counts and string offsets are rejected, however large they are");
+      std::ifstream in(metadata_file_name, std::ios::binary);
+      std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      in.close();
+      dtlmod::binary_metadata::Header header;
+      std::memcpy(&header, contents.data(), sizeof(header));
+      auto corrupt = [&contents](uint64_t offset, uint64_t value) {
+        auto corrupted = contents;
+        std::memcpy(corrupted.data() + offset, &value, sizeof(value));
+        std::ofstream out("corrupted.bin", std::ios::binary);
+        out << corrupted;
+      };
+      corrupt(header.strings_offset, std::numeric_limits<uint64_t>::max());
+      ASSERT_THROW(dtlmod::MetadataReader("corrupted.bin"), dtlmod::InvalidMetadataFileException);
+      XBT_INFO("The offset of the end of the first string is after that of the second");
+      corrupt(header.strings_offset + 2 * sizeof(uint64_t), 1ULL << 32);
+      ASSERT_THROW(dtlmod::MetadataReader("corrupted.bin"), dtlmod::InvalidMetadataFileException);
+      corrupt(header.transactions_offset + offsetof(dtlmod::binary_metadata::TransactionRecord, num_blocks),
+              std::numeric_limits<uint64_t>::max() / 2 + 1);
+      {
+        dtlmod::MetadataReader reader("corrupted.bin");
+        ASSERT_THROW(reader.get_blocks(0, 1), dtlmod::InvalidMetadataFileException);
+      }
+      std::remove("corrupted.bin");
+      std::remove(metadata_file_name.c_str());
+
+      XBT_INFO("Check that a text file is not accepted by the reader");
+      ASSERT_THROW(dtlmod::MetadataReader("./config_files/test/DTL-config.json"), dtlmod::InvalidMetadataFileException);
+
+      XBT_INFO("Disconnect the actor");
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLFileEngineTest, ImportBinaryMetadata)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("node-0"), sg4::Host::by_name("node-1")};
+    std::string metadata_file_name;
+    bool replay_done = false;
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor(pub_hosts[i]->get_name() + "_pub", [this, i, &metadata_file_name]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        stream->set_metadata_export().set_metadata_export_format(dtlmod::Stream::MetadataFormat::Binary);
+        auto var    = stream->define_variable("var", {20000, 20000}, {0, 10000 * i}, {20000, 10000}, sizeof(double));
+        auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        XBT_INFO("Publish 3 transactions");
+        for (int t = 0; t < 3; t++) {
+          ASSERT_NO_THROW(engine->begin_transaction());
+          ASSERT_NO_THROW(engine->put(var));
+          ASSERT_NO_THROW(engine->end_transaction());
+        }
+        XBT_INFO("Close the engine");
+        ASSERT_NO_THROW(engine->close());
+        metadata_file_name = stream->get_metadata_file_name();
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sg4::Host::by_name("node-2")->add_actor("node-2_sub", [this, &metadata_file_name, &replay_done]() {
+      XBT_INFO("Wait for the publishers to have exported the metadata");
+      while (metadata_file_name.empty())
+        sg4::this_actor::sleep_for(1);
+      sg4::this_actor::sleep_for(1);
+
+      XBT_INFO("Remove the files written by the publishers, the replay must recreate them");
+      auto* cluster = sg4::Engine::get_instance()->netzone_by_name_or_null("cluster");
+      auto fs       = sgfs::FileSystem::get_file_systems_by_netzone(cluster).at("my_fs");
+      for (const auto* file : {"/pfs/my-working-dir/my-output/data.0", "/pfs/my-working-dir/my-output/data.1"}) {
+        ASSERT_TRUE(fs->file_exists(file));
+        fs->unlink_file(file);
+      }
+
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("replay");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      stream->set_metadata_import(metadata_file_name);
+      ASSERT_TRUE(stream->does_import_metadata());
+      XBT_INFO("Imported metadata can only be read by subscribers");
+      ASSERT_THROW((void)stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish),
+                   dtlmod::InvalidMetadataImportException);
+      auto engine = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      ASSERT_EQ(stream->get_all_variables(), std::vector<std::string>({"var"}));
+      for (const auto* file : {"/pfs/my-working-dir/my-output/data.0", "/pfs/my-working-dir/my-output/data.1"})
+        ASSERT_EQ(fs->file_size(file), 3ULL * 8 * 20000 * 10000);
+
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_EQ(var_sub->get_shape(), std::vector<size_t>({20000, 20000}));
+      XBT_INFO("Only select the half of 'var' written by the second publisher");
+      var_sub->set_selection({0, 10000}, {20000, 10000});
+      for (unsigned int t = 1; t <= 3; t++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_EQ(var_sub->get_metadata()->get_current_transaction(), t);
+        auto start = sg4::Engine::get_clock();
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_GT(sg4::Engine::get_clock(), start);
+        ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 20000 * 10000);
+        XBT_INFO("The blocks of transaction %u are evicted once read", t);
+        ASSERT_EQ(var_sub->get_metadata()->get_num_layouts(), 0U);
+      }
+      XBT_INFO("There is no fourth transaction in the imported metadata");
+      ASSERT_THROW(engine->begin_transaction(), dtlmod::EndOfStreamException);
+
+      ASSERT_NO_THROW(engine->close());
+      std::remove(metadata_file_name.c_str());
+      dtlmod::DTL::disconnect();
+      replay_done = true;
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+    // Asserted here rather than in the actor, so that a replay stuck on a transaction fails the test
+    ASSERT_TRUE(replay_done);
+  });
+}
+
+TEST_F(DTLFileEngineTest, ImportLocalArray)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("node-0"), sg4::Host::by_name("node-1")};
+    std::string metadata_file_name;
+    bool replay_done = false;
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor(pub_hosts[i]->get_name() + "_pub", [this, &metadata_file_name]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        stream->set_metadata_export().set_metadata_export_format(dtlmod::Stream::MetadataFormat::Binary);
+        XBT_INFO("Both publishers put a local array of the same size, that starts at the origin");
+        auto particles = stream->define_local_array("particles", {1000}, sizeof(double));
+        auto engine    = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(particles));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_NO_THROW(engine->close());
+        metadata_file_name = stream->get_metadata_file_name();
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sg4::Host::by_name("node-2")->add_actor("node-2_sub", [this, &metadata_file_name, &replay_done]() {
+      while (metadata_file_name.empty())
+        sg4::this_actor::sleep_for(1);
+      sg4::this_actor::sleep_for(1);
+
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("replay");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      stream->set_metadata_import(metadata_file_name);
+      auto engine    = stream->open("cluster:my_fs:/pfs/my-working-dir/my-output", dtlmod::Stream::Mode::Subscribe);
+      auto particles = stream->inquire_variable("particles");
+      XBT_INFO("Check that the imported variable is still a local array");
+      ASSERT_EQ(particles->get_kind(), dtlmod::Variable::Kind::LocalArray);
+      ASSERT_THROW(particles->set_selection({0}, {10}), dtlmod::InvalidSelectionException);
+
+      XBT_INFO("Check that the blocks of the two publishers are both kept, in the order of their ranks");
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(particles));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_EQ(particles->get_num_blocks(1), 2U);
+      auto sizes = particles->get_sizes_to_get_for_blocks(1, 0, 2);
+      ASSERT_EQ(sizes.size(), 2U);
+      ASSERT_EQ(sizes[0].second, 8U * 1000);
+      ASSERT_EQ(sizes[1].second, 8U * 1000);
+      ASSERT_NE(sizes[0].first, sizes[1].first);
+
+      ASSERT_NO_THROW(engine->close());
+      std::remove(metadata_file_name.c_str());
+      dtlmod::DTL::disconnect();
+      replay_done = true;
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+    ASSERT_TRUE(replay_done);
+  });
+}
+
+TEST_F(DTLFileEngineTest, ExportAndImportShapeChanges)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::string metadata_file_name;
+    bool replay_done = false;
+
+    sg4::Host::by_name("node-0")->add_actor("TestActor", [this, &metadata_file_name]() {
+      auto dtl = dtlmod::DTL::connect();
+      for (auto format : {dtlmod::Stream::MetadataFormat::Text, dtlmod::Stream::MetadataFormat::Binary}) {
+        bool text   = format == dtlmod::Stream::MetadataFormat::Text;
+        auto stream = dtl->add_stream(text ? "text-output" : "binary-output");
+        stream->set_transport_method(dtlmod::Transport::Method::File);
+        stream->set_engine_type(dtlmod::Engine::Type::File);
+        stream->set_metadata_export().set_metadata_export_format(format);
+        auto var    = stream->define_variable("var", {100}, {0}, {100}, sizeof(double));
+        auto engine = stream->open(std::string("cluster:my_fs:/node-0/scratch/my-working-dir/") +
+                                       (text ? "text-output" : "binary-output"),
+                                   dtlmod::Stream::Mode::Publish);
+        for (int i = 0; i < 3; i++) {
+          if (i == 2) {
+            XBT_INFO("Shrink the Variable between transactions 2 and 3");
+            ASSERT_NO_THROW(var->set_shape({50}, {0}, {50}));
+          }
+          ASSERT_NO_THROW(engine->begin_transaction());
+          ASSERT_NO_THROW(engine->put(var));
+          ASSERT_NO_THROW(engine->end_transaction());
+        }
+        ASSERT_NO_THROW(engine->close());
+
+        if (text) {
+          XBT_INFO("Check that the text export gives the shape of the transactions in which it changed");
+          std::ifstream file(stream->get_metadata_file_name());
+          ASSERT_TRUE(file.is_open());
+          std::string file_contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+          file.close();
+          const std::string& expected_contents = "8\tvar\t3*{50}\n"
+                                                 "  Transaction 1: {100}\n"
+                                                 "    /node-0/scratch/my-working-dir/text-output/data.0: [0:100]\n"
+                                                 "  Transaction 2:\n"
+                                                 "    /node-0/scratch/my-working-dir/text-output/data.0: [0:100]\n"
+                                                 "  Transaction 3: {50}\n"
+                                                 "    /node-0/scratch/my-working-dir/text-output/data.0: [0:50]\n";
+          ASSERT_EQ(file_contents, expected_contents);
+          std::remove(stream->get_metadata_file_name().c_str());
+        } else {
+          metadata_file_name = stream->get_metadata_file_name();
+        }
+      }
+      dtlmod::DTL::disconnect();
+    });
+
+    sg4::Host::by_name("node-1")->add_actor("node-1_sub", [this, &metadata_file_name, &replay_done]() {
+      while (metadata_file_name.empty())
+        sg4::this_actor::sleep_for(1);
+      sg4::this_actor::sleep_for(1);
+
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("replay");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      stream->set_metadata_import(metadata_file_name);
+      auto engine =
+          stream->open("cluster:my_fs:/node-0/scratch/my-working-dir/binary-output", dtlmod::Stream::Mode::Subscribe);
+      auto var = stream->inquire_variable("var");
+      XBT_INFO("Check that each imported transaction keeps the shape it was put with");
+      ASSERT_EQ(var->get_shape(), std::vector<size_t>{50});
+      ASSERT_EQ(var->get_transaction_shape(1), std::vector<size_t>{100});
+      ASSERT_EQ(var->get_transaction_shape(2), std::vector<size_t>{100});
+      ASSERT_EQ(var->get_transaction_shape(3), std::vector<size_t>{50});
+
+      XBT_INFO("Get the first transaction as a whole: it has the shape it was put with");
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_DOUBLE_EQ(var->get_local_size(), 8. * 100);
+
+      ASSERT_NO_THROW(engine->close());
+      std::remove(metadata_file_name.c_str());
       dtlmod::DTL::disconnect();
+      replay_done = true;
     });
 
     // Run the simulation
     ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+    ASSERT_TRUE(replay_done);
   });
 }
 
@@ -501,7 +1547,7 @@ TEST_F(DTLFileEngineTest, MetadataExportProgressiveFlushing)
       ASSERT_NO_THROW(engine->end_transaction());
 
       // Sleep long enough for the subscriber to complete reading tx 1 before we close.
-      // write_transaction_to_stream is called during the subscriber's end_transaction() because
+      // write_transaction_to_journal is called during the subscriber's end_transaction() because
       // metadata_exported_ is still false while we sleep here.
       XBT_INFO("Sleep 100s to remain alive while subscriber reads Transaction 1");
       sg4::this_actor::sleep_for(100.0);
@@ -511,7 +1557,7 @@ TEST_F(DTLFileEngineTest, MetadataExportProgressiveFlushing)
       ASSERT_NO_THROW(engine->put(var));
       ASSERT_NO_THROW(engine->end_transaction());
 
-      XBT_INFO("Close the engine — triggers export_metadata_to_file, which reads the .prog file");
+      XBT_INFO("Close the engine — triggers export_metadata_to_file, which reads the journal");
       ASSERT_NO_THROW(engine->close());
       metadata_file_name = stream->get_metadata_file_name();
       XBT_INFO("Disconnect the actor");
@@ -526,16 +1572,18 @@ TEST_F(DTLFileEngineTest, MetadataExportProgressiveFlushing)
       auto var_sub = stream->inquire_variable("var");
 
       // Read tx 1 while publisher is sleeping (metadata_exported_=false):
-      // end_transaction() triggers flush_and_evict_transaction() → write_transaction_to_stream()
+      // end_transaction() triggers flush_and_evict_transaction() → write_transaction_to_journal()
       XBT_INFO("Read Transaction 1 while publisher is still alive");
       ASSERT_NO_THROW(engine->begin_transaction());
       ASSERT_NO_THROW(engine->get(var_sub));
       ASSERT_NO_THROW(engine->end_transaction());
 
-      // Directly verify that write_transaction_to_stream wrote tx 1 to the .prog file
-      std::string prog_file = stream->get_metadata_file_name() + ".var.prog";
-      XBT_INFO("Check that the .prog file '%s' exists", prog_file.c_str());
-      ASSERT_TRUE(std::ifstream(prog_file).good());
+      // The entries of tx 1 are small enough to stay buffered: the journal file is not created yet
+      std::string journal_file = stream->get_metadata_file_name() + ".journal";
+      XBT_INFO("Check that the journal file '%s' does not exist yet", journal_file.c_str());
+      ASSERT_FALSE(std::ifstream(journal_file).good());
+      // No per-variable file is created anymore
+      ASSERT_FALSE(std::ifstream(stream->get_metadata_file_name() + ".var.prog").good());
 
       // Read tx 2 (blocks until publisher wakes up and publishes it)
       XBT_INFO("Read Transaction 2");
@@ -553,7 +1601,7 @@ TEST_F(DTLFileEngineTest, MetadataExportProgressiveFlushing)
     ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
 
     // The final metadata file should contain both transactions:
-    //   - tx 1 was written progressively by write_transaction_to_stream to the .prog file
+    //   - tx 1 was written progressively by write_transaction_to_journal to the journal
     //   - tx 2 was held in memory and written by export_to_file at publisher close
     XBT_INFO("Check the contents of '%s'", metadata_file_name.c_str());
     std::ifstream file(metadata_file_name);
@@ -570,7 +1618,7 @@ TEST_F(DTLFileEngineTest, MetadataExportProgressiveFlushing)
     ASSERT_EQ(file_contents, expected_contents);
     std::remove(metadata_file_name.c_str());
 
-    // The .prog file must have been removed by export_metadata_to_file after merging
-    ASSERT_FALSE(std::ifstream(metadata_file_name + ".var.prog").good());
+    // No journal file must remain after the export
+    ASSERT_FALSE(std::ifstream(metadata_file_name + ".journal").good());
   });
 }
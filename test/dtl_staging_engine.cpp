@@ -4,6 +4,7 @@
  * under the terms of the license (GNU LGPL) which comes with this package. */
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
 #include <string>
@@ -250,6 +251,129 @@ TEST_F(DTLStagingEngineTest, MultiplePubSingleSubMailbox)
   });
 }
 
+TEST_F(DTLStagingEngineTest, PublisherSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("host-0.prod"), sg4::Host::by_name("host-1.prod")};
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor("Pub" + std::to_string(i), [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_engine_type(dtlmod::Engine::Type::Staging);
+        stream->set_transport_method(dtlmod::Transport::Method::Mailbox);
+        XBT_INFO("Publisher of rank %lu owns the %s half of the Variable (along 2nd dimension)", i,
+                 i == 0 ? "second" : "first");
+        auto var = stream->define_variable("var", {10000, 10000}, {0, 5000 * (1 - i)}, {10000, 5000}, sizeof(double));
+        // Open the Engine one after the other, so that the rank of each publisher is that of its actor
+        sg4::this_actor::sleep_for(.1 * i);
+        auto engine = stream->open("my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+
+        sg4::this_actor::sleep_for(1);
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sg4::Host::by_name("host-0.cons")->add_actor("Sub", [this]() {
+      auto dtl     = dtlmod::DTL::connect();
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+
+      ASSERT_NO_THROW(engine->begin_transaction());
+      XBT_INFO("Only 2 publishers put the Variable, there is no publisher of rank 2");
+      ASSERT_NO_THROW(var_sub->set_publisher_selection(2));
+      ASSERT_THROW(engine->get(var_sub), dtlmod::InvalidBlockSelectionException);
+      XBT_INFO("Block 0 starts first, but was put by the publisher of rank 1");
+      ASSERT_NO_THROW(var_sub->set_block_selection(0));
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_EQ(var_sub->get_local_start_and_count(sg4::Actor::self()).first, (std::vector<size_t>{0, 0}));
+      XBT_INFO("Get the block put by the publisher of rank 0, i.e., the second half of the Variable");
+      ASSERT_NO_THROW(var_sub->set_publisher_selection(0));
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 10000 * 5000);
+      ASSERT_EQ(var_sub->get_local_start_and_count(sg4::Actor::self()).first, (std::vector<size_t>{0, 5000}));
+      ASSERT_NO_THROW(var_sub->unset_publisher_selection());
+
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLStagingEngineTest, ValueSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("host-0.prod"), sg4::Host::by_name("host-1.prod")};
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor("Pub" + std::to_string(i), [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_engine_type(dtlmod::Engine::Type::Staging);
+        stream->set_transport_method(dtlmod::Transport::Method::Mailbox);
+        auto var    = stream->define_variable("var", {10000, 10000}, {0, 5000 * i}, {10000, 5000}, sizeof(double));
+        auto engine = stream->open("my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        for (unsigned int t = 1; t <= 2; t++) {
+          if (t == 1) {
+            XBT_INFO("Publisher %lu gives the range of the values of its first block only", i);
+            ASSERT_NO_THROW(var->set_value_range(20. * i, 20. * i + 10));
+          }
+          ASSERT_NO_THROW(engine->begin_transaction());
+          ASSERT_NO_THROW(engine->put(var));
+          ASSERT_NO_THROW(engine->end_transaction());
+        }
+        sg4::this_actor::sleep_for(1);
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    sg4::Host::by_name("host-0.cons")->add_actor("Sub", [this]() {
+      auto dtl     = dtlmod::DTL::connect();
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      auto self    = sg4::Actor::self();
+      XBT_INFO("Only get values in [0, 10]");
+      ASSERT_NO_THROW(var_sub->set_value_selection(0, 10));
+      for (unsigned int t = 1; t <= 2; t++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(engine->end_transaction());
+        auto sizes = var_sub->get_sizes_to_get_per_block(t, {0, 0}, {10000, 10000},
+                                                         var_sub->get_subscriber_value_selection(self));
+        if (t == 1) {
+          XBT_INFO("Only the block of the first publisher may hold such values in transaction 1");
+          ASSERT_EQ(sizes.size(), 1U);
+        } else {
+          XBT_INFO("Blocks without statistics are always read: the ranges of transaction 1 were not kept");
+          ASSERT_EQ(sizes.size(), 2U);
+        }
+        ASSERT_EQ(sizes[0].second, 8U * 10000 * 5000);
+      }
+
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
 TEST_F(DTLStagingEngineTest, MetadataExport)
 {
   DO_TEST_WITH_FORK([this]() {
@@ -330,3 +454,171 @@ TEST_F(DTLStagingEngineTest, MetadataExport)
     ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
   });
 }
+
+TEST_F(DTLStagingEngineTest, StagingQueue)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    auto* pub_host = sg4::Host::by_name("host-0.prod");
+    auto* sub_host = sg4::Host::by_name("host-0.cons");
+
+    pub_host->add_actor("PubTestActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_engine_type(dtlmod::Engine::Type::Staging);
+      stream->set_transport_method(dtlmod::Transport::Method::MQ);
+      XBT_INFO("Let publishers be 2 transactions ahead of the subscribers");
+      ASSERT_EQ(stream->get_staging_queue_depth(), 0U);
+      stream->set_staging_queue_depth(2);
+      ASSERT_EQ(stream->get_staging_queue_depth(), 2U);
+      auto var    = stream->define_variable("var", {1000, 1000}, {0, 0}, {1000, 1000}, sizeof(double));
+      auto engine = stream->open("my-output", dtlmod::Stream::Mode::Publish);
+
+      for (int i = 1; i <= 5; i++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+        XBT_INFO("Transaction %d completed", i);
+        if (i == 3) {
+          XBT_INFO("Check that the first 3 transactions were completed while the subscriber reads the first one");
+          ASSERT_LT(sg4::Engine::get_clock(), 1);
+        }
+      }
+      XBT_INFO("Close the engine once the subscriber has got all the staged transactions");
+      ASSERT_NO_THROW(engine->close());
+      ASSERT_GT(sg4::Engine::get_clock(), 4);
+      dtlmod::DTL::disconnect();
+    });
+
+    sub_host->add_actor("SubTestActor", [this]() {
+      auto dtl     = dtlmod::DTL::connect();
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      for (int i = 1; i <= 5; i++) {
+        XBT_INFO("Get and analyze transaction %d for a second", i);
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->get(var_sub));
+        ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+        ASSERT_NO_THROW(engine->end_transaction());
+        ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 1000 * 1000);
+      }
+
+      XBT_INFO("Check that up to 3 transactions were held in staging, and none is left");
+      unsigned int max_occupancy = 0;
+      for (const auto& [date, occupancy] : engine->get_staging_queue_history())
+        max_occupancy = std::max(max_occupancy, occupancy);
+      ASSERT_EQ(max_occupancy, 3U);
+      ASSERT_EQ(engine->get_staging_queue_occupancy(), 0U);
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLStagingEngineTest, SubscriberLeavesStagedTransactions)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    bool pub_closed = false;
+
+    sg4::Host::by_name("host-0.prod")->add_actor("PubTestActor", [this, &pub_closed]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("my-output");
+      stream->set_engine_type(dtlmod::Engine::Type::Staging);
+      stream->set_transport_method(dtlmod::Transport::Method::MQ);
+      stream->set_staging_queue_depth(2);
+      auto var    = stream->define_variable("var", {1000, 1000}, {0, 0}, {1000, 1000}, sizeof(double));
+      auto engine = stream->open("my-output", dtlmod::Stream::Mode::Publish);
+      XBT_INFO("Leave 3 transactions in staging while the subscriber reads the first one");
+      for (int i = 1; i <= 3; i++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      XBT_INFO("The subscriber leaves without getting the last 2: closing must not wait for them");
+      ASSERT_NO_THROW(engine->close());
+      pub_closed = true;
+      dtlmod::DTL::disconnect();
+    });
+
+    sg4::Host::by_name("host-0.cons")->add_actor("SubTestActor", [this]() {
+      auto dtl     = dtlmod::DTL::connect();
+      auto stream  = dtl->add_stream("my-output");
+      auto engine  = stream->open("my-output", dtlmod::Stream::Mode::Subscribe);
+      auto var_sub = stream->inquire_variable("var");
+      ASSERT_NO_THROW(engine->begin_transaction());
+      ASSERT_NO_THROW(engine->get(var_sub));
+      ASSERT_NO_THROW(sg4::this_actor::sleep_for(1));
+      ASSERT_NO_THROW(engine->end_transaction());
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+    ASSERT_TRUE(pub_closed);
+  });
+}
+
+TEST_F(DTLStagingEngineTest, StagedTransactionsWithSeveralSubscribers)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    std::vector<sg4::Host*> pub_hosts = {sg4::Host::by_name("host-0.prod"), sg4::Host::by_name("host-1.prod")};
+    std::vector<sg4::Host*> sub_hosts = {sg4::Host::by_name("host-0.cons"), sg4::Host::by_name("host-1.cons")};
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      pub_hosts[i]->add_actor("Pub" + std::to_string(i), [this, i]() {
+        auto dtl    = dtlmod::DTL::connect();
+        auto stream = dtl->add_stream("my-output");
+        stream->set_engine_type(dtlmod::Engine::Type::Staging);
+        stream->set_transport_method(dtlmod::Transport::Method::Mailbox);
+        stream->set_staging_queue_depth(2);
+        XBT_INFO("Each publisher owns half of the rows of the variable");
+        auto var    = stream->define_variable("var", {1000, 1000}, {500 * i, 0}, {500, 1000}, sizeof(double));
+        auto engine = stream->open("my-output", dtlmod::Stream::Mode::Publish);
+        sg4::this_actor::sleep_for(.5);
+        for (int t = 1; t <= 4; t++) {
+          ASSERT_NO_THROW(engine->begin_transaction());
+          ASSERT_NO_THROW(engine->put(var));
+          ASSERT_NO_THROW(engine->end_transaction());
+        }
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    for (long unsigned int i = 0; i < 2; i++) {
+      sub_hosts[i]->add_actor("Sub" + std::to_string(i), [this, i]() {
+        auto dtl     = dtlmod::DTL::connect();
+        auto stream  = dtl->add_stream("my-output");
+        auto engine  = stream->open("my-output", dtlmod::Stream::Mode::Subscribe);
+        auto var_sub = stream->inquire_variable("var");
+        for (long unsigned int t = 1; t <= 4; t++) {
+          XBT_INFO("Get the rows of publisher %lu in transaction %lu, while the next ones are staged", (i + t) % 2, t);
+          ASSERT_NO_THROW(var_sub->set_selection({500 * ((i + t) % 2), 0}, {500, 1000}));
+          ASSERT_NO_THROW(engine->begin_transaction());
+          ASSERT_NO_THROW(engine->get(var_sub));
+          ASSERT_NO_THROW(sg4::this_actor::sleep_for(1. + i));
+          ASSERT_NO_THROW(engine->end_transaction());
+          ASSERT_DOUBLE_EQ(var_sub->get_local_size(), 8. * 500 * 1000);
+        }
+
+        XBT_INFO("Check that several transactions were held in staging at once");
+        unsigned int max_occupancy = 0;
+        for (const auto& [date, occupancy] : engine->get_staging_queue_history())
+          max_occupancy = std::max(max_occupancy, occupancy);
+        ASSERT_GE(max_occupancy, 2U);
+        ASSERT_NO_THROW(engine->close());
+        dtlmod::DTL::disconnect();
+      });
+    }
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
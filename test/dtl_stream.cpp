@@ -164,6 +164,140 @@ TEST_F(DTLStreamTest, PublishFileStreamOpenClose)
   });
 }
 
+TEST_F(DTLStreamTest, MemoryFootprint)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    prod_host_->add_actor("TestProducerActor", [this]() {
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("Stream");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+      auto var    = stream->define_variable("var", {100, 100}, {0, 0}, {100, 100}, sizeof(double));
+      auto engine = stream->open("zone:fs:/pfs/file", dtlmod::Stream::Mode::Publish);
+
+      XBT_INFO("Before any transaction, only the Variable and the Transport use memory");
+      auto footprint = stream->get_memory_footprint();
+      ASSERT_EQ(footprint.variables.size(), 1U);
+      ASSERT_GT(footprint.variables.at("var"), 0U);
+      ASSERT_TRUE(footprint.transactions.empty());
+      ASSERT_EQ(footprint.transport.count("to_write_in_transaction"), 1U);
+      ASSERT_EQ(footprint.transport.count("to_read_in_transaction"), 1U);
+      auto empty_total = footprint.get_total();
+
+      XBT_INFO("Each transaction adds a block table to the metadata of the Variable");
+      for (unsigned int t = 1; t <= 2; t++) {
+        ASSERT_NO_THROW(engine->begin_transaction());
+        ASSERT_NO_THROW(engine->put(var));
+        ASSERT_NO_THROW(engine->end_transaction());
+      }
+      footprint = stream->get_memory_footprint();
+      ASSERT_EQ(footprint.transactions.size(), 2U);
+      XBT_INFO("Transaction 2 shares the layout of transaction 1 and is thus smaller");
+      ASSERT_LT(footprint.transactions.at(2), footprint.transactions.at(1));
+      ASSERT_GT(footprint.locations, 0U);
+      ASSERT_GT(footprint.get_total(), empty_total);
+
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLStreamTest, ActorSlots)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    prod_host_->add_actor("TestProducerActor", [this]() {
+      auto* self  = sg4::Actor::self();
+      auto dtl    = dtlmod::DTL::connect();
+      auto stream = dtl->add_stream("Stream");
+      stream->set_transport_method(dtlmod::Transport::Method::File);
+      stream->set_engine_type(dtlmod::Engine::Type::File);
+
+      XBT_INFO("Defining a Variable records state for this actor, which gives it a slot");
+      auto var  = stream->define_variable("var", {100, 100}, {0, 0}, {100, 100}, sizeof(double));
+      auto slot = dtlmod::ActorSlot::find(self);
+      ASSERT_NE(slot, dtlmod::ActorSlot::NONE);
+      ASSERT_LT(slot, dtlmod::ActorSlot::get_num_slots());
+      XBT_INFO("Registering as a publisher keeps that slot");
+      auto engine = stream->open("zone:fs:/pfs/file", dtlmod::Stream::Mode::Publish);
+      ASSERT_EQ(dtlmod::ActorSlot::find(self), slot);
+      auto other = cons_host_->add_actor("OtherActor", []() {});
+      ASSERT_NE(dtlmod::ActorSlot::of(other.get()), slot);
+
+      XBT_INFO("Check that per-actor state is found, updated, and erased through the slot");
+      dtlmod::ActorSlotMap<int> values;
+      ASSERT_EQ(values.find(self), nullptr);
+      values[self] = 1;
+      values[self]++;
+      ASSERT_FALSE(values.try_emplace(self, 3).second);
+      ASSERT_EQ(values.at(self), 2);
+      ASSERT_EQ(values.size(), 1U);
+      for (const auto& [actor, value] : values) {
+        ASSERT_EQ(actor.get(), self);
+        ASSERT_EQ(value, 2);
+      }
+      ASSERT_EQ(values.erase(self), 1U);
+      ASSERT_TRUE(values.empty());
+      ASSERT_THROW(values.at(self), std::out_of_range);
+
+      ASSERT_NO_THROW(engine->close());
+      dtlmod::DTL::disconnect();
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLStreamTest, ActorSlotReuse)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    prod_host_->add_actor("TestActor", [this]() {
+      constexpr size_t num_waves       = 10;
+      constexpr size_t actors_per_wave = 4;
+      dtlmod::ActorSlotMap<size_t> values;
+      values[sg4::Actor::self()] = 0;
+      auto first_free_slot       = dtlmod::ActorSlot::get_num_slots();
+
+      XBT_INFO("Start %zu waves of %zu short-lived actors that record some state and leave", num_waves,
+               actors_per_wave);
+      for (size_t wave = 0; wave < num_waves; wave++) {
+        std::vector<sg4::ActorPtr> actors;
+        for (size_t i = 0; i < actors_per_wave; i++)
+          actors.push_back(cons_host_->add_actor("Transient", [&values, wave, first_free_slot]() {
+            auto* self   = sg4::Actor::self();
+            values[self] = wave;
+            ASSERT_LT(dtlmod::ActorSlot::find(self), first_free_slot + actors_per_wave);
+            sg4::this_actor::sleep_for(1);
+            values.erase(self);
+          }));
+        for (const auto& actor : actors)
+          actor->join();
+        actors.clear();
+        // Let SimGrid destroy the actors that ended, which gives their slots back
+        sg4::this_actor::sleep_for(1);
+      }
+
+      XBT_INFO("Check that the slots of the actors that ended were handed out again");
+      ASSERT_EQ(dtlmod::ActorSlot::get_num_slots(), first_free_slot + actors_per_wave);
+      ASSERT_EQ(dtlmod::ActorSlot::get_num_free_slots(), actors_per_wave);
+      XBT_INFO("Per-actor state takes %zu slots for %zu actors that came and went", values.get_num_slots(),
+               num_waves * actors_per_wave + 1);
+      ASSERT_LT(values.get_num_slots(), num_waves * actors_per_wave);
+      ASSERT_EQ(values.size(), 1U);
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
 TEST_F(DTLStreamTest, PublishFileMultipleOpen)
 {
   DO_TEST_WITH_FORK([this]() {
@@ -381,3 +381,305 @@ TEST_F(DTLVariableTest, GetAllVariables)
     ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
   });
 }
+
+// Get the blocks to read for a selection, with their location resolved to a name
+static std::vector<std::pair<std::string, sg_size_t>>
+get_sizes_per_location(const std::shared_ptr<dtlmod::Variable>& var, unsigned int transaction_id,
+                       const std::vector<size_t>& start, const std::vector<size_t>& count,
+                       const std::vector<size_t>& stride = {})
+{
+  std::vector<std::pair<std::string, sg_size_t>> sizes;
+  for (const auto& [location, size] :
+       var->get_sizes_to_get_per_block(transaction_id, start, count, std::nullopt, stride))
+    sizes.emplace_back(var->get_metadata()->get_location(location), size);
+  return sizes;
+}
+
+TEST_F(DTLVariableTest, SelectionOverManyBlocks)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    host_->add_actor("TestActor", [this]() {
+      std::shared_ptr<dtlmod::DTL> dtl;
+      std::shared_ptr<dtlmod::Stream> stream;
+      std::shared_ptr<dtlmod::Variable> var;
+      auto self = sg4::Actor::self();
+      ASSERT_NO_THROW(dtl = dtlmod::DTL::connect());
+      ASSERT_NO_THROW(stream = dtl->add_stream("Stream"));
+      ASSERT_NO_THROW(var = stream->define_variable("var", {128, 128}, {0, 0}, {8, 8}, sizeof(double)));
+
+      XBT_INFO("Register a transaction made of 16x16 blocks of 8x8 elements, enough to be indexed");
+      for (size_t r = 0; r < 16; r++)
+        for (size_t c = 0; c < 16; c++) {
+          var->set_local_start_and_count(self, {{r * 8, c * 8}, {8, 8}});
+          var->add_transaction_metadata(1, self, "block-" + std::to_string(r) + "-" + std::to_string(c));
+        }
+
+      XBT_INFO("Select a 16x16 region that straddles 3x3 blocks");
+      std::vector<std::pair<std::string, sg_size_t>> expected;
+      const size_t overlap[3] = {4, 8, 4};
+      for (size_t r = 0; r < 3; r++)
+        for (size_t c = 0; c < 3; c++)
+          expected.emplace_back("block-" + std::to_string(r) + "-" + std::to_string(c),
+                                overlap[r] * overlap[c] * sizeof(double));
+      ASSERT_EQ(get_sizes_per_location(var, 1, {4, 4}, {16, 16}), expected);
+
+      XBT_INFO("Select a region that touches blocks without overlapping them");
+      ASSERT_TRUE(var->get_sizes_to_get_per_block(1, {8, 8}, {0, 8}).empty());
+      ASSERT_EQ(var->get_sizes_to_get_per_block(1, {8, 8}, {8, 8}).size(), 1U);
+
+      XBT_INFO("Select the whole variable");
+      auto all_blocks = var->get_sizes_to_get_per_block(1, {0, 0}, {128, 128});
+      ASSERT_EQ(all_blocks.size(), 256U);
+      sg_size_t total = 0;
+      for (const auto& [location, size] : all_blocks)
+        total += size;
+      ASSERT_DOUBLE_EQ(total, var->get_global_size());
+
+      ASSERT_NO_THROW(dtlmod::DTL::disconnect());
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLVariableTest, SharedBlockLayout)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    host_->add_actor("TestActor", [this]() {
+      std::shared_ptr<dtlmod::DTL> dtl;
+      std::shared_ptr<dtlmod::Stream> stream;
+      std::shared_ptr<dtlmod::Variable> var;
+      auto self = sg4::Actor::self();
+      ASSERT_NO_THROW(dtl = dtlmod::DTL::connect());
+      ASSERT_NO_THROW(stream = dtl->add_stream("Stream"));
+      ASSERT_NO_THROW(var = stream->define_variable("var", {64, 64}, {0, 0}, {32, 32}, sizeof(double)));
+
+      XBT_INFO("Register 3 transactions with the same 2x2 decomposition");
+      for (unsigned int tx = 1; tx <= 3; tx++) {
+        for (size_t r = 0; r < 2; r++)
+          for (size_t c = 0; c < 2; c++) {
+            var->set_local_start_and_count(self, {{r * 32, c * 32}, {32, 32}});
+            var->add_transaction_metadata(tx, self, "block-" + std::to_string(r) + "-" + std::to_string(c));
+          }
+        ASSERT_EQ(var->get_sizes_to_get_per_block(tx, {16, 16}, {32, 32}).size(), 4U);
+      }
+      XBT_INFO("Check that these transactions share a single layout");
+      ASSERT_EQ(var->get_metadata()->get_num_layouts(), 1U);
+
+      XBT_INFO("Register a 4th transaction with a 1x2 decomposition");
+      for (size_t c = 0; c < 2; c++) {
+        var->set_local_start_and_count(self, {{0, c * 32}, {64, 32}});
+        var->add_transaction_metadata(4, self, "block-" + std::to_string(c));
+      }
+      ASSERT_EQ(var->get_sizes_to_get_per_block(4, {16, 16}, {32, 32}).size(), 2U);
+      ASSERT_EQ(var->get_metadata()->get_num_layouts(), 2U);
+
+      XBT_INFO("Check that a shared layout is still read correctly");
+      std::vector<std::pair<std::string, sg_size_t>> expected = {{"block-1-1", 32 * 32 * sizeof(double)}};
+      ASSERT_EQ(get_sizes_per_location(var, 2, {32, 32}, {32, 32}), expected);
+
+      ASSERT_NO_THROW(dtlmod::DTL::disconnect());
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLVariableTest, StridedSelection)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    host_->add_actor("TestActor", [this]() {
+      std::shared_ptr<dtlmod::DTL> dtl;
+      std::shared_ptr<dtlmod::Stream> stream;
+      std::shared_ptr<dtlmod::Variable> var;
+      auto self = sg4::Actor::self();
+      ASSERT_NO_THROW(dtl = dtlmod::DTL::connect());
+      ASSERT_NO_THROW(stream = dtl->add_stream("Stream"));
+      ASSERT_NO_THROW(var = stream->define_variable("var", {64, 64}, {0, 0}, {32, 32}, sizeof(double)));
+
+      XBT_INFO("Register a transaction with a 2x2 decomposition");
+      for (size_t r = 0; r < 2; r++)
+        for (size_t c = 0; c < 2; c++) {
+          var->set_local_start_and_count(self, {{r * 32, c * 32}, {32, 32}});
+          var->add_transaction_metadata(1, self, "block-" + std::to_string(r) + "-" + std::to_string(c));
+        }
+
+      XBT_INFO("Check that a stride of 2 gets a quarter of each block");
+      std::vector<std::pair<std::string, sg_size_t>> expected;
+      for (const auto* name : {"block-0-0", "block-0-1", "block-1-0", "block-1-1"})
+        expected.emplace_back(name, 16 * 16 * sizeof(double));
+      ASSERT_EQ(get_sizes_per_location(var, 1, {0, 0}, {64, 64}, {2, 2}), expected);
+
+      XBT_INFO("Check that an offset selection with a stride of 4 gets 8x8 elements per block");
+      for (auto& [name, size] : expected)
+        size = 8 * 8 * sizeof(double);
+      ASSERT_EQ(get_sizes_per_location(var, 1, {1, 1}, {63, 63}, {4, 4}), expected);
+
+      XBT_INFO("Check that blocks that hold no selected element are not read");
+      expected = {{"block-0-0", 32 * sizeof(double)}, {"block-0-1", 32 * sizeof(double)}};
+      ASSERT_EQ(get_sizes_per_location(var, 1, {0, 0}, {64, 64}, {64, 1}), expected);
+
+      XBT_INFO("Check that invalid strides are rejected");
+      ASSERT_THROW(var->set_selection({0, 0}, {64, 64}, {2}), dtlmod::InvalidSelectionStrideException);
+      ASSERT_THROW(var->set_selection({0, 0}, {64, 64}, {0, 2}), dtlmod::InvalidSelectionStrideException);
+      ASSERT_NO_THROW(var->set_selection({0, 0}, {64, 64}, {2, 2}));
+      ASSERT_EQ(var->get_subscriber_selection_stride(self), dtlmod::Extents({2, 2}));
+      ASSERT_NO_THROW(var->set_selection({0, 0}, {64, 64}));
+      ASSERT_TRUE(var->get_subscriber_selection_stride(self).empty());
+
+      ASSERT_NO_THROW(dtlmod::DTL::disconnect());
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
+
+TEST_F(DTLVariableTest, MovedExtents)
+{
+  DO_TEST_WITH_FORK([]() {
+    for (size_t ndims : {size_t{2}, dtlmod::Extents::INLINE_CAPACITY + 2}) {
+      XBT_INFO("Move Extents of %zu dimensions", ndims);
+      dtlmod::Extents extents(ndims, 7);
+      dtlmod::Extents moved(std::move(extents));
+      ASSERT_EQ(moved, dtlmod::Extents(ndims, 7));
+      XBT_INFO("A moved-from Extents is empty, and can be used again");
+      ASSERT_TRUE(extents.empty()); // NOLINT(bugprone-use-after-move)
+      ASSERT_EQ(extents.begin(), extents.end());
+      extents = std::move(moved);
+      ASSERT_EQ(extents, dtlmod::Extents(ndims, 7));
+      ASSERT_TRUE(moved.empty()); // NOLINT(bugprone-use-after-move)
+      dtlmod::Extents copy = extents;
+      ASSERT_EQ(copy, extents);
+    }
+  });
+}
+
+TEST_F(DTLVariableTest, OverlapVolume)
+{
+  DO_TEST_WITH_FORK([]() {
+    // Count the selected elements one dimension at a time, position by position
+    auto reference = [](const dtlmod::BlockTable& blocks, size_t b, const dtlmod::Extents& start,
+                        const dtlmod::Extents& count, const dtlmod::Extents& stride) {
+      size_t volume = 1;
+      for (size_t d = 0; d < blocks.get_num_dims(); d++) {
+        size_t in_dim = 0;
+        for (size_t p = blocks.get_start(b)[d]; p < blocks.get_start(b)[d] + blocks.get_count(b)[d]; p++)
+          if (p >= start[d] && p < start[d] + count[d] && (stride.empty() || (p - start[d]) % stride[d] == 0))
+            in_dim++;
+        volume *= in_dim;
+      }
+      return volume;
+    };
+
+    unsigned int seed = 42;
+    auto next         = [&seed](size_t bound) {
+      seed = seed * 1103515245 + 12345;
+      return static_cast<size_t>((seed >> 16) % bound);
+    };
+    for (size_t ndims = 1; ndims <= 6; ndims++) {
+      XBT_INFO("Check the overlap volumes of 100 random blocks in %zu dimension(s)", ndims);
+      dtlmod::BlockTable blocks;
+      for (size_t b = 0; b < 100; b++) {
+        dtlmod::Extents block_start(ndims);
+        dtlmod::Extents block_count(ndims);
+        for (size_t d = 0; d < ndims; d++) {
+          block_start[d] = next(12);
+          block_count[d] = 1 + next(6);
+        }
+        blocks.add(block_start, block_count, 0, 0);
+      }
+      blocks.seal();
+
+      for (unsigned int selection = 0; selection < 20; selection++) {
+        dtlmod::Extents start(ndims);
+        dtlmod::Extents count(ndims);
+        dtlmod::Extents stride(ndims);
+        for (size_t d = 0; d < ndims; d++) {
+          start[d]  = next(10);
+          count[d]  = 1 + next(10);
+          stride[d] = 1 + next(3);
+        }
+        for (size_t b = 0; b < blocks.size(); b++) {
+          ASSERT_EQ(blocks.get_overlap_volume(start, count, dtlmod::Extents(), b),
+                    reference(blocks, b, start, count, dtlmod::Extents()));
+          ASSERT_EQ(blocks.get_overlap_volume(start, count, stride, b), reference(blocks, b, start, count, stride));
+        }
+      }
+    }
+  });
+}
+
+TEST_F(DTLVariableTest, SpillStoreErrors)
+{
+  DO_TEST_WITH_FORK([]() {
+    dtlmod::BlockTable blocks;
+    blocks.add(dtlmod::Extents(2, 0), dtlmod::Extents(2, 10), 0, 0);
+    blocks.seal();
+
+    XBT_INFO("A spill file that cannot be created raises an exception");
+    dtlmod::MetadataSpillStore unwritable("/nonexistent-directory/var.spill");
+    ASSERT_THROW(unwritable.write(blocks), dtlmod::MetadataSpillException);
+
+    XBT_INFO("Reading blocks past the end of the spill file raises an exception");
+    dtlmod::MetadataSpillStore store("var.spill");
+    auto record = store.write(blocks);
+    ASSERT_NO_THROW(store.read(record));
+    record.offset = store.get_size();
+    ASSERT_THROW(store.read(record), dtlmod::MetadataSpillException);
+  });
+}
+
+TEST_F(DTLVariableTest, ShapeChange)
+{
+  DO_TEST_WITH_FORK([this]() {
+    this->setup_platform();
+    host_->add_actor("TestActor", [this]() {
+      std::shared_ptr<dtlmod::DTL> dtl;
+      std::shared_ptr<dtlmod::Stream> stream;
+      std::shared_ptr<dtlmod::Variable> var;
+      auto self = sg4::Actor::self();
+      ASSERT_NO_THROW(dtl = dtlmod::DTL::connect());
+      ASSERT_NO_THROW(stream = dtl->add_stream("Stream"));
+      ASSERT_NO_THROW(var = stream->define_variable("var", {100}, {0}, {100}, sizeof(double)));
+      var->add_transaction_metadata(1, self, "block-0");
+
+      XBT_INFO("Shrink the Variable and the region of the publisher in transaction 2");
+      ASSERT_NO_THROW(var->set_shape({50}, {0}, {50}));
+      var->add_transaction_metadata(2, self, "block-0");
+      ASSERT_DOUBLE_EQ(var->get_global_size(), 50 * sizeof(double));
+      XBT_INFO("Transaction 3 keeps the shape of transaction 2");
+      var->add_transaction_metadata(3, self, "block-0");
+      ASSERT_EQ(var->get_transaction_shape(1), std::vector<size_t>{100});
+      ASSERT_EQ(var->get_transaction_shape(2), std::vector<size_t>{50});
+      ASSERT_EQ(var->get_transaction_shape(3), std::vector<size_t>{50});
+
+      XBT_INFO("Check that the shape cannot change during a transaction");
+      ASSERT_NO_THROW(var->set_shape({80}));
+      ASSERT_THROW(var->add_transaction_metadata(3, self, "block-0"), dtlmod::InconsistentVariableDefinitionException);
+      ASSERT_NO_THROW(var->set_shape({50}));
+
+      XBT_INFO("Check that each transaction is read with its own shape");
+      std::vector<std::pair<std::string, sg_size_t>> expected = {{"block-0", 100 * sizeof(double)}};
+      ASSERT_EQ(get_sizes_per_location(var, 1, {0}, var->get_transaction_shape(1)), expected);
+      expected = {{"block-0", 50 * sizeof(double)}};
+      ASSERT_EQ(get_sizes_per_location(var, 3, {0}, var->get_transaction_shape(3)), expected);
+
+      XBT_INFO("Check that invalid shapes are rejected");
+      ASSERT_THROW(var->set_shape({50, 2}), dtlmod::InconsistentVariableDefinitionException);
+      ASSERT_THROW(var->set_shape({40}), dtlmod::InconsistentVariableDefinitionException);
+      ASSERT_NO_THROW(var->set_shape({60}));
+      ASSERT_EQ(var->get_local_start_and_count(self).second, std::vector<size_t>{50});
+
+      ASSERT_NO_THROW(dtlmod::DTL::disconnect());
+    });
+
+    // Run the simulation
+    ASSERT_NO_THROW(sg4::Engine::get_instance()->run());
+  });
+}
@@ -60,6 +60,14 @@ def run_test_config_file():
         assert stream.access_mode == "Mode::Publish"
         this_actor.info("Check if this stream is set to export metadata (it is)")
         assert True == stream.metadata_export
+        this_actor.info("Check that metadata is exported in the binary format")
+        assert stream.metadata_export_format == Stream.MetadataFormat.Binary
+        this_actor.info("Check that the metadata of this stream is bounded to 1 MiB")
+        assert stream.metadata_memory_budget == 1048576
+        this_actor.info("Check that the I/O operations on the metadata of this stream are simulated")
+        assert stream.metadata_io_simulation
+        this_actor.info("Check that the metadata of this stream is aggregated along a 4-ary tree")
+        assert stream.metadata_aggregation_arity == 4
         this_actor.info("Change the metadata export setting and check again")
         stream.unset_metadata_export()
         assert False == stream.metadata_export
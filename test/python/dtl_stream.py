@@ -162,6 +162,38 @@ def run_test_publish_file_stream_open_close():
 
     e.run()
 
+def run_test_memory_footprint():
+    e, prod_host, _ = setup_platform()
+    def test_producer_actor():
+        dtl = DTL.connect()
+        stream = dtl.add_stream("Stream")
+        stream.set_transport_method(Transport.Method.File)
+        stream.set_engine_type(DTLEngine.Type.File)
+        var = stream.define_variable("var", (100, 100), (0, 0), (100, 100), 8)
+        engine = stream.open("zone:fs:/pfs/file", Stream.Mode.Publish)
+
+        this_actor.info("Before any transaction, only the Variable and the Transport use memory")
+        footprint = stream.memory_footprint
+        assert list(footprint.variables.keys()) == ["var"]
+        assert len(footprint.transactions) == 0
+        assert "to_write_in_transaction" in footprint.transport
+        empty_total = footprint.total
+
+        this_actor.info("Each transaction adds a block table to the metadata of the Variable")
+        engine.begin_transaction()
+        engine.put(var)
+        engine.end_transaction()
+        footprint = stream.memory_footprint
+        assert list(footprint.transactions.keys()) == [1]
+        assert footprint.total > empty_total
+
+        engine.close()
+        DTL.disconnect()
+
+    prod_host.add_actor("Producer", test_producer_actor)
+
+    e.run()
+
 def run_test_publish_file_muliple_open():
     e, prod_host, cons_host = setup_platform()
     def test_producer_actor():
@@ -216,6 +248,7 @@ if __name__ == '__main__':
     tests = [
         run_test_incorrect_stream_settings,
         run_test_publish_file_stream_open_close,
+        run_test_memory_footprint,
         run_test_publish_file_muliple_open
     ]
 
@@ -0,0 +1,95 @@
+/* Copyright (c) 2026. The SWAT Team. All rights reserved.          */
+
+/* This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL) which comes with this package. */
+
+// Print the content of a metadata file exported in the binary format, in the same layout as the text format.
+//
+// Usage: dtlmod-metadata FILE [VARIABLE [TRANSACTION]]
+//
+// Only the requested variable, or the requested transaction of a variable, is read from the mapped file.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "dtlmod/DTLException.hpp"
+#include "dtlmod/MetadataReader.hpp"
+
+static void print_blocks(const dtlmod::MetadataReader& reader, const dtlmod::MetadataReader::Blocks& blocks)
+{
+  for (size_t b = 0; b < blocks.num_blocks; b++) {
+    const auto* start = blocks.get_start(b);
+    const auto* count = blocks.get_count(b);
+    std::cout << "    " << reader.get_location(blocks.get_location_id(b)) << ": [";
+    for (size_t d = 0; d < blocks.num_dims; d++)
+      std::cout << (d > 0 ? ", " : "") << start[d] << ":" << start[d] + count[d];
+    std::cout << "]" << std::endl;
+  }
+}
+
+static void print_variable(const dtlmod::MetadataReader& reader, size_t var, const std::string& transaction)
+{
+  auto ids     = reader.get_transaction_ids(var);
+  auto shape   = reader.get_shape(var);
+  auto changes = reader.get_shape_changes(var);
+  std::cout << reader.get_element_size(var) << "\t" << reader.get_variable_name(var) << "\t" << ids.size() << "*{";
+  for (size_t d = 0; d < shape.size(); d++)
+    std::cout << (d > 0 ? "," : "") << shape[d];
+  std::cout << "}";
+  // Same values as dtlmod::Variable::Kind
+  if (reader.get_kind(var) == 1)
+    std::cout << "\tlocal";
+  else if (reader.get_kind(var) == 2)
+    std::cout << "\tjoined:" << reader.get_joined_dimension(var);
+  std::cout << std::endl;
+
+  if (!transaction.empty())
+    ids = {static_cast<unsigned int>(std::stoul(transaction))};
+  for (auto id : ids) {
+    auto blocks = reader.get_blocks(var, id);
+    if (!blocks) {
+      std::cerr << "No transaction " << id << " for variable " << reader.get_variable_name(var) << std::endl;
+      continue;
+    }
+    std::cout << "  Transaction " << id << ":";
+    // Same format as the text export: the first transaction with each shape gives it, if the shape ever changed
+    auto change = std::find_if(changes.begin(), changes.end(), [id](const auto& c) { return c.first == id; });
+    if (changes.size() > 1 && change != changes.end()) {
+      std::cout << " {";
+      for (size_t d = 0; d < change->second.size(); d++)
+        std::cout << (d > 0 ? "," : "") << change->second[d];
+      std::cout << "}";
+    }
+    std::cout << std::endl;
+    print_blocks(reader, *blocks);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " FILE [VARIABLE [TRANSACTION]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    dtlmod::MetadataReader reader(argv[1]);
+    if (argc == 2) {
+      for (size_t var = 0; var < reader.get_num_variables(); var++)
+        print_variable(reader, var, "");
+    } else {
+      auto var = reader.find_variable(argv[2]);
+      if (!var) {
+        std::cerr << "No variable named " << argv[2] << " in " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+      }
+      print_variable(reader, *var, argc == 4 ? argv[3] : "");
+    }
+  } catch (const dtlmod::InvalidMetadataFileException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}